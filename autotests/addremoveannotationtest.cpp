@@ -12,9 +12,22 @@
 #include "../core/document.h"
 #include "../core/page.h"
 #include "../core/annotations.h"
+#include "../core/observer.h"
 #include "../settings_core.h"
 #include "testingutils.h"
 
+class AnnotationsObserver : public Okular::DocumentObserver
+{
+public:
+    void notifyPageChanged( int page, int flags ) override
+    {
+        if ( flags & Okular::DocumentObserver::Annotations )
+            m_changedPages << page;
+    }
+
+    QList< int > m_changedPages;
+};
+
 class AddRemoveAnnotationTest : public QObject
 {
     Q_OBJECT
@@ -26,6 +39,7 @@ private slots:
     void testAddAnnotations();
     void testAddAnnotationUndoWithRotate_Bug318091();
     void testRemoveAnnotations();
+    void testBatchedAnnotations();
 
 private:
     Okular::Document *m_document;
@@ -187,5 +201,51 @@ void AddRemoveAnnotationTest::testRemoveAnnotations()
     QVERIFY( TestingUtils::AnnotationDisposeWatcher::disposedAnnotationName() == annot1Name );
 }
 
+void AddRemoveAnnotationTest::testBatchedAnnotations()
+{
+    AnnotationsObserver observer;
+    m_document->addObserver( &observer );
+
+    QList< Okular::Annotation * > annots;
+    for ( int i = 0; i < 3; ++i )
+    {
+        Okular::Annotation *annot = new Okular::TextAnnotation();
+        annot->setBoundingRectangle( Okular::NormalizedRect( 0.1 * i, 0.1, 0.1 * i + 0.05, 0.15 ) );
+        annot->setContents( QStringLiteral("annot contents") );
+        annots << annot;
+    }
+
+    // addPageAnnotations() makes a batch of its own, nested in this one
+    m_document->beginAnnotationBatch( QStringLiteral("add annotations") );
+    m_document->addPageAnnotations( 0, annots.mid( 0, 2 ) );
+    m_document->addPageAnnotation( 0, annots.at( 2 ) );
+    QCOMPARE( m_document->page( 0 )->annotations().size(), 3 );
+    QVERIFY( observer.m_changedPages.isEmpty() );
+
+    // The observers are notified once the outermost batch ends
+    m_document->endAnnotationBatch();
+    QCOMPARE( observer.m_changedPages, QList< int >() << 0 );
+
+    // The batch is undone and redone as one step, notifying once too
+    observer.m_changedPages.clear();
+    m_document->undo();
+    QVERIFY( m_document->page( 0 )->annotations().empty() );
+    QVERIFY( !m_document->canUndo() );
+    QCOMPARE( observer.m_changedPages, QList< int >() << 0 );
+
+    observer.m_changedPages.clear();
+    m_document->redo();
+    QCOMPARE( m_document->page( 0 )->annotations().size(), 3 );
+    QCOMPARE( observer.m_changedPages, QList< int >() << 0 );
+
+    // Removing them is batched as well
+    observer.m_changedPages.clear();
+    m_document->removePageAnnotations( 0, annots );
+    QVERIFY( m_document->page( 0 )->annotations().empty() );
+    QCOMPARE( observer.m_changedPages, QList< int >() << 0 );
+
+    m_document->removeObserver( &observer );
+}
+
 QTEST_MAIN( AddRemoveAnnotationTest )
 #include "addremoveannotationtest.moc"
@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QStandardItemModel>
+
+#include "../ui/annotationmodel.h"
+#include "../ui/annotationproxymodels.h"
+
+class AnnotationProxyModelsTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void init();
+        void cleanup();
+        void testIncrementalUpdates_data();
+        void testIncrementalUpdates();
+
+    private:
+        static QStandardItem *pageItem( int page );
+        static QStandardItem *annotationItem( int page, const QString &author, const QString &contents );
+        static QStringList dump( const QAbstractItemModel *model, const QModelIndex &parent = QModelIndex(), int level = 0 );
+        QAbstractItemModel *createProxies( QObject *parent, bool groupByPage, bool groupByAuthor );
+        QStringList rebuilt( bool groupByPage, bool groupByAuthor );
+
+        QStandardItemModel *m_source;
+};
+
+void AnnotationProxyModelsTest::init()
+{
+    // the pages and annotations as AnnotationModel has them
+    m_source = new QStandardItemModel( this );
+    QStandardItem *page = pageItem( 0 );
+    page->appendRow( annotationItem( 0, QStringLiteral("alice"), QStringLiteral("a1") ) );
+    page->appendRow( annotationItem( 0, QStringLiteral("bob"), QStringLiteral("b1") ) );
+    page->appendRow( annotationItem( 0, QStringLiteral("alice"), QStringLiteral("a2") ) );
+    m_source->appendRow( page );
+    page = pageItem( 2 );
+    page->appendRow( annotationItem( 2, QStringLiteral("bob"), QStringLiteral("b2") ) );
+    m_source->appendRow( page );
+    page = pageItem( 5 );
+    page->appendRow( annotationItem( 5, QStringLiteral("alice"), QStringLiteral("a3") ) );
+    page->appendRow( annotationItem( 5, QStringLiteral("carol"), QStringLiteral("c1") ) );
+    m_source->appendRow( page );
+}
+
+void AnnotationProxyModelsTest::cleanup()
+{
+    delete m_source;
+}
+
+QStandardItem *AnnotationProxyModelsTest::pageItem( int page )
+{
+    QStandardItem *item = new QStandardItem( QStringLiteral("Page %1").arg( page + 1 ) );
+    item->setData( page, AnnotationModel::PageRole );
+    return item;
+}
+
+QStandardItem *AnnotationProxyModelsTest::annotationItem( int page, const QString &author, const QString &contents )
+{
+    QStandardItem *item = new QStandardItem( contents );
+    item->setData( page, AnnotationModel::PageRole );
+    item->setData( author, AnnotationModel::AuthorRole );
+    return item;
+}
+
+QStringList AnnotationProxyModelsTest::dump( const QAbstractItemModel *model, const QModelIndex &parent, int level )
+{
+    QStringList lines;
+    for ( int row = 0; row < model->rowCount( parent ); ++row )
+    {
+        const QModelIndex index = model->index( row, 0, parent );
+        if ( index.parent() != parent )
+            lines << QStringLiteral("wrong parent");
+        lines << QString( level * 2, QLatin1Char(' ') ) + index.data().toString();
+        lines << dump( model, index, level + 1 );
+    }
+    return lines;
+}
+
+QAbstractItemModel *AnnotationProxyModelsTest::createProxies( QObject *parent, bool groupByPage, bool groupByAuthor )
+{
+    // chained like in the reviews panel
+    PageFilterProxyModel *filterProxy = new PageFilterProxyModel( parent );
+    PageGroupProxyModel *groupProxy = new PageGroupProxyModel( parent );
+    AuthorGroupProxyModel *authorProxy = new AuthorGroupProxyModel( parent );
+    filterProxy->setSourceModel( m_source );
+    groupProxy->setSourceModel( filterProxy );
+    authorProxy->setSourceModel( groupProxy );
+    groupProxy->groupByPage( groupByPage );
+    authorProxy->groupByAuthor( groupByAuthor );
+    return authorProxy;
+}
+
+QStringList AnnotationProxyModelsTest::rebuilt( bool groupByPage, bool groupByAuthor )
+{
+    QObject parent;
+    return dump( createProxies( &parent, groupByPage, groupByAuthor ) );
+}
+
+void AnnotationProxyModelsTest::testIncrementalUpdates_data()
+{
+    QTest::addColumn<bool>( "groupByPage" );
+    QTest::addColumn<bool>( "groupByAuthor" );
+
+    QTest::newRow( "list" ) << false << false;
+    QTest::newRow( "by page" ) << true << false;
+    QTest::newRow( "by author" ) << false << true;
+    QTest::newRow( "by page and author" ) << true << true;
+}
+
+void AnnotationProxyModelsTest::testIncrementalUpdates()
+{
+    QFETCH( bool, groupByPage );
+    QFETCH( bool, groupByAuthor );
+
+    QObject parent;
+    QAbstractItemModel *proxy = createProxies( &parent, groupByPage, groupByAuthor );
+    QSignalSpy resetSpy( proxy, &QAbstractItemModel::modelReset );
+    QSignalSpy layoutSpy( proxy, &QAbstractItemModel::layoutChanged );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    // an annotation of a new author
+    m_source->item( 1 )->appendRow( annotationItem( 2, QStringLiteral("dave"), QStringLiteral("d1") ) );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    // a new page, with its annotations
+    QStandardItem *page = pageItem( 3 );
+    page->appendRow( annotationItem( 3, QStringLiteral("carol"), QStringLiteral("c2") ) );
+    page->appendRow( annotationItem( 3, QStringLiteral("alice"), QStringLiteral("a4") ) );
+    m_source->insertRow( 2, page );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    // the first annotation of an author goes away
+    m_source->item( 0 )->removeRow( 0 );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    // an annotation changes author, and another one its contents
+    m_source->item( 0 )->child( 0 )->setData( QStringLiteral("erin"), AnnotationModel::AuthorRole );
+    m_source->item( 3 )->child( 1 )->setText( QStringLiteral("c1 edited") );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+    QCOMPARE( dump( proxy ).filter( QStringLiteral("c1 edited") ).count(), 1 );
+
+    // a whole page goes away
+    m_source->removeRow( 1 );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    // the last annotation of a page goes away with the page
+    m_source->item( 1 )->removeRow( 1 );
+    m_source->item( 1 )->removeRow( 0 );
+    m_source->removeRow( 1 );
+    QCOMPARE( dump( proxy ), rebuilt( groupByPage, groupByAuthor ) );
+
+    QCOMPARE( resetSpy.count(), 0 );
+    QCOMPARE( layoutSpy.count(), 0 );
+}
+
+QTEST_MAIN( AnnotationProxyModelsTest )
+#include "annotationproxymodelstest.moc"
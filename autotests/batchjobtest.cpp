@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "../batch/batchjob.h"
+#include "settings.h"
+
+class BatchJobTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testRender_data();
+        void testRender();
+        void testOutputNames();
+};
+
+void BatchJobTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled( true );
+    Okular::Settings::instance( QStringLiteral("batchjobtest") );
+}
+
+void BatchJobTest::testRender_data()
+{
+    QTest::addColumn<QSize>( "box" );
+
+    QTest::newRow( "small" ) << QSize( 600, 600 );
+    // above the 8000000 pixels from which pages are rendered in tiles
+    QTest::newRow( "tiled" ) << QSize( 4000, 4000 );
+}
+
+void BatchJobTest::testRender()
+{
+    QFETCH( QSize, box );
+
+    QTemporaryDir outputDir;
+    QVERIFY( outputDir.isValid() );
+
+    BatchOptions options;
+    options.pageRanges << qMakePair( 1, 1 );
+    options.sizes << box;
+    options.outputDir = outputDir.path();
+
+    BatchJob job( options );
+    QVERIFY2( job.run( QStringLiteral(KDESRCDIR "data/file1.pdf") ), qPrintable( job.errorString() ) );
+    QCOMPARE( job.processedPages(), 1 );
+
+    const QDir dir( outputDir.path() );
+    const QStringList images = dir.entryList( QStringList() << QStringLiteral("*.png"), QDir::Files );
+    QCOMPARE( images.count(), 1 );
+
+    const QImage image( dir.filePath( images.first() ) );
+    QVERIFY( !image.isNull() );
+    QVERIFY( image.width() == box.width() || image.height() == box.height() );
+
+    // something was painted over the white background
+    const QImage scaled = image.scaled( 200, 200 ).convertToFormat( QImage::Format_RGB32 );
+    bool painted = false;
+    for ( int y = 0; y < scaled.height() && !painted; ++y )
+    {
+        for ( int x = 0; x < scaled.width() && !painted; ++x )
+            painted = scaled.pixel( x, y ) != qRgb( 255, 255, 255 );
+    }
+    QVERIFY( painted );
+}
+
+void BatchJobTest::testOutputNames()
+{
+    // documents with the same name in different directories
+    QTemporaryDir inputDir;
+    QTemporaryDir outputDir;
+    QVERIFY( inputDir.isValid() && outputDir.isValid() );
+    const QDir input( inputDir.path() );
+    QVERIFY( input.mkpath( QStringLiteral("a") ) && input.mkpath( QStringLiteral("b") ) );
+    const QString first = input.filePath( QStringLiteral("a/doc.pdf") );
+    const QString second = input.filePath( QStringLiteral("b/doc.pdf") );
+    QVERIFY( QFile::copy( QStringLiteral(KDESRCDIR "data/file1.pdf"), first ) );
+    QVERIFY( QFile::copy( QStringLiteral(KDESRCDIR "data/file1.pdf"), second ) );
+
+    BatchOptions options;
+    options.pageRanges << qMakePair( 1, 1 );
+    options.sizes << QSize( 100, 100 );
+    options.outputDir = outputDir.path();
+    options.inputDir = inputDir.path();
+
+    BatchJob job( options );
+    QVERIFY2( job.run( first ), qPrintable( job.errorString() ) );
+    QVERIFY2( job.run( second ), qPrintable( job.errorString() ) );
+
+    const QDir output( outputDir.path() );
+    const QStringList filters = QStringList() << QStringLiteral("doc.pdf-*.png");
+    QCOMPARE( QDir( output.filePath( QStringLiteral("a") ) ).entryList( filters, QDir::Files ).count(), 1 );
+    QCOMPARE( QDir( output.filePath( QStringLiteral("b") ) ).entryList( filters, QDir::Files ).count(), 1 );
+
+    // and nothing is written outside of the output directory
+    options.inputDir = input.filePath( QStringLiteral("a") );
+    BatchJob outsideJob( options );
+    QVERIFY( !outsideJob.run( second ) );
+}
+
+QTEST_MAIN( BatchJobTest )
+#include "batchjobtest.moc"
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QtXml/QDomDocument>
+
+#include "../core/documentinfowriter_p.h"
+
+class DocumentInfoWriterTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void testWrite();
+        void testQueuedSaves();
+        void testFailedWriteKeepsFile();
+
+    private:
+        static Okular::DocumentInfoSnapshot snapshot( const QString &fileName, const QString &contents );
+        static QDomDocument read( const QString &fileName );
+
+        QTemporaryDir m_dir;
+};
+
+void DocumentInfoWriterTest::initTestCase()
+{
+    QVERIFY( m_dir.isValid() );
+}
+
+Okular::DocumentInfoSnapshot DocumentInfoWriterTest::snapshot( const QString &fileName, const QString &contents )
+{
+    QDomDocument doc;
+
+    QDomElement annotations = doc.createElement( QStringLiteral("annotationList") );
+    QDomElement annotation = doc.createElement( QStringLiteral("annotation") );
+    annotation.setAttribute( QStringLiteral("contents"), contents );
+    annotations.appendChild( annotation );
+
+    QDomElement forms = doc.createElement( QStringLiteral("forms") );
+    QDomElement form = doc.createElement( QStringLiteral("form") );
+    form.setAttribute( QStringLiteral("id"), 3 );
+    form.setAttribute( QStringLiteral("value"), QStringLiteral("a & b") );
+    forms.appendChild( form );
+
+    QDomElement pending = doc.createElement( QStringLiteral("page") );
+    pending.setAttribute( QStringLiteral("number"), 12 );
+    pending.appendChild( annotations.cloneNode() );
+
+    QDomElement generalInfo = doc.createElement( QStringLiteral("generalInfo") );
+    QDomElement rotation = doc.createElement( QStringLiteral("rotation") );
+    rotation.appendChild( doc.createTextNode( QStringLiteral("1") ) );
+    generalInfo.appendChild( rotation );
+
+    Okular::DocumentInfoSnapshot::PageInfo page;
+    page.number = 2;
+    page.annotations = Okular::DocumentInfoSnapshot::serialize( annotations );
+    page.forms = Okular::DocumentInfoSnapshot::serialize( forms );
+
+    Okular::DocumentInfoSnapshot snapshot;
+    snapshot.fileName = fileName;
+    snapshot.url = QStringLiteral("/tmp/file.pdf");
+    snapshot.pages << page;
+    snapshot.pendingPages << Okular::DocumentInfoSnapshot::serialize( pending );
+    snapshot.generalInfo = Okular::DocumentInfoSnapshot::serialize( generalInfo );
+    return snapshot;
+}
+
+QDomDocument DocumentInfoWriterTest::read( const QString &fileName )
+{
+    QDomDocument doc;
+    QFile file( fileName );
+    if ( file.open( QIODevice::ReadOnly ) )
+        doc.setContent( &file );
+    return doc;
+}
+
+void DocumentInfoWriterTest::testWrite()
+{
+    const QString fileName = m_dir.path() + QStringLiteral("/write.xml");
+    QVERIFY( Okular::DocumentInfoWriter::write( snapshot( fileName, QStringLiteral("<\"quoted\">") ) ) );
+
+    const QDomDocument doc = read( fileName );
+    const QDomElement root = doc.documentElement();
+    QCOMPARE( root.tagName(), QStringLiteral("documentInfo") );
+    QCOMPARE( root.attribute( QStringLiteral("url") ), QStringLiteral("/tmp/file.pdf") );
+
+    const QDomElement pageList = root.firstChildElement( QStringLiteral("pageList") );
+    const QDomElement page = pageList.firstChildElement( QStringLiteral("page") );
+    QCOMPARE( page.attribute( QStringLiteral("number") ), QStringLiteral("2") );
+    const QDomElement annotation = page.firstChildElement( QStringLiteral("annotationList") ).firstChildElement( QStringLiteral("annotation") );
+    QCOMPARE( annotation.attribute( QStringLiteral("contents") ), QStringLiteral("<\"quoted\">") );
+    const QDomElement form = page.firstChildElement( QStringLiteral("forms") ).firstChildElement( QStringLiteral("form") );
+    QCOMPARE( form.attribute( QStringLiteral("value") ), QStringLiteral("a & b") );
+
+    const QDomElement pending = page.nextSiblingElement( QStringLiteral("page") );
+    QCOMPARE( pending.attribute( QStringLiteral("number") ), QStringLiteral("12") );
+    QVERIFY( !pending.firstChildElement( QStringLiteral("annotationList") ).isNull() );
+
+    const QDomElement rotation = root.firstChildElement( QStringLiteral("generalInfo") ).firstChildElement( QStringLiteral("rotation") );
+    QCOMPARE( rotation.text(), QStringLiteral("1") );
+}
+
+void DocumentInfoWriterTest::testQueuedSaves()
+{
+    const QString fileName = m_dir.path() + QStringLiteral("/queued.xml");
+    Okular::DocumentInfoWriter::instance()->save( snapshot( fileName, QStringLiteral("first") ) );
+    Okular::DocumentInfoWriter::instance()->save( snapshot( fileName, QStringLiteral("second") ) );
+    Okular::DocumentInfoWriter::instance()->waitForDone();
+
+    // the last save wins, whether or not the first one was written
+    const QDomElement annotation = read( fileName ).documentElement()
+        .firstChildElement( QStringLiteral("pageList") ).firstChildElement( QStringLiteral("page") )
+        .firstChildElement( QStringLiteral("annotationList") ).firstChildElement( QStringLiteral("annotation") );
+    QCOMPARE( annotation.attribute( QStringLiteral("contents") ), QStringLiteral("second") );
+}
+
+void DocumentInfoWriterTest::testFailedWriteKeepsFile()
+{
+    // a file that cannot be replaced, as its directory is read only
+    const QString dirName = m_dir.path() + QStringLiteral("/readonly");
+    QVERIFY( QDir().mkpath( dirName ) );
+    const QString fileName = dirName + QStringLiteral("/file.xml");
+    QVERIFY( Okular::DocumentInfoWriter::write( snapshot( fileName, QStringLiteral("kept") ) ) );
+    QFile::setPermissions( dirName, QFile::ReadOwner | QFile::ExeOwner );
+
+    const bool written = Okular::DocumentInfoWriter::write( snapshot( fileName, QStringLiteral("lost") ) );
+    QFile::setPermissions( dirName, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner );
+    if ( written )
+        QSKIP( "The directory is writable anyway, eg when running as root" );
+
+    const QDomElement annotation = read( fileName ).documentElement()
+        .firstChildElement( QStringLiteral("pageList") ).firstChildElement( QStringLiteral("page") )
+        .firstChildElement( QStringLiteral("annotationList") ).firstChildElement( QStringLiteral("annotation") );
+    QCOMPARE( annotation.attribute( QStringLiteral("contents") ), QStringLiteral("kept") );
+}
+
+QTEST_MAIN( DocumentInfoWriterTest )
+#include "documentinfowritertest.moc"
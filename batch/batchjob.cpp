@@ -0,0 +1,416 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "batchjob.h"
+
+// qt/kde includes
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QLinkedList>
+#include <QtCore/QMimeDatabase>
+#include <QtCore/QTextStream>
+#include <QtCore/QTimer>
+#include <QtCore/QXmlStreamWriter>
+#include <QtCore/QUrl>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <KLocalizedString>
+
+// local includes
+#include "core/area.h"
+#include "core/document.h"
+#include "core/generator.h"
+#include "core/observer.h"
+#include "core/page.h"
+#include "core/textpage.h"
+#include "ui/pagepainter.h"
+
+// how long to wait for a pixmap, or for the next pages of a document
+static const int WaitTimeout = 60000;
+
+/**
+ * The observer of the job, which interrupts wait() when pages are appended
+ * to the document or pixmaps are delivered, as generators may do both from
+ * the event loop.
+ */
+class BatchObserver : public Okular::DocumentObserver
+{
+    public:
+        BatchObserver()
+            : m_loop( 0 )
+        {
+        }
+
+        void notifySetup( const QVector< Okular::Page * > &, int ) override
+        {
+            wake();
+        }
+
+        void notifyPageChanged( int, int flags ) override
+        {
+            if ( flags & Okular::DocumentObserver::Pixmap )
+                wake();
+        }
+
+        /**
+         * Runs the event loop until the next notification, or for @p msecs.
+         */
+        void wait( int msecs )
+        {
+            QEventLoop loop;
+            QTimer::singleShot( msecs, &loop, &QEventLoop::quit );
+            m_loop = &loop;
+            loop.exec();
+            m_loop = 0;
+        }
+
+    private:
+        void wake()
+        {
+            if ( m_loop )
+                m_loop->quit();
+        }
+
+        QEventLoop *m_loop;
+};
+
+bool BatchOptions::parsePageRanges( const QString &spec, QVector< QPair< int, int > > *ranges )
+{
+    ranges->clear();
+    foreach ( const QString &part, spec.split( QLatin1Char( ',' ), QString::SkipEmptyParts ) )
+    {
+        const int dash = part.indexOf( QLatin1Char( '-' ) );
+        bool okFirst = true, okLast = true;
+        int first, last;
+        if ( dash == -1 )
+        {
+            first = last = part.trimmed().toInt( &okFirst );
+        }
+        else
+        {
+            first = part.left( dash ).trimmed().toInt( &okFirst );
+            const QString end = part.mid( dash + 1 ).trimmed();
+            last = end.isEmpty() ? 0 : end.toInt( &okLast );
+        }
+        if ( !okFirst || !okLast || first < 1 || last < 0 || ( last != 0 && last < first ) )
+            return false;
+        ranges->append( qMakePair( first, last ) );
+    }
+    return !ranges->isEmpty();
+}
+
+bool BatchOptions::parseSize( const QString &spec, QSize *size )
+{
+    const QStringList parts = spec.split( QLatin1Char( 'x' ) );
+    if ( parts.count() != 2 )
+        return false;
+
+    bool okWidth, okHeight;
+    *size = QSize( parts.at( 0 ).toInt( &okWidth ), parts.at( 1 ).toInt( &okHeight ) );
+    return okWidth && okHeight && !size->isEmpty();
+}
+
+
+BatchJob::BatchJob( const BatchOptions &options )
+    : m_options( options ), m_document( new Okular::Document( 0 ) ),
+      m_observer( new BatchObserver ), m_processedPages( 0 )
+{
+    m_document->addObserver( m_observer );
+}
+
+BatchJob::~BatchJob()
+{
+    m_document->removeObserver( m_observer );
+    delete m_observer;
+    delete m_document;
+}
+
+bool BatchJob::run( const QString &fileName )
+{
+    m_processedPages = 0;
+    m_error.clear();
+
+    const QMimeType mime = QMimeDatabase().mimeTypeForFile( fileName );
+    if ( m_document->openDocument( fileName, QUrl::fromLocalFile( fileName ), mime ) != Okular::Document::OpenSuccess )
+    {
+        m_error = i18n( "Could not open %1", fileName );
+        return false;
+    }
+
+    if ( !waitForPages() )
+    {
+        m_document->closeDocument();
+        return false;
+    }
+
+    const QString baseName = outputBaseName( fileName );
+    if ( baseName.isEmpty() )
+    {
+        m_document->closeDocument();
+        return false;
+    }
+    const QVector< int > pages = selectedPages();
+
+    // render at the size of the pages when nothing was asked for
+    QList< QSize > sizes = m_options.sizes;
+    if ( sizes.isEmpty() && !m_options.text && !m_options.words )
+        sizes << QSize();
+
+    bool ok = true;
+    foreach ( const int number, pages )
+    {
+        foreach ( const QSize &box, sizes )
+            ok = ok && renderPage( number, box, baseName );
+        if ( !ok )
+            break;
+    }
+    if ( ok && m_options.text )
+        ok = writeText( pages, baseName );
+    if ( ok && m_options.words )
+        ok = writeWords( pages, baseName );
+
+    if ( ok )
+        m_processedPages = pages.count();
+
+    m_document->closeDocument();
+    return ok;
+}
+
+int BatchJob::processedPages() const
+{
+    return m_processedPages;
+}
+
+QString BatchJob::errorString() const
+{
+    return m_error;
+}
+
+QString BatchJob::outputBaseName( const QString &fileName )
+{
+    // the extension is kept and the directories are mirrored, so that the
+    // outputs of documents with the same base name do not overwrite each other
+    QString relative = QFileInfo( fileName ).fileName();
+    if ( !m_options.inputDir.isEmpty() )
+    {
+        relative = QDir( m_options.inputDir ).relativeFilePath( fileName );
+        if ( relative.startsWith( QLatin1String( "../" ) ) || QDir::isAbsolutePath( relative ) )
+        {
+            m_error = i18n( "%1 is not in %2", fileName, m_options.inputDir );
+            return QString();
+        }
+    }
+
+    const QString baseName = QDir( m_options.outputDir ).filePath( relative );
+    if ( !QDir().mkpath( QFileInfo( baseName ).absolutePath() ) )
+    {
+        m_error = i18n( "Could not create %1", QFileInfo( baseName ).absolutePath() );
+        return QString();
+    }
+    return baseName;
+}
+
+bool BatchJob::waitForPages()
+{
+    // the last page asked for, 0 for all of them
+    int needed = 0;
+    foreach ( const auto &range, m_options.pageRanges )
+    {
+        needed = range.second == 0 ? 0 : qMax( needed, range.second );
+        if ( needed == 0 )
+            break;
+    }
+
+    // generators paginating in the background append the pages from the
+    // event loop; the timeout starts again with every new page
+    QElapsedTimer idle;
+    idle.start();
+    int count = m_document->pages();
+    while ( m_document->isAppendingPages() && ( needed == 0 || count < needed ) )
+    {
+        if ( idle.elapsed() >= WaitTimeout )
+        {
+            m_error = i18n( "Timed out waiting for the pages of the document" );
+            return false;
+        }
+        m_observer->wait( WaitTimeout - idle.elapsed() );
+        if ( m_document->pages() > count )
+        {
+            count = m_document->pages();
+            idle.restart();
+        }
+    }
+
+    foreach ( const auto &range, m_options.pageRanges )
+    {
+        const int last = qMax( range.first, range.second );
+        if ( last > count )
+        {
+            m_error = i18n( "The document has no page %1", last );
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BatchJob::waitForPixmap( int number, const QSize &size )
+{
+    // generators rendering in threads of their own deliver the pixmap from
+    // the event loop
+    const Okular::Page *page = m_document->page( number );
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const Okular::NormalizedRect wholePage( 0, 0, 1, 1 );
+    while ( !page->hasPixmap( m_observer, size.width(), size.height(), wholePage ) )
+    {
+        if ( elapsed.elapsed() >= WaitTimeout )
+        {
+            m_error = i18n( "Timed out rendering page %1", number + 1 );
+            return false;
+        }
+        m_observer->wait( WaitTimeout - elapsed.elapsed() );
+    }
+    return true;
+}
+
+QVector< int > BatchJob::selectedPages() const
+{
+    const int count = m_document->pages();
+    QVector< int > pages;
+    if ( m_options.pageRanges.isEmpty() )
+    {
+        pages.reserve( count );
+        for ( int i = 0; i < count; ++i )
+            pages.append( i );
+        return pages;
+    }
+
+    foreach ( const auto &range, m_options.pageRanges )
+    {
+        const int last = range.second == 0 ? count : qMin( range.second, count );
+        for ( int i = range.first; i <= last; ++i )
+        {
+            if ( !pages.contains( i - 1 ) )
+                pages.append( i - 1 );
+        }
+    }
+    return pages;
+}
+
+bool BatchJob::renderPage( int number, const QSize &box, const QString &baseName )
+{
+    const Okular::Page *page = m_document->page( number );
+
+    QSize size( qRound( page->width() ), qRound( page->height() ) );
+    if ( box.isValid() )
+        size.scale( box, Qt::KeepAspectRatio );
+    if ( size.isEmpty() )
+    {
+        m_error = i18n( "Page %1 has no size", number + 1 );
+        return false;
+    }
+
+    // not asynchronous, but generators with renderers of their own still
+    // deliver the pixmap, or the tiles of a big page, later; the whole page
+    // is asked for, as requests for tiles without an area are discarded
+    Okular::PixmapRequest *request = new Okular::PixmapRequest( m_observer, number, size.width(), size.height(), 1, Okular::PixmapRequest::NoFeature );
+    request->setNormalizedRect( Okular::NormalizedRect( 0, 0, 1, 1 ) );
+    m_document->requestPixmaps( QLinkedList< Okular::PixmapRequest * >() << request );
+    if ( !waitForPixmap( number, size ) )
+        return false;
+
+    QImage image( size, QImage::Format_ARGB32_Premultiplied );
+    image.fill( Qt::white );
+    QPainter painter( &image );
+    PagePainter::paintPageOnPainter( &painter, page, m_observer, PagePainter::Annotations,
+                                     size.width(), size.height(), QRect( QPoint( 0, 0 ), size ) );
+    painter.end();
+
+    const QString fileName = QStringLiteral( "%1-%2-%3x%4.png" ).arg( baseName ).arg( number + 1 ).arg( size.width() ).arg( size.height() );
+    if ( !image.save( fileName, "PNG" ) )
+    {
+        m_error = i18n( "Could not write %1", fileName );
+        return false;
+    }
+    return true;
+}
+
+bool BatchJob::writeText( const QVector< int > &pages, const QString &baseName )
+{
+    QFile file( baseName + QStringLiteral( ".txt" ) );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        m_error = i18n( "Could not write %1", file.fileName() );
+        return false;
+    }
+
+    // the pages are separated with form feeds, like pdftotext does
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    bool first = true;
+    foreach ( const int number, pages )
+    {
+        const Okular::Page *page = m_document->page( number );
+        if ( !page->hasTextPage() )
+            m_document->requestTextPage( number );
+        if ( !first )
+            stream << QLatin1Char( '\f' );
+        stream << page->text();
+        first = false;
+    }
+    stream.flush();
+    return file.error() == QFile::NoError;
+}
+
+bool BatchJob::writeWords( const QVector< int > &pages, const QString &baseName )
+{
+    QFile file( baseName + QStringLiteral( ".words.xml" ) );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        m_error = i18n( "Could not write %1", file.fileName() );
+        return false;
+    }
+
+    QXmlStreamWriter writer( &file );
+    writer.setAutoFormatting( true );
+    writer.writeStartDocument();
+    writer.writeStartElement( QStringLiteral( "document" ) );
+    foreach ( const int number, pages )
+    {
+        const Okular::Page *page = m_document->page( number );
+        if ( !page->hasTextPage() )
+            m_document->requestTextPage( number );
+
+        writer.writeStartElement( QStringLiteral( "page" ) );
+        writer.writeAttribute( QStringLiteral( "number" ), QString::number( number + 1 ) );
+        writer.writeAttribute( QStringLiteral( "width" ), QString::number( page->width() ) );
+        writer.writeAttribute( QStringLiteral( "height" ), QString::number( page->height() ) );
+
+        // the areas are normalized to the size of the page
+        const Okular::TextEntity::List words = page->words( 0, Okular::TextPage::CentralPixelTextAreaInclusionBehaviour );
+        foreach ( const Okular::TextEntity *word, words )
+        {
+            const Okular::NormalizedRect *area = word->area();
+            writer.writeStartElement( QStringLiteral( "word" ) );
+            writer.writeAttribute( QStringLiteral( "l" ), QString::number( area->left ) );
+            writer.writeAttribute( QStringLiteral( "t" ), QString::number( area->top ) );
+            writer.writeAttribute( QStringLiteral( "r" ), QString::number( area->right ) );
+            writer.writeAttribute( QStringLiteral( "b" ), QString::number( area->bottom ) );
+            writer.writeCharacters( word->text() );
+            writer.writeEndElement();
+        }
+        qDeleteAll( words );
+
+        writer.writeEndElement();
+    }
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    return !writer.hasError();
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_BATCHJOB_H_
+#define _OKULAR_BATCHJOB_H_
+
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace Okular {
+class Document;
+class Page;
+}
+
+class BatchObserver;
+
+/**
+ * What to extract from every document.
+ */
+struct BatchOptions
+{
+    BatchOptions()
+        : text( false ), words( false )
+    {
+    }
+
+    // 1-based and inclusive, a second value of 0 meaning the last page;
+    // all the pages when empty
+    QVector< QPair< int, int > > pageRanges;
+    // the boxes the pages are rendered in, keeping their aspect ratio; the
+    // size of the pages at 72 dpi if no size and no text was asked for
+    QList< QSize > sizes;
+    bool text;
+    bool words;
+    QString outputDir;
+    // the outputs are named after the paths of the documents relative to
+    // this directory, which they mirror in outputDir; after the file names
+    // of the documents when empty
+    QString inputDir;
+
+    // parses page ranges in the form "1-3,7,10-", false if @p spec is invalid
+    static bool parsePageRanges( const QString &spec, QVector< QPair< int, int > > *ranges );
+    // parses a size in the form "800x600", false if @p spec is invalid
+    static bool parseSize( const QString &spec, QSize *size );
+};
+
+/**
+ * Opens documents with okularcore and writes the renderings and the text of
+ * their pages, one document at a time.
+ */
+class BatchJob
+{
+    public:
+        explicit BatchJob( const BatchOptions &options );
+        ~BatchJob();
+
+        /**
+         * Processes the document at @p fileName, returns whether it succeeded.
+         */
+        bool run( const QString &fileName );
+
+        /**
+         * The number of pages the last run() processed.
+         */
+        int processedPages() const;
+
+        /**
+         * The reason the last run() failed.
+         */
+        QString errorString() const;
+
+    private:
+        QString outputBaseName( const QString &fileName );
+        bool waitForPages();
+        bool waitForPixmap( int number, const QSize &size );
+        QVector< int > selectedPages() const;
+        bool renderPage( int number, const QSize &box, const QString &baseName );
+        bool writeText( const QVector< int > &pages, const QString &baseName );
+        bool writeWords( const QVector< int > &pages, const QString &baseName );
+
+        BatchOptions m_options;
+        Okular::Document *m_document;
+        BatchObserver *m_observer;
+        int m_processedPages;
+        QString m_error;
+};
+
+#endif
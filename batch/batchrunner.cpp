@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "batchrunner.h"
+
+// qt/kde includes
+#include <QtCore/QCoreApplication>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QTextStream>
+
+QString BatchStats::documentLine( const QString &fileName, int pages, qint64 msecs )
+{
+    return QStringLiteral( "%1: %2 pages in %3 ms" ).arg( fileName ).arg( pages ).arg( msecs );
+}
+
+void BatchStats::print( qint64 msecs ) const
+{
+    const double seconds = qMax( msecs, qint64( 1 ) ) / 1000.0;
+    QTextStream out( stdout );
+    out << QStringLiteral( "%1 documents (%2 failed), %3 pages in %4 s: %5 documents/s, %6 pages/s" )
+               .arg( documents ).arg( failed ).arg( pages ).arg( seconds, 0, 'f', 2 )
+               .arg( documents / seconds, 0, 'f', 2 ).arg( pages / seconds, 0, 'f', 2 )
+        << endl;
+}
+
+
+BatchRunner::BatchRunner( const QStringList &files, const QStringList &jobArguments, int jobs, QObject *parent )
+    : QObject( parent ), m_pending( files ), m_jobArguments( jobArguments ), m_jobs( qMax( jobs, 1 ) )
+{
+}
+
+void BatchRunner::start()
+{
+    m_timer.start();
+    while ( m_running.count() < m_jobs && !m_pending.isEmpty() )
+        startNext();
+}
+
+void BatchRunner::startNext()
+{
+    const QString fileName = m_pending.takeFirst();
+
+    // the children report their errors directly, their results are parsed
+    // and forwarded by processFinished()
+    QProcess *process = new QProcess( this );
+    process->setProcessChannelMode( QProcess::ForwardedErrorChannel );
+    connect( process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>( &QProcess::finished ),
+             this, &BatchRunner::processFinished );
+    connect( process, &QProcess::errorOccurred, this, &BatchRunner::processError );
+    m_running.insert( process, fileName );
+    process->start( QCoreApplication::applicationFilePath(), QStringList( m_jobArguments ) << fileName );
+}
+
+void BatchRunner::processFinished( int exitCode, QProcess::ExitStatus exitStatus )
+{
+    QProcess *process = qobject_cast< QProcess * >( sender() );
+    const QString fileName = m_running.take( process );
+
+    ++m_stats.documents;
+    if ( exitStatus != QProcess::NormalExit || exitCode != 0 )
+        ++m_stats.failed;
+
+    static const QRegularExpression resultLine( QStringLiteral( ": (\\d+) pages in \\d+ ms$" ) );
+    QTextStream out( stdout );
+    const QString output = QString::fromLocal8Bit( process->readAllStandardOutput() );
+    foreach ( const QString &line, output.split( QLatin1Char( '\n' ), QString::SkipEmptyParts ) )
+    {
+        const QRegularExpressionMatch match = resultLine.match( line );
+        if ( match.hasMatch() )
+            m_stats.pages += match.captured( 1 ).toInt();
+        out << line << endl;
+    }
+    if ( exitStatus != QProcess::NormalExit )
+        QTextStream( stderr ) << fileName << ": " << process->errorString() << endl;
+
+    process->deleteLater();
+
+    if ( !m_pending.isEmpty() )
+        startNext();
+    else if ( m_running.isEmpty() )
+    {
+        m_stats.print( m_timer.elapsed() );
+        emit finished( m_stats.failed == 0 ? 0 : 1 );
+    }
+}
+
+void BatchRunner::processError( QProcess::ProcessError error )
+{
+    // a process that could not start never finishes
+    if ( error == QProcess::FailedToStart )
+        processFinished( -1, QProcess::CrashExit );
+}
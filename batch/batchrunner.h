@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_BATCHRUNNER_H_
+#define _OKULAR_BATCHRUNNER_H_
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+
+/**
+ * The throughput of a batch, printed once it is done.
+ */
+struct BatchStats
+{
+    BatchStats()
+        : documents( 0 ), failed( 0 ), pages( 0 )
+    {
+    }
+
+    // the line printed for a processed document, parsed back by BatchRunner
+    static QString documentLine( const QString &fileName, int pages, qint64 msecs );
+    void print( qint64 msecs ) const;
+
+    int documents;
+    int failed;
+    int pages;
+};
+
+/**
+ * Processes the documents in up to @p jobs child processes at the same time,
+ * one document per process, so that the generators run in parallel and a
+ * crash only fails its own document.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+    public:
+        BatchRunner( const QStringList &files, const QStringList &jobArguments, int jobs, QObject *parent = 0 );
+
+        void start();
+
+    Q_SIGNALS:
+        void finished( int exitCode );
+
+    private Q_SLOTS:
+        void processFinished( int exitCode, QProcess::ExitStatus exitStatus );
+        void processError( QProcess::ProcessError error );
+
+    private:
+        void startNext();
+
+        QStringList m_pending;
+        QStringList m_jobArguments;
+        int m_jobs;
+        QHash< QProcess *, QString > m_running;
+        BatchStats m_stats;
+        QElapsedTimer m_timer;
+};
+
+#endif
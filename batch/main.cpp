@@ -0,0 +1,172 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <KLocalizedString>
+
+#include "batchjob.h"
+#include "batchrunner.h"
+#include "settings.h"
+
+// the deepest directory containing all of @p files
+static QString commonDirectory(const QStringList &files)
+{
+    QDir common(QFileInfo(files.first()).absolutePath());
+    foreach (const QString &file, files)
+    {
+        while (common.relativeFilePath(file).startsWith(QLatin1String("../")) && common.cdUp())
+            ;
+    }
+    return common.path();
+}
+
+int main(int argc, char** argv)
+{
+    // nothing is ever shown, so do not require a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    // the metadata of the documents and the caches of the generators are of
+    // no use once the batch is done, so keep them out of the user's data
+    QTemporaryDir dataDir;
+    if (dataDir.isValid())
+    {
+        qputenv("XDG_DATA_HOME", QFile::encodeName(dataDir.path() + QStringLiteral("/data")));
+        qputenv("XDG_CACHE_HOME", QFile::encodeName(dataDir.path() + QStringLiteral("/cache")));
+    }
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName(QStringLiteral("okularbatch"));
+
+    KLocalizedString::setApplicationDomain("okular");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(i18n("Renders the pages of documents to PNG images and extracts their text, without a user interface."));
+    parser.addHelpOption();
+
+    const QCommandLineOption pagesOption(QStringList() << QStringLiteral("p") << QStringLiteral("pages"), i18n("Pages to process, e.g. \"1-3,7,10-\" (default: all the pages)"), QStringLiteral("ranges"));
+    const QCommandLineOption sizeOption(QStringList() << QStringLiteral("s") << QStringLiteral("size"), i18n("Render the pages to fit in a box of this size, e.g. \"800x600\"; can be repeated"), QStringLiteral("size"));
+    const QCommandLineOption textOption(QStringList() << QStringLiteral("t") << QStringLiteral("text"), i18n("Write the text of the pages to <name>.txt"));
+    const QCommandLineOption wordsOption(QStringList() << QStringLiteral("w") << QStringLiteral("words"), i18n("Write the words of the pages with their positions to <name>.words.xml"));
+    const QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"), i18n("Directory the files are written to (default: the current directory)"), QStringLiteral("directory"));
+    const QCommandLineOption inputOption(QStringList() << QStringLiteral("i") << QStringLiteral("input"), i18n("Name the files after the paths of the documents relative to this directory, mirroring its subdirectories (default: the directory the documents have in common)"), QStringLiteral("directory"));
+    const QCommandLineOption jobsOption(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"), i18n("Number of documents processed at the same time (default: the number of processors)"), QStringLiteral("count"));
+    parser.addOption(pagesOption);
+    parser.addOption(sizeOption);
+    parser.addOption(textOption);
+    parser.addOption(wordsOption);
+    parser.addOption(outputOption);
+    parser.addOption(inputOption);
+    parser.addOption(jobsOption);
+    parser.addPositionalArgument(QStringLiteral("files"), i18n("Documents to process."));
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+    BatchOptions options;
+    if (parser.isSet(pagesOption) && !BatchOptions::parsePageRanges(parser.value(pagesOption), &options.pageRanges))
+    {
+        err << i18n("Invalid page ranges: %1", parser.value(pagesOption)) << endl;
+        return 2;
+    }
+    foreach (const QString &value, parser.values(sizeOption))
+    {
+        QSize size;
+        if (!BatchOptions::parseSize(value, &size))
+        {
+            err << i18n("Invalid size: %1", value) << endl;
+            return 2;
+        }
+        options.sizes << size;
+    }
+    options.text = parser.isSet(textOption);
+    options.words = parser.isSet(wordsOption);
+    options.outputDir = parser.isSet(outputOption) ? parser.value(outputOption) : QDir::currentPath();
+    if (!QDir().mkpath(options.outputDir))
+    {
+        err << i18n("Could not create %1", options.outputDir) << endl;
+        return 2;
+    }
+
+    int jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption))
+    {
+        bool ok;
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1)
+        {
+            err << i18n("Invalid number of jobs: %1", parser.value(jobsOption)) << endl;
+            return 2;
+        }
+    }
+
+    QStringList files;
+    foreach (const QString &arg, parser.positionalArguments())
+        files << QFileInfo(arg).absoluteFilePath();
+    files.removeDuplicates();
+    if (files.isEmpty())
+        parser.showHelp(2);
+    options.inputDir = parser.isSet(inputOption) ? QFileInfo(parser.value(inputOption)).absoluteFilePath() : commonDirectory(files);
+
+    if (jobs > 1 && files.count() > 1)
+    {
+        // the children get the same options, but process a single document
+        QStringList jobArguments;
+        if (parser.isSet(pagesOption))
+            jobArguments << QStringLiteral("--pages") << parser.value(pagesOption);
+        foreach (const QString &value, parser.values(sizeOption))
+            jobArguments << QStringLiteral("--size") << value;
+        if (options.text)
+            jobArguments << QStringLiteral("--text");
+        if (options.words)
+            jobArguments << QStringLiteral("--words");
+        jobArguments << QStringLiteral("--output") << options.outputDir << QStringLiteral("--input") << options.inputDir
+                     << QStringLiteral("--jobs") << QStringLiteral("1");
+
+        BatchRunner runner(files, jobArguments, jobs);
+        QObject::connect(&runner, &BatchRunner::finished, &app, &QCoreApplication::exit);
+        runner.start();
+        return app.exec();
+    }
+
+    Okular::Settings::instance(QStringLiteral("okularbatchrc"));
+
+    QTextStream out(stdout);
+    BatchJob job(options);
+    BatchStats stats;
+    QElapsedTimer total;
+    total.start();
+    foreach (const QString &file, files)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        ++stats.documents;
+        if (!job.run(file))
+        {
+            ++stats.failed;
+            err << file << ": " << job.errorString() << endl;
+            continue;
+        }
+        stats.pages += job.processedPages();
+        out << BatchStats::documentLine(file, job.processedPages(), timer.elapsed()) << endl;
+    }
+    if (files.count() > 1)
+        stats.print(total.elapsed());
+
+    return stats.failed == 0 ? 0 : 1;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
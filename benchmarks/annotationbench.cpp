@@ -0,0 +1,146 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QtXml/QDomDocument>
+
+#include "../core/annotations.h"
+#include "../core/document.h"
+#include "../core/page.h"
+#include "../settings_core.h"
+#include "fixtures.h"
+
+// annotations of each benchmark
+static const int AnnotationCount = 2000;
+
+class AnnotationBench : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+        void benchmarkStore();
+        void benchmarkLoad();
+        void benchmarkDocumentData_data();
+        void benchmarkDocumentData();
+
+    private:
+        static Okular::Annotation *createAnnotation( int number );
+
+        Fixtures *m_fixtures;
+};
+
+void AnnotationBench::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled( true );
+    Okular::SettingsCore::instance( QStringLiteral("annotationbench") );
+    m_fixtures = new Fixtures( 20 );
+    QVERIFY( m_fixtures->isValid() );
+}
+
+void AnnotationBench::cleanupTestCase()
+{
+    delete m_fixtures;
+}
+
+// alternately a note and a highlight, spread over the page
+Okular::Annotation *AnnotationBench::createAnnotation( int number )
+{
+    const double top = ( number % 50 ) / 50.0;
+    Okular::Annotation *annotation;
+    if ( number % 2 )
+    {
+        Okular::HighlightAnnotation *highlight = new Okular::HighlightAnnotation;
+        Okular::HighlightAnnotation::Quad quad;
+        quad.setPoint( Okular::NormalizedPoint( 0.1, top ), 0 );
+        quad.setPoint( Okular::NormalizedPoint( 0.9, top ), 1 );
+        quad.setPoint( Okular::NormalizedPoint( 0.9, top + 0.01 ), 2 );
+        quad.setPoint( Okular::NormalizedPoint( 0.1, top + 0.01 ), 3 );
+        highlight->highlightQuads().append( quad );
+        annotation = highlight;
+    }
+    else
+    {
+        Okular::TextAnnotation *note = new Okular::TextAnnotation;
+        note->setBoundingRectangle( Okular::NormalizedRect( 0.1, top, 0.15, top + 0.02 ) );
+        annotation = note;
+    }
+    annotation->setAuthor( QStringLiteral( "benchmark" ) );
+    annotation->setContents( QStringLiteral( "annotation %1" ).arg( number ) );
+    return annotation;
+}
+
+void AnnotationBench::benchmarkStore()
+{
+    QList< Okular::Annotation * > annotations;
+    for ( int i = 0; i < AnnotationCount; ++i )
+        annotations.append( createAnnotation( i ) );
+
+    QBENCHMARK {
+        QDomDocument document;
+        QDomElement root = document.createElement( QStringLiteral( "annotationList" ) );
+        document.appendChild( root );
+        foreach ( const Okular::Annotation *annotation, annotations )
+            Okular::AnnotationUtils::storeAnnotation( annotation, root, document );
+        document.toString();
+    }
+
+    qDeleteAll( annotations );
+}
+
+void AnnotationBench::benchmarkLoad()
+{
+    QDomDocument document;
+    QDomElement root = document.createElement( QStringLiteral( "annotationList" ) );
+    document.appendChild( root );
+    for ( int i = 0; i < AnnotationCount; ++i )
+    {
+        Okular::Annotation *annotation = createAnnotation( i );
+        Okular::AnnotationUtils::storeAnnotation( annotation, root, document );
+        delete annotation;
+    }
+    const QString xml = document.toString();
+
+    QBENCHMARK {
+        QDomDocument parsed;
+        parsed.setContent( xml );
+        QDomElement e = parsed.documentElement().firstChildElement();
+        for ( ; !e.isNull(); e = e.nextSiblingElement() )
+            delete Okular::AnnotationUtils::createAnnotation( e );
+    }
+}
+
+void AnnotationBench::benchmarkDocumentData_data()
+{
+    m_fixtures->addRows();
+}
+
+// opening loads the annotations from the document data, closing saves them
+void AnnotationBench::benchmarkDocumentData()
+{
+    QFETCH( QString, file );
+
+    Okular::Document document( 0 );
+    if ( !Fixtures::openDocument( &document, file ) )
+        QSKIP( "No generator for this format" );
+    if ( !document.isAllowed( Okular::AllowNotes ) )
+        QSKIP( "Annotations can't be added to this format" );
+
+    for ( int i = 0; i < AnnotationCount; ++i )
+        document.addPageAnnotation( i % document.pages(), createAnnotation( i ) );
+    document.closeDocument();
+
+    QBENCHMARK {
+        Fixtures::openDocument( &document, file );
+        document.closeDocument();
+    }
+}
+
+QTEST_MAIN( AnnotationBench )
+#include "annotationbench.moc"
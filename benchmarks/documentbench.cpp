@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "../core/document.h"
+#include "../core/generator.h"
+#include "../core/observer.h"
+#include "../core/page.h"
+#include "../settings_core.h"
+#include "fixtures.h"
+
+class DocumentBench : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+        void cleanup();
+        void benchmarkOpen_data();
+        void benchmarkOpen();
+        void benchmarkRender_data();
+        void benchmarkRender();
+        void benchmarkRenderTiles_data();
+        void benchmarkRenderTiles();
+
+    private:
+        bool renderPages( int width, int height, const Okular::NormalizedRect &tileRect = Okular::NormalizedRect() );
+
+        Fixtures *m_fixtures;
+        Okular::Document *m_document;
+        Okular::DocumentObserver *m_observer;
+};
+
+void DocumentBench::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled( true );
+    Okular::SettingsCore::instance( QStringLiteral("documentbench") );
+    m_fixtures = new Fixtures( 20 );
+    QVERIFY( m_fixtures->isValid() );
+
+    m_document = new Okular::Document( 0 );
+    m_observer = new Okular::DocumentObserver;
+    m_document->addObserver( m_observer );
+}
+
+void DocumentBench::cleanupTestCase()
+{
+    m_document->removeObserver( m_observer );
+    delete m_observer;
+    delete m_document;
+    delete m_fixtures;
+}
+
+void DocumentBench::cleanup()
+{
+    m_document->closeDocument();
+}
+
+void DocumentBench::benchmarkOpen_data()
+{
+    m_fixtures->addRows();
+}
+
+void DocumentBench::benchmarkOpen()
+{
+    QFETCH( QString, file );
+
+    if ( !Fixtures::openDocument( m_document, file ) )
+        QSKIP( "No generator for this format" );
+    m_document->closeDocument();
+
+    QBENCHMARK {
+        Fixtures::openDocument( m_document, file );
+        m_document->closeDocument();
+    }
+}
+
+// renders every page synchronously, the whole page or only @p tileRect of
+// it if it is not null; false if a pixmap is missing once requestPixmaps()
+// returned, e.g. because the request was dropped
+bool DocumentBench::renderPages( int width, int height, const Okular::NormalizedRect &tileRect )
+{
+    // pages above 8000000 pixels are rendered in tiles, and the document
+    // discards tiled requests without an area; it switches to tiles by
+    // itself, the tiles manager of the page being deleted below
+    const Okular::NormalizedRect rect = tileRect.isNull() ? Okular::NormalizedRect( 0, 0, 1, 1 ) : tileRect;
+    for ( uint i = 0; i < m_document->pages(); ++i )
+    {
+        Okular::Page *page = const_cast< Okular::Page * >( m_document->page( i ) );
+        page->deletePixmap( m_observer );
+
+        Okular::PixmapRequest *request = new Okular::PixmapRequest( m_observer, i, width, height, 1, Okular::PixmapRequest::NoFeature );
+        request->setNormalizedRect( rect );
+        m_document->requestPixmaps( QLinkedList< Okular::PixmapRequest * >() << request );
+
+        if ( !page->hasPixmap( m_observer, width, height, rect ) )
+            return false;
+    }
+    return true;
+}
+
+void DocumentBench::benchmarkRender_data()
+{
+    QTest::addColumn<QString>( "file" );
+    QTest::addColumn<double>( "zoom" );
+
+    const QVector<double> zooms = QVector<double>() << 0.5 << 1.0 << 2.0;
+    foreach ( const QString &file, m_fixtures->files() )
+    {
+        foreach ( const double zoom, zooms )
+        {
+            const QString name = QFileInfo( file ).suffix() + QStringLiteral(" x") + QString::number( zoom );
+            QTest::newRow( qPrintable( name ) ) << file << zoom;
+        }
+    }
+}
+
+void DocumentBench::benchmarkRender()
+{
+    QFETCH( QString, file );
+    QFETCH( double, zoom );
+
+    if ( !Fixtures::openDocument( m_document, file ) )
+        QSKIP( "No generator for this format" );
+
+    // the size of the pages at the zoom, in pixels at 72 dpi
+    const Okular::Page *page = m_document->page( 0 );
+    const int width = page->width() * zoom;
+    const int height = page->height() * zoom;
+
+    QBENCHMARK {
+        QVERIFY( renderPages( width, height ) );
+    }
+}
+
+void DocumentBench::benchmarkRenderTiles_data()
+{
+    m_fixtures->addRows();
+}
+
+void DocumentBench::benchmarkRenderTiles()
+{
+    QFETCH( QString, file );
+
+    if ( !Fixtures::openDocument( m_document, file ) )
+        QSKIP( "No generator for this format" );
+    if ( !m_document->supportsTiles() )
+        QSKIP( "The generator does not render tiles" );
+
+    // big enough for the document to split the pages in tiles, rendering
+    // the part of the page a window shows
+    const Okular::Page *page = m_document->page( 0 );
+    const int width = page->width() * 6;
+    const int height = page->height() * 6;
+    const Okular::NormalizedRect viewport( 0.25, 0.25, 0.5, 0.4 );
+
+    QBENCHMARK {
+        QVERIFY( renderPages( width, height, viewport ) );
+    }
+}
+
+QTEST_MAIN( DocumentBench )
+#include "documentbench.moc"
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "fixtures.h"
+
+#include <QtTest>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QLinearGradient>
+#include <QMimeDatabase>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QTextStream>
+
+#include "../core/document.h"
+
+const char *Fixtures::SearchWord = "okular";
+
+// lines of text per page of the generated documents
+static const int LinesPerPage = 50;
+
+// the text of the documents, always the same
+static QString line( int number )
+{
+    static const char * const words[] = {
+        "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+        "elit", "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore"
+    };
+    static const int wordCount = sizeof( words ) / sizeof( words[0] );
+
+    QString text;
+    quint32 seed = number * 2654435761u;
+    for ( int i = 0; i < 12; ++i )
+    {
+        seed = seed * 1103515245u + 12345u;
+        if ( i )
+            text += QLatin1Char( ' ' );
+        text += QLatin1String( words[ ( seed >> 16 ) % wordCount ] );
+    }
+    if ( number % 7 == 0 )
+        text += QLatin1Char( ' ' ) + QLatin1String( Fixtures::SearchWord );
+    return text;
+}
+
+Fixtures::Fixtures( int pages )
+{
+    if ( !m_dir.isValid() )
+        return;
+
+    const QString pdf = m_dir.filePath( QStringLiteral( "fixture.pdf" ) );
+    if ( createPdf( pdf, pages ) )
+        m_files << pdf;
+
+    const QString text = m_dir.filePath( QStringLiteral( "fixture.txt" ) );
+    if ( createText( text, pages ) )
+        m_files << text;
+
+    const QString image = m_dir.filePath( QStringLiteral( "fixture.png" ) );
+    if ( createImage( image ) )
+        m_files << image;
+}
+
+bool Fixtures::isValid() const
+{
+    return !m_files.isEmpty();
+}
+
+QStringList Fixtures::files() const
+{
+    return m_files;
+}
+
+void Fixtures::addRows() const
+{
+    QTest::addColumn<QString>( "file" );
+    foreach ( const QString &file, m_files )
+        QTest::newRow( qPrintable( QFileInfo( file ).suffix() ) ) << file;
+}
+
+bool Fixtures::openDocument( Okular::Document *document, const QString &file )
+{
+    const QMimeType mime = QMimeDatabase().mimeTypeForFile( file );
+    return document->openDocument( file, QUrl(), mime ) == Okular::Document::OpenSuccess;
+}
+
+bool Fixtures::createPdf( const QString &fileName, int pages )
+{
+    QPdfWriter writer( fileName );
+    writer.setPageSize( QPagedPaintDevice::A4 );
+    writer.setResolution( 72 );
+
+    QPainter painter;
+    if ( !painter.begin( &writer ) )
+        return false;
+
+    QFont font = painter.font();
+    font.setPointSize( 10 );
+    painter.setFont( font );
+    const int lineHeight = painter.fontMetrics().lineSpacing();
+
+    for ( int page = 0; page < pages; ++page )
+    {
+        if ( page )
+            writer.newPage();
+        for ( int i = 0; i < LinesPerPage; ++i )
+            painter.drawText( 0, ( i + 1 ) * lineHeight, line( page * LinesPerPage + i ) );
+    }
+    return painter.end();
+}
+
+bool Fixtures::createText( const QString &fileName, int pages )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    for ( int i = 0; i < pages * LinesPerPage; ++i )
+        stream << line( i ) << '\n';
+    return true;
+}
+
+bool Fixtures::createImage( const QString &fileName )
+{
+    QImage image( 2480, 3508, QImage::Format_RGB32 );
+    QLinearGradient gradient( 0, 0, image.width(), image.height() );
+    gradient.setColorAt( 0, Qt::white );
+    gradient.setColorAt( 1, Qt::darkBlue );
+
+    QPainter painter( &image );
+    painter.fillRect( image.rect(), gradient );
+    painter.end();
+
+    return image.save( fileName, "PNG" );
+}
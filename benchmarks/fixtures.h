@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef OKULAR_BENCHMARKS_FIXTURES_H
+#define OKULAR_BENCHMARKS_FIXTURES_H
+
+#include <QStringList>
+#include <QTemporaryDir>
+
+namespace Okular {
+class Document;
+}
+
+/**
+ * Documents generated for the benchmarks, one per format that can be
+ * written without the generators: PDF, plain text and PNG.
+ *
+ * The text of the documents is the same every time, and contains
+ * SearchWord every few lines.
+ */
+class Fixtures
+{
+    public:
+        explicit Fixtures( int pages );
+
+        bool isValid() const;
+
+        QStringList files() const;
+
+        /**
+         * Adds a "file" column to the current test data, with one row per
+         * generated document.
+         */
+        void addRows() const;
+
+        /**
+         * Opens @p file in @p document, which fails when no generator for
+         * its format is installed.
+         */
+        static bool openDocument( Okular::Document *document, const QString &file );
+
+        static const char *SearchWord;
+
+    private:
+        bool createPdf( const QString &fileName, int pages );
+        bool createText( const QString &fileName, int pages );
+        bool createImage( const QString &fileName );
+
+        QTemporaryDir m_dir;
+        QStringList m_files;
+};
+
+#endif
@@ -0,0 +1,219 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include "../core/document.h"
+#include "../core/page.h"
+#include "../core/textpage.h"
+#include "../settings_core.h"
+#include "fixtures.h"
+
+Q_DECLARE_METATYPE(Okular::Document::SearchStatus)
+
+class TextBench : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+        void cleanup();
+        void benchmarkTextPageGeneration_data();
+        void benchmarkTextPageGeneration();
+        void benchmarkCorrectTextOrder_data();
+        void benchmarkCorrectTextOrder();
+        void benchmarkPageFindText_data();
+        void benchmarkPageFindText();
+        void benchmarkFindNext_data();
+        void benchmarkFindNext();
+        void benchmarkFindAll_data();
+        void benchmarkFindAll();
+
+    private:
+        bool openWithText( const QString &file );
+        void search( Okular::Document::SearchType type, bool fromStart );
+
+        Fixtures *m_fixtures;
+        Okular::Document *m_document;
+};
+
+void TextBench::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled( true );
+    qRegisterMetaType<Okular::Document::SearchStatus>();
+    Okular::SettingsCore::instance( QStringLiteral("textbench") );
+    m_fixtures = new Fixtures( 50 );
+    QVERIFY( m_fixtures->isValid() );
+
+    m_document = new Okular::Document( 0 );
+}
+
+void TextBench::cleanupTestCase()
+{
+    delete m_document;
+    delete m_fixtures;
+}
+
+void TextBench::cleanup()
+{
+    m_document->closeDocument();
+}
+
+// opens @p file and extracts the text of all its pages
+bool TextBench::openWithText( const QString &file )
+{
+    if ( !Fixtures::openDocument( m_document, file ) || !m_document->supportsSearching() )
+        return false;
+
+    for ( uint i = 0; i < m_document->pages(); ++i )
+        m_document->requestTextPage( i );
+    return true;
+}
+
+// searches the fixture word, and waits for the search to end
+void TextBench::search( Okular::Document::SearchType type, bool fromStart )
+{
+    QSignalSpy spy( m_document, SIGNAL(searchFinished(int,Okular::Document::SearchStatus)) );
+    m_document->searchText( 1, QLatin1String( Fixtures::SearchWord ), fromStart, Qt::CaseInsensitive, type, false, Qt::yellow );
+    if ( spy.isEmpty() )
+        QVERIFY( spy.wait() );
+}
+
+void TextBench::benchmarkTextPageGeneration_data()
+{
+    m_fixtures->addRows();
+}
+
+void TextBench::benchmarkTextPageGeneration()
+{
+    QFETCH( QString, file );
+
+    if ( !Fixtures::openDocument( m_document, file ) || !m_document->supportsSearching() )
+        QSKIP( "No text for this format" );
+
+    QBENCHMARK {
+        for ( uint i = 0; i < m_document->pages(); ++i )
+        {
+            const_cast< Okular::Page * >( m_document->page( i ) )->setTextPage( 0 );
+            m_document->requestTextPage( i );
+        }
+    }
+}
+
+void TextBench::benchmarkCorrectTextOrder_data()
+{
+    QTest::addColumn<int>( "columns" );
+
+    QTest::newRow( "1 column" ) << 1;
+    QTest::newRow( "2 columns" ) << 2;
+    QTest::newRow( "3 columns" ) << 3;
+}
+
+void TextBench::benchmarkCorrectTextOrder()
+{
+    QFETCH( int, columns );
+
+    const int lines = 60;
+    const int wordsPerLine = 10;
+    const double columnWidth = 1.0 / columns;
+    const double wordWidth = columnWidth / ( wordsPerLine + 1 );
+    const double lineHeight = 1.0 / ( lines + 1 );
+
+    // Page::setTextPage() runs the layout analysis that puts the words of
+    // the columns back in reading order
+    QBENCHMARK {
+        Okular::TextPage *tp = new Okular::TextPage;
+        for ( int line = 0; line < lines; ++line )
+        {
+            for ( int column = 0; column < columns; ++column )
+            {
+                for ( int word = 0; word < wordsPerLine; ++word )
+                {
+                    const double left = column * columnWidth + word * wordWidth;
+                    const double top = line * lineHeight;
+                    tp->append( QStringLiteral( "word " ), new Okular::NormalizedRect( left, top, left + wordWidth * 0.9, top + lineHeight * 0.8 ) );
+                }
+            }
+        }
+
+        Okular::Page page( 0, 600, 800, Okular::Rotation0 );
+        page.setTextPage( tp );
+    }
+}
+
+void TextBench::benchmarkPageFindText_data()
+{
+    m_fixtures->addRows();
+}
+
+void TextBench::benchmarkPageFindText()
+{
+    QFETCH( QString, file );
+
+    if ( !openWithText( file ) )
+        QSKIP( "No text for this format" );
+
+    const QString word = QLatin1String( Fixtures::SearchWord );
+
+    // all the matches of every page, one after the other
+    QBENCHMARK {
+        for ( uint i = 0; i < m_document->pages(); ++i )
+        {
+            const Okular::Page *page = m_document->page( i );
+            Okular::RegularAreaRect *match = page->findText( 0, word, Okular::FromTop, Qt::CaseInsensitive );
+            while ( match )
+            {
+                Okular::RegularAreaRect *next = page->findText( 0, word, Okular::NextResult, Qt::CaseInsensitive, match );
+                delete match;
+                match = next;
+            }
+        }
+    }
+}
+
+void TextBench::benchmarkFindNext_data()
+{
+    m_fixtures->addRows();
+}
+
+void TextBench::benchmarkFindNext()
+{
+    QFETCH( QString, file );
+
+    if ( !openWithText( file ) )
+        QSKIP( "No text for this format" );
+
+    // the first match, then the next twenty ones
+    QBENCHMARK {
+        search( Okular::Document::NextMatch, true );
+        for ( int i = 0; i < 20; ++i )
+            search( Okular::Document::NextMatch, false );
+        m_document->resetSearch( 1 );
+    }
+}
+
+void TextBench::benchmarkFindAll_data()
+{
+    m_fixtures->addRows();
+}
+
+void TextBench::benchmarkFindAll()
+{
+    QFETCH( QString, file );
+
+    if ( !openWithText( file ) )
+        QSKIP( "No text for this format" );
+
+    QBENCHMARK {
+        search( Okular::Document::AllDocument, true );
+        m_document->resetSearch( 1 );
+    }
+}
+
+QTEST_MAIN( TextBench )
+#include "textbench.moc"
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "cachearbiter_p.h"
+
+#include "document_p.h"
+#include "page.h"
+
+using namespace Okular;
+
+CacheArbiter::CacheArbiter()
+{
+}
+
+CacheArbiter *CacheArbiter::instance()
+{
+    static CacheArbiter arbiter;
+    return &arbiter;
+}
+
+void CacheArbiter::registerDocument( DocumentPrivate *doc )
+{
+    if ( !m_documents.contains( doc ) )
+        m_documents.append( doc );
+}
+
+void CacheArbiter::unregisterDocument( DocumentPrivate *doc )
+{
+    m_documents.removeAll( doc );
+}
+
+void CacheArbiter::touch( DocumentPrivate *doc )
+{
+    if ( !m_documents.isEmpty() && m_documents.last() == doc )
+        return;
+
+    m_documents.removeAll( doc );
+    m_documents.append( doc );
+}
+
+qulonglong CacheArbiter::totalPixmapMemory() const
+{
+    qulonglong memory = 0;
+    foreach ( const DocumentPrivate *doc, m_documents )
+        memory += doc->m_allocatedPixmapsTotalMemory;
+    return memory;
+}
+
+qulonglong CacheArbiter::cleanupPixmapMemory( qulonglong memoryToFree, DocumentPrivate *spare )
+{
+    // freeing pixmaps doesn't change the order of the documents
+    foreach ( DocumentPrivate *doc, m_documents )
+    {
+        if ( memoryToFree == 0 )
+            break;
+        if ( doc == spare || doc->m_allocatedPixmapsTotalMemory == 0 )
+            continue;
+
+        memoryToFree = doc->freePixmapMemory( memoryToFree );
+    }
+    return memoryToFree;
+}
+
+void CacheArbiter::cleanupTextPages( int maxTextPages, const Page *keep )
+{
+    int textPages = 0;
+    foreach ( const DocumentPrivate *doc, m_documents )
+        textPages += doc->m_allocatedTextPagesFifo.count();
+
+    foreach ( DocumentPrivate *doc, m_documents )
+    {
+        while ( textPages > maxTextPages && !doc->m_allocatedTextPagesFifo.isEmpty() )
+        {
+            const int pageToKick = doc->m_allocatedTextPagesFifo.takeFirst();
+            --textPages;
+
+            Page *page = doc->m_pagesVector.value( pageToKick );
+            if ( page && page != keep )
+                page->setTextPage( 0 ); // deletes the textpage
+        }
+        if ( textPages <= maxTextPages )
+            break;
+    }
+}
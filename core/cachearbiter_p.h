@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_CACHEARBITER_P_H_
+#define _OKULAR_CACHEARBITER_P_H_
+
+#include <QtCore/QList>
+
+namespace Okular {
+
+class DocumentPrivate;
+class Page;
+
+/**
+ * Shares one pixmap and text page budget among all the documents of the
+ * process, eg the tabs of a shell.
+ *
+ * The documents are kept from the least to the most recently used one, and
+ * memory is reclaimed from the least recently used documents first, so the
+ * document being looked at keeps its pixmaps for as long as possible.
+ */
+class CacheArbiter
+{
+    public:
+        static CacheArbiter *instance();
+
+        void registerDocument( DocumentPrivate *doc );
+        void unregisterDocument( DocumentPrivate *doc );
+
+        /**
+         * Makes @p doc the most recently used document.
+         */
+        void touch( DocumentPrivate *doc );
+
+        /**
+         * The memory used by the pixmaps of all the documents.
+         */
+        qulonglong totalPixmapMemory() const;
+
+        /**
+         * Frees @p memoryToFree bytes of pixmaps, least recently used
+         * documents first, not touching the pixmaps of @p spare.
+         *
+         * Returns how many bytes could not be freed.
+         */
+        qulonglong cleanupPixmapMemory( qulonglong memoryToFree, DocumentPrivate *spare = 0 );
+
+        /**
+         * Deletes text pages, least recently used documents first, until
+         * there are at most @p maxTextPages of them, never deleting the one
+         * of @p keep.
+         */
+        void cleanupTextPages( int maxTextPages, const Page *keep = 0 );
+
+    private:
+        CacheArbiter();
+
+        QList< DocumentPrivate * > m_documents;
+};
+
+}
+
+#endif
@@ -28,9 +28,11 @@
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QMap>
+#include <QtCore/QRegularExpression>
 #include <QtCore/qtemporaryfile.h>
 #include <QtCore/QTextStream>
 #include <QtCore/QTimer>
+#include <QtCore/QXmlStreamReader>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QLabel>
 #include <QtPrintSupport/QPrinter>
@@ -64,8 +66,10 @@
 #include "audioplayer.h"
 #include "audioplayer_p.h"
 #include "bookmarkmanager.h"
+#include "cachearbiter_p.h"
 #include "chooseenginedialog_p.h"
 #include "debug_p.h"
+#include "documentinfowriter_p.h"
 #include "generator_p.h"
 #include "interfaces/configinterface.h"
 #include "interfaces/guiinterface.h"
@@ -76,6 +80,7 @@
 #include "page.h"
 #include "page_p.h"
 #include "pagecontroller_p.h"
+#include "rendertrace_p.h"
 #include "scripter.h"
 #include "settings_core.h"
 #include "sourcereference.h"
@@ -213,25 +218,28 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     qulonglong clipValue = 0;
     qulonglong memoryToFree = 0;
 
+    // the budget is shared by all the documents of the process
+    const qulonglong allocatedPixmapsTotalMemory = CacheArbiter::instance()->totalPixmapMemory();
+
     switch ( SettingsCore::memoryLevel() )
     {
         case SettingsCore::EnumMemoryLevel::Low:
-            memoryToFree = m_allocatedPixmapsTotalMemory;
+            memoryToFree = allocatedPixmapsTotalMemory;
             break;
 
         case SettingsCore::EnumMemoryLevel::Normal:
         {
             qulonglong thirdTotalMemory = getTotalMemory() / 3;
             qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > thirdTotalMemory) memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            if (allocatedPixmapsTotalMemory > thirdTotalMemory) memoryToFree = allocatedPixmapsTotalMemory - thirdTotalMemory;
+            if (allocatedPixmapsTotalMemory > freeMemory) clipValue = (allocatedPixmapsTotalMemory - freeMemory) / 2;
         }
         break;
 
         case SettingsCore::EnumMemoryLevel::Aggressive:
         {
             qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            if (allocatedPixmapsTotalMemory > freeMemory) clipValue = (allocatedPixmapsTotalMemory - freeMemory) / 2;
         }
         break;
         case SettingsCore::EnumMemoryLevel::Greedy:
@@ -239,7 +247,7 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
             qulonglong freeSwap;
             qulonglong freeMemory = getFreeMemory( &freeSwap );
             const qulonglong memoryLimit = qMin( qMax( freeMemory, getTotalMemory()/2 ), freeMemory+freeSwap );
-            if (m_allocatedPixmapsTotalMemory > memoryLimit) clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
+            if (allocatedPixmapsTotalMemory > memoryLimit) clipValue = (allocatedPixmapsTotalMemory - memoryLimit) / 2;
         }
         break;
     }
@@ -260,6 +268,14 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
     if ( memoryToFree < 1 )
         return;
 
+    CacheArbiter::instance()->cleanupPixmapMemory( memoryToFree );
+}
+
+qulonglong DocumentPrivate::freePixmapMemory( qulonglong memoryToFree )
+{
+    if ( memoryToFree < 1 || m_pagesVector.isEmpty() )
+        return memoryToFree;
+
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     // Create a QMap of visible rects, indexed by page number
@@ -339,6 +355,8 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
 
     m_allocatedPixmaps += pixmapsToKeep;
     //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
+
+    return memoryToFree;
 }
 
 /* Returns the next pixmap to evict from cache, or NULL if no suitable pixmap
@@ -531,60 +549,93 @@ void DocumentPrivate::loadDocumentInfo()
     if ( m_xmlFileName.isEmpty() )
         return;
 
+    // a save of the file may still be in progress
+    DocumentInfoWriter::instance()->waitForDone();
+
     QFile infoFile( m_xmlFileName );
     loadDocumentInfo( infoFile );
 }
 
+// reads the element @p reader is at, with its children, into an element of
+// @p doc, leaving @p reader at its end
+static QDomElement readDomElement( QXmlStreamReader &reader, QDomDocument &doc )
+{
+    QDomElement element = doc.createElement( reader.name().toString() );
+    foreach ( const QXmlStreamAttribute &attribute, reader.attributes() )
+        element.setAttribute( attribute.name().toString(), attribute.value().toString() );
+
+    while ( !reader.atEnd() )
+    {
+        reader.readNext();
+        if ( reader.isStartElement() )
+            element.appendChild( readDomElement( reader, doc ) );
+        // like QDomDocument::setContent(), drop the indentation
+        else if ( reader.isCharacters() && !reader.isWhitespace() )
+            element.appendChild( doc.createTextNode( reader.text().toString() ) );
+        else if ( reader.isEndElement() )
+            break;
+    }
+    return element;
+}
+
 void DocumentPrivate::loadDocumentInfo( QFile &infoFile )
 {
     if ( !infoFile.exists() || !infoFile.open( QIODevice::ReadOnly ) )
         return;
 
-    // Load DOM from XML file
-    QDomDocument doc( QStringLiteral("documentInfo") );
-    if ( !doc.setContent( &infoFile ) )
+    // Stream the XML file, building a DOM of one page at a time only, which
+    // is dropped once the page restored its contents
+    QXmlStreamReader reader( &infoFile );
+    if ( !reader.readNextStartElement() || reader.name() != QLatin1String("documentInfo") )
     {
         qCDebug(OkularCoreDebug) << "Can't load XML pair! Check for broken xml.";
         infoFile.close();
         return;
     }
-    infoFile.close();
 
-    QDomElement root = doc.documentElement();
-    if ( root.tagName() != QLatin1String("documentInfo") )
-        return;
-
-    // Parse the DOM tree
-    QDomNode topLevelNode = root.firstChild();
-    while ( topLevelNode.isElement() )
+    // the pages restoring many annotations notify their observers once
+    beginAnnotationBatch();
+    while ( reader.readNextStartElement() )
     {
-        QString catName = topLevelNode.toElement().tagName();
-
-        // Restore page attributes (bookmark, annotations, ...) from the DOM
-        if ( catName == QLatin1String("pageList") )
+        // Restore page attributes (bookmark, annotations, ...)
+        if ( reader.name() == QLatin1String("pageList") )
         {
-            QDomNode pageNode = topLevelNode.firstChild();
-            while ( pageNode.isElement() )
+            while ( reader.readNextStartElement() )
             {
-                QDomElement pageElement = pageNode.toElement();
-                if ( pageElement.hasAttribute( QStringLiteral("number") ) )
+                if ( reader.name() != QLatin1String("page") || !reader.attributes().hasAttribute( QStringLiteral("number") ) )
                 {
-                    // get page number (node's attribute)
-                    bool ok;
-                    int pageNumber = pageElement.attribute( QStringLiteral("number") ).toInt( &ok );
+                    reader.skipCurrentElement();
+                    continue;
+                }
 
-                    // pass the domElement to the right page, to read config data from
-                    if ( ok && pageNumber >= 0 && pageNumber < (int)m_pagesVector.count() )
-                        m_pagesVector[ pageNumber ]->d->restoreLocalContents( pageElement );
+                // get page number (node's attribute)
+                bool ok;
+                const int pageNumber = reader.attributes().value( QStringLiteral("number") ).toInt( &ok );
+                const bool pageLoaded = ok && pageNumber >= 0 && pageNumber < (int)m_pagesVector.count();
+                const bool pagePending = ok && pageNumber >= 0 && !pageLoaded && m_generator && m_generator->hasFeature( Generator::IncrementalPages );
+                if ( !pageLoaded && !pagePending )
+                {
+                    reader.skipCurrentElement();
+                    continue;
                 }
-                pageNode = pageNode.nextSibling();
+
+                QDomDocument pageDoc;
+                const QDomElement pageElement = readDomElement( reader, pageDoc );
+                // pass the domElement to the right page, to read config data from
+                if ( pageLoaded )
+                    m_pagesVector[ pageNumber ]->d->restoreLocalContents( pageElement );
+                // or keep it until the generator appends the page
+                else
+                    m_pendingPageElements.insert( pageNumber, pageElement );
             }
         }
 
-        // Restore 'general info' from the DOM
-        else if ( catName == QLatin1String("generalInfo") )
+        // Restore 'general info', it is small enough to be read as a DOM
+        else if ( reader.name() == QLatin1String("generalInfo") )
         {
-            QDomNode infoNode = topLevelNode.firstChild();
+            QDomDocument infoDoc;
+            const QDomElement generalInfo = readDomElement( reader, infoDoc );
+            QDomNode infoNode = generalInfo.firstChild();
             while ( infoNode.isElement() )
             {
                 QDomElement infoElement = infoNode.toElement();
@@ -646,8 +697,15 @@ void DocumentPrivate::loadDocumentInfo( QFile &infoFile )
             }
         }
 
-        topLevelNode = topLevelNode.nextSibling();
+        else
+            reader.skipCurrentElement();
     } // </documentInfo>
+    endAnnotationBatch();
+
+    // the pages read before a broken part of the file keep their contents
+    if ( reader.hasError() )
+        qCDebug(OkularCoreDebug) << "Can't load XML pair! Check for broken xml:" << reader.errorString();
+    infoFile.close();
 }
 
 void DocumentPrivate::loadViewsInfo( View *view, const QDomElement &e )
@@ -995,7 +1053,7 @@ void DocumentPrivate::performAddPageAnnotation( int page, Annotation * annotatio
     if ( annotation->flags() & Annotation::ExternallyDrawn )
     {
         // Redraw everything, including ExternallyDrawn annotations
-        refreshPixmaps( page );
+        refreshAnnotatedPixmaps( page );
     }
 
     warnLimitedAnnotSupport();
@@ -1032,7 +1090,7 @@ void DocumentPrivate::performRemovePageAnnotation( int page, Annotation * annota
         if ( isExternallyDrawn )
         {
             // Redraw everything, including ExternallyDrawn annotations
-            refreshPixmaps( page );
+            refreshAnnotatedPixmaps( page );
         }
     }
 
@@ -1075,7 +1133,7 @@ void DocumentPrivate::performModifyPageAnnotation( int page, Annotation * annota
 
         // Redraw everything, including ExternallyDrawn annotations
         qCDebug(OkularCoreDebug) << "Refreshing Pixmaps";
-        refreshPixmaps( page );
+        refreshAnnotatedPixmaps( page );
     }
 
     // If the user is moving or resizing the annotation, don't steal the focus
@@ -1119,60 +1177,151 @@ void DocumentPrivate::performSetAnnotationContents( const QString & newContents,
     performModifyPageAnnotation( pageNumber,  annot, appearanceChanged );
 }
 
-void DocumentPrivate::recalculateForms()
+// Works out which fields the script of a calculate action reads: every string
+// literal of the script is taken as a field name, unless fields are looked up
+// with names built at run time.
+static CalculateDependencies scanCalculateDependencies( const Action *action )
+{
+    CalculateDependencies dependencies;
+    if ( action->actionType() != Action::Script )
+        return dependencies;
+
+    const QString script = static_cast< const ScriptAction * >( action )->script();
+
+    // escapes and comments could make the literals below be split wrongly
+    if ( script.contains( QLatin1Char( '\\' ) ) || script.contains( QLatin1String( "//" ) ) || script.contains( QLatin1String( "/*" ) ) )
+        return dependencies;
+
+    static const QRegularExpression lookupRe( QStringLiteral( "getField\\s*\\(" ) );
+    static const QRegularExpression literalLookupRe( QStringLiteral( "getField\\s*\\(\\s*(\"[^\"\\\\]*\"|'[^'\\\\]*')\\s*\\)" ) );
+    if ( script.count( lookupRe ) != script.count( literalLookupRe ) )
+        return dependencies;
+
+    static const QRegularExpression literalRe( QStringLiteral( "(\\+\\s*)?(\"[^\"\\\\]*\"|'[^'\\\\]*')(\\s*\\+)?" ) );
+    QRegularExpressionMatchIterator it = literalRe.globalMatch( script );
+    while ( it.hasNext() )
+    {
+        const QRegularExpressionMatch match = it.next();
+        // a name concatenated to something else is only known at run time
+        if ( !match.captured( 1 ).isEmpty() || !match.captured( 3 ).isEmpty() )
+            return dependencies;
+
+        const QString literal = match.captured( 2 );
+        dependencies.fieldNames.append( literal.mid( 1, literal.length() - 2 ) );
+    }
+
+    dependencies.unknown = false;
+    return dependencies;
+}
+
+void DocumentPrivate::recalculateForms( const FormField *changedField )
 {
     const QVariant fco = m_parent->metaData(QLatin1String("FormCalculateOrder"));
     const QVector<int> formCalculateOrder = fco.value<QVector<int>>();
+    if ( formCalculateOrder.isEmpty() )
+        return;
+
+    buildFormFieldIndex();
+
+    // the calculate order lists every field after the ones it reads, so the
+    // fields recalculated are added to the changed ones as we go
+    QStringList changedNames;
+    if ( changedField )
+        changedNames.append( changedField->name() );
+
     foreach(int formId, formCalculateOrder) {
-        for ( uint pageIdx = 0; pageIdx  < m_parent->pages(); pageIdx++ )
+        foreach( FormField *form, m_formFieldsById.value( formId ) )
         {
-            const Page *p = m_parent->page( pageIdx );
-            if (p)
+            Action *action = form->additionalAction( FormField::CalculateField );
+            if (action)
             {
-                foreach( FormField *form, p->formFields() )
-                {
-                    if ( form->id() == formId ) {
-                        Action *action = form->additionalAction( FormField::CalculateField );
-                        if (action)
-                        {
-                            m_parent->processAction( action );
-                        }
-                        else
-                        {
-                            qWarning() << "Form that is part of calculate order doesn't have a calculate action";
-                        }
-                    }
-                }
+                if ( changedField && !calculateDependsOn( action, changedNames ) )
+                    continue;
+
+                m_parent->processAction( action );
+                changedNames.append( form->name() );
+            }
+            else
+            {
+                qWarning() << "Form that is part of calculate order doesn't have a calculate action";
             }
         }
     }
 }
 
+bool DocumentPrivate::calculateDependsOn( const Action *action, const QStringList &fieldNames )
+{
+    QHash< const Action *, CalculateDependencies >::iterator it = m_calculateDependencies.find( action );
+    if ( it == m_calculateDependencies.end() )
+        it = m_calculateDependencies.insert( action, scanCalculateDependencies( action ) );
+
+    if ( it->unknown )
+        return true;
+
+    foreach ( const QString &dependency, it->fieldNames )
+    {
+        foreach ( const QString &name, fieldNames )
+        {
+            // reading a field reads all its children too
+            if ( name == dependency || name.startsWith( dependency + QLatin1Char( '.' ) ) )
+                return true;
+        }
+    }
+    return false;
+}
+
+void DocumentPrivate::buildFormFieldIndex()
+{
+    if ( m_formFieldIndexBuilt )
+        return;
+
+    foreach ( Page *page, m_pagesVector )
+    {
+        foreach ( FormField *field, page->formFields() )
+        {
+            // the widgets of a field share its name, the first one stands for it
+            if ( !m_formFieldsByName.contains( field->name() ) )
+                m_formFieldsByName.insert( field->name(), qMakePair( field, page ) );
+            m_formFieldsById[ field->id() ].append( field );
+        }
+    }
+    m_formFieldIndexBuilt = true;
+}
+
+void DocumentPrivate::clearFormFieldIndex()
+{
+    m_formFieldsByName.clear();
+    m_formFieldsById.clear();
+    m_formFieldIndexBuilt = false;
+}
+
+FormField *DocumentPrivate::formFieldByName( const QString &name, Page **page )
+{
+    buildFormFieldIndex();
+
+    const QPair< FormField *, Page * > field = m_formFieldsByName.value( name, qMakePair< FormField *, Page * >( nullptr, nullptr ) );
+    if ( page )
+        *page = field.second;
+    return field.first;
+}
+
 void DocumentPrivate::saveDocumentInfo() const
 {
     if ( m_xmlFileName.isEmpty() )
         return;
 
-    QFile infoFile( m_xmlFileName );
     qCDebug(OkularCoreDebug) << "About to save document info to" << m_xmlFileName;
-    if (!infoFile.open( QIODevice::WriteOnly | QIODevice::Truncate))
-    {
-        qCWarning(OkularCoreDebug) << "Failed to open docdata file" << m_xmlFileName;
-        return;
 
-    }
-    // 1. Create DOM
+    // 1. Take a snapshot of the document info, the file is written by
+    // another thread
+    DocumentInfoSnapshot snapshot;
+    snapshot.fileName = m_xmlFileName;
+    snapshot.url = m_url.toDisplayString(QUrl::PreferLocalFile);
+
+    // the elements are created in a scratch document and kept serialized
     QDomDocument doc( QStringLiteral("documentInfo") );
-    QDomProcessingInstruction xmlPi = doc.createProcessingInstruction(
-            QStringLiteral( "xml" ), QStringLiteral( "version=\"1.0\" encoding=\"utf-8\"" ) );
-    doc.appendChild( xmlPi );
-    QDomElement root = doc.createElement( QStringLiteral("documentInfo") );
-    root.setAttribute( QStringLiteral("url"), m_url.toDisplayString(QUrl::PreferLocalFile) );
-    doc.appendChild( root );
-
-    // 2.1. Save page attributes (bookmark state, annotations, ... ) to DOM
-    QDomElement pageList = doc.createElement( QStringLiteral("pageList") );
-    root.appendChild( pageList );
+
+    // 2.1. Save page attributes (bookmark state, annotations, ... )
     PageItems saveWhat = AllPageItems;
     if ( m_annotationsNeedSaveAs )
     {
@@ -1182,14 +1331,42 @@ void DocumentPrivate::saveDocumentInfo() const
             * document's metadata, so that it appears that it was not changed */
         saveWhat |= OriginalAnnotationPageItems;
     }
-    // <page list><page number='x'>.... </page> save pages that hold data
+    if ( m_savedAnnotationsItems != saveWhat )
+    {
+        m_savedAnnotations.clear();
+        m_savedAnnotationsItems = saveWhat;
+    }
+    // <page list><page number='x'>.... </page> save pages that hold data;
+    // the annotations are serialized again only if they changed since the
+    // last save, the form values are always taken as they are cheap and
+    // can be changed by scripts
     QVector< Page * >::const_iterator pIt = m_pagesVector.constBegin(), pEnd = m_pagesVector.constEnd();
     for ( ; pIt != pEnd; ++pIt )
-        (*pIt)->d->saveLocalContents( pageList, doc, saveWhat );
+    {
+        DocumentInfoSnapshot::PageInfo pageInfo;
+        pageInfo.number = (*pIt)->number();
+
+        QHash< int, QString >::const_iterator annotIt = m_savedAnnotations.constFind( pageInfo.number );
+        if ( annotIt != m_savedAnnotations.constEnd() )
+        {
+            pageInfo.annotations = annotIt.value();
+        }
+        else
+        {
+            pageInfo.annotations = DocumentInfoSnapshot::serialize( (*pIt)->d->saveLocalAnnotations( doc, saveWhat ) );
+            m_savedAnnotations.insert( pageInfo.number, pageInfo.annotations );
+        }
+        pageInfo.forms = DocumentInfoSnapshot::serialize( (*pIt)->d->saveLocalForms( doc ) );
+
+        if ( !pageInfo.annotations.isEmpty() || !pageInfo.forms.isEmpty() )
+            snapshot.pages.append( pageInfo );
+    }
+    // keep the data of the pages the generator has not appended yet
+    Q_FOREACH ( const QDomElement &pageElement, m_pendingPageElements )
+        snapshot.pendingPages.append( DocumentInfoSnapshot::serialize( pageElement ) );
 
-    // 2.2. Save document info (current viewport, history, ... ) to DOM
+    // 2.2. Save document info (current viewport, history, ... )
     QDomElement generalInfo = doc.createElement( QStringLiteral("generalInfo") );
-    root.appendChild( generalInfo );
     // create rotation node
     if ( m_rotation != Rotation0 )
     {
@@ -1232,13 +1409,10 @@ void DocumentPrivate::saveDocumentInfo() const
         viewsNode.appendChild( viewEntry );
         saveViewsInfo( view, viewEntry );
     }
+    snapshot.generalInfo = DocumentInfoSnapshot::serialize( generalInfo );
 
-    // 3. Save DOM to XML file
-    QString xml = doc.toString();
-    QTextStream os( &infoFile );
-    os.setCodec( "UTF-8" );
-    os << xml;
-    infoFile.close();
+    // 3. Write the XML file atomically, off the GUI thread
+    DocumentInfoWriter::instance()->save( snapshot );
 }
 
 void DocumentPrivate::slotTimedMemoryCheck()
@@ -1255,8 +1429,13 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
      * next request, get the distance from the current viewport of the page
      * whose pixmap will be removed. We will ignore preload requests for pages
      * that are at the same distance or farther */
-    const qulonglong memoryToFree = calculateMemoryToFree();
+    qulonglong memoryToFree = calculateMemoryToFree();
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
+
+    // make room by trimming the other documents first
+    if ( memoryToFree )
+        memoryToFree = CacheArbiter::instance()->cleanupPixmapMemory( memoryToFree, this );
+
     int maxDistance = INT_MAX; // Default: No maximum
     if ( memoryToFree )
     {
@@ -1415,6 +1594,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         QRect requestRect = !request->isTile() ? QRect(0, 0, request->width(), request->height() ) : request->normalizedRect().geometry( request->width(), request->height() );
         qCDebug(OkularCoreDebug).nospace() << "sending request observer=" << request->observer() << " " <<requestRect.width() << "x" << requestRect.height() << "@" << request->pageNumber() << " async == " << request->asynchronous() << " isTile == " << request->isTile();
         m_pixmapRequestsStack.removeAll ( request );
+        RenderTrace::instance()->setQueueDepth( this, m_pixmapRequestsStack.count() );
 
         if ( tm )
             tm->setRequest( request->normalizedRect(), request->width(), request->height() );
@@ -1431,7 +1611,16 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // we can not really know if the generator can do async requests
         m_executingPixmapRequests.push_back( request );
         m_pixmapRequestsMutex.unlock();
+        request->d->mTimes.dispatched = RenderTrace::now();
         m_generator->generatePixmap( request );
+
+        // generators that draw several pages at once take the next
+        // request right away instead of when this one is done
+        m_pixmapRequestsMutex.lock();
+        const bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+        m_pixmapRequestsMutex.unlock();
+        if ( hasPixmaps && m_generator->canGeneratePixmap() )
+            QTimer::singleShot( 0, m_parent, SLOT(sendGeneratorPixmapRequest()) );
     }
     else
     {
@@ -1575,11 +1764,7 @@ void DocumentPrivate::_o_configChanged()
 {
     // free text pages if needed
     calculateMaxTextPages();
-    while (m_allocatedTextPagesFifo.count() > m_maxAllocatedTextPages)
-    {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
-    }
+    CacheArbiter::instance()->cleanupTextPages( m_maxAllocatedTextPages );
 }
 
 void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct)
@@ -2132,6 +2317,8 @@ Document::Document( QWidget *widget )
     d->m_viewportIterator = d->m_viewportHistory.insert( d->m_viewportHistory.end(), DocumentViewport() );
     d->m_undoStack = new QUndoStack(this);
 
+    CacheArbiter::instance()->registerDocument( d );
+
     connect( SettingsCore::self(), SIGNAL(configChanged()), this, SLOT(_o_configChanged()) );
     connect(d->m_undoStack, &QUndoStack::canUndoChanged, this, &Document::canUndoChanged);
     connect(d->m_undoStack, &QUndoStack::canRedoChanged, this, &Document::canRedoChanged);
@@ -2160,6 +2347,9 @@ Document::~Document()
         d->unloadGenerator( it.value() );
     d->m_loadedGenerators.clear();
 
+    CacheArbiter::instance()->unregisterDocument( d );
+    RenderTrace::instance()->removeDocument( d );
+
     // delete the private structure
     delete d;
 }
@@ -2457,7 +2647,15 @@ Document::OpenResult Document::openDocument(const QString & docFile, const QUrl
     {
         (*d->m_viewportIterator) = DocumentViewport();
         if ( loadedViewport.pageNumber >= (int)d->m_pagesVector.size() )
+        {
+            // go there once the generator appends the page, if it will
+            if ( d->m_generator->hasFeature( Generator::IncrementalPages ) )
+            {
+                d->m_pendingViewport = loadedViewport;
+                d->m_pendingViewportFallbackPage = d->m_pagesVector.size() - 1;
+            }
             loadedViewport.pageNumber = d->m_pagesVector.size() - 1;
+        }
     }
     else
         loadedViewport.pageNumber = 0;
@@ -2535,6 +2733,7 @@ void Document::closeDocument()
         delete *sIt;
     d->m_pixmapRequestsStack.clear();
     d->m_pixmapRequestsMutex.unlock();
+    RenderTrace::instance()->removeDocument( d );
 
     QEventLoop loop;
     bool startEventLoop = false;
@@ -2603,6 +2802,12 @@ void Document::closeDocument()
     delete d->m_archiveData;
     d->m_archiveData = 0;
     d->m_docSize = -1;
+    d->m_pendingPageElements.clear();
+    d->m_savedAnnotations.clear();
+    d->m_annotationBatchDepth = 0;
+    d->m_annotationBatchPages.clear();
+    d->m_annotationBatchRefreshedPages.clear();
+    d->m_pendingViewport = DocumentViewport();
     d->m_exportCached = false;
     d->m_exportFormats.clear();
     d->m_exportToText = ExportFormat();
@@ -2620,6 +2825,9 @@ void Document::closeDocument()
         delete *pIt;
     d->m_pagesVector.clear();
 
+    d->clearFormFieldIndex();
+    d->m_calculateDependencies.clear();
+
     // clear 'memory allocation' descriptors
     qDeleteAll( d->m_allocatedPixmaps );
     d->m_allocatedPixmaps.clear();
@@ -2697,6 +2905,9 @@ void Document::removeObserver( DocumentObserver * pObserver )
 
         // delete observer entry from the map
         d->m_observers.remove( pObserver );
+
+        // a new observer may get the same address
+        RenderTrace::instance()->removeObserver( pObserver );
     }
 }
 
@@ -2928,6 +3139,11 @@ bool Document::supportsTiles() const
     return d->m_generator ? d->m_generator->hasFeature( Generator::TiledRendering ) : false;
 }
 
+bool Document::isAppendingPages() const
+{
+    return d->m_generator ? d->m_generator->hasFeature( Generator::IncrementalPages ) : false;
+}
+
 PageSize::List Document::pageSizes() const
 {
     if ( d->m_generator )
@@ -3107,6 +3323,9 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
         return;
     }
 
+    // the document being drawn is the one looked at, keep its pixmaps longest
+    CacheArbiter::instance()->touch( d );
+
     // 1. [CLEAN STACK] remove previous requests of requesterID
     // FIXME This assumes all requests come from the same observer, that is true atm but not enforced anywhere
     DocumentObserver *requesterObserver = requests.first()->observer();
@@ -3175,6 +3394,8 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
         if ( !request->asynchronous() )
             request->d->mPriority = 0;
 
+        request->d->mTimes.queued = RenderTrace::now();
+
         // add request to the 'stack' at the right place
         if ( !request->priority() )
             // add priority zero requests to the top of the stack
@@ -3189,6 +3410,7 @@ void Document::requestPixmaps( const QLinkedList< PixmapRequest * > & requests,
             d->m_pixmapRequestsStack.insert( sIt, request );
         }
     }
+    RenderTrace::instance()->setQueueDepth( d, d->m_pixmapRequestsStack.count() );
     d->m_pixmapRequestsMutex.unlock();
 
     // 3. [START FIRST GENERATION] if <NO>generator is ready, start a new generation,
@@ -3214,12 +3436,54 @@ void DocumentPrivate::notifyAnnotationChanges( int page )
 {
     int flags = DocumentObserver::Annotations;
 
+    m_savedAnnotations.remove( page );
+    m_pagesVector[ page ]->d->annotationsChanged();
+
+    // the observers hear about the pages of a batch once it ends
+    if ( m_annotationBatchDepth > 0 )
+    {
+        m_annotationBatchPages.insert( page );
+        return;
+    }
+
     if ( m_annotationsNeedSaveAs )
         flags |= DocumentObserver::NeedSaveAs;
 
     foreachObserverD( notifyPageChanged( page, flags ) );
 }
 
+void DocumentPrivate::refreshAnnotatedPixmaps( int page )
+{
+    if ( m_annotationBatchDepth > 0 )
+        m_annotationBatchRefreshedPages.insert( page );
+    else
+        refreshPixmaps( page );
+}
+
+void DocumentPrivate::beginAnnotationBatch()
+{
+    ++m_annotationBatchDepth;
+}
+
+void DocumentPrivate::endAnnotationBatch()
+{
+    Q_ASSERT( m_annotationBatchDepth > 0 );
+    if ( --m_annotationBatchDepth > 0 )
+        return;
+
+    QList< int > pages = m_annotationBatchPages.toList();
+    qSort( pages );
+    m_annotationBatchPages.clear();
+    foreach ( int page, pages )
+        notifyAnnotationChanges( page );
+
+    pages = m_annotationBatchRefreshedPages.toList();
+    qSort( pages );
+    m_annotationBatchRefreshedPages.clear();
+    foreach ( int page, pages )
+        refreshPixmaps( page );
+}
+
 void Document::addPageAnnotation( int page, Annotation * annotation )
 {
     // Transform annotation's base boundary rectangle into unrotated coordinates
@@ -3342,12 +3606,34 @@ void Document::removePageAnnotation( int page, Annotation * annotation )
 
 void Document::removePageAnnotations( int page, const QList<Annotation*> &annotations )
 {
-    d->m_undoStack->beginMacro(i18nc("remove a collection of annotations from the page", "remove annotations"));
+    beginAnnotationBatch(i18nc("remove a collection of annotations from the page", "remove annotations"));
     foreach(Annotation* annotation, annotations)
     {
         QUndoCommand *uc = new RemoveAnnotationCommand(this->d, annotation, page);
         d->m_undoStack->push(uc);
     }
+    endAnnotationBatch();
+}
+
+void Document::addPageAnnotations( int page, const QList<Annotation*> &annotations )
+{
+    beginAnnotationBatch(i18nc("add a collection of annotations to the page", "add annotations"));
+    foreach(Annotation* annotation, annotations)
+        addPageAnnotation(page, annotation);
+    endAnnotationBatch();
+}
+
+void Document::beginAnnotationBatch( const QString &text )
+{
+    // the batch commands bracket the edits in the macro, so that undoing
+    // and redoing it are batched too
+    d->m_undoStack->beginMacro(text);
+    d->m_undoStack->push(new AnnotationBatchCommand(d, AnnotationBatchCommand::Begin));
+}
+
+void Document::endAnnotationBatch()
+{
+    d->m_undoStack->push(new AnnotationBatchCommand(d, AnnotationBatchCommand::End));
     d->m_undoStack->endMacro();
 }
 
@@ -3734,7 +4020,7 @@ void Document::editFormText( int pageNumber,
     QUndoCommand *uc = new EditFormTextCommand( this->d, form, pageNumber, newContents, newCursorPos, form->text(), prevCursorPos, prevAnchorPos );
     d->m_undoStack->push( uc );
 
-    d->recalculateForms();
+    d->recalculateForms( form );
 }
 
 void Document::editFormList( int pageNumber,
@@ -3745,7 +4031,7 @@ void Document::editFormList( int pageNumber,
     QUndoCommand *uc = new EditFormListCommand( this->d, form, pageNumber, newChoices, prevChoices );
     d->m_undoStack->push( uc );
 
-    d->recalculateForms();
+    d->recalculateForms( form );
 }
 
 void Document::editFormCombo( int pageNumber,
@@ -3769,7 +4055,7 @@ void Document::editFormCombo( int pageNumber,
     QUndoCommand *uc = new EditFormComboCommand( this->d, form, pageNumber, newText, newCursorPos, prevText, prevCursorPos, prevAnchorPos );
     d->m_undoStack->push( uc );
 
-    d->recalculateForms();
+    d->recalculateForms( form );
 }
 
 void Document::editFormButtons( int pageNumber, const QList< FormFieldButton* >& formButtons, const QList< bool >& newButtonStates )
@@ -4688,6 +4974,8 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
         m_allocatedPixmaps.append( memoryPage );
         m_allocatedPixmapsTotalMemory += memoryBytes;
 
+        RenderTrace::instance()->requestDone( req->d->mTimes, observer, req->pageNumber(), req->width(), req->height(), m_generatorName );
+
         // 2. notify an observer that its pixmap changed
         observer->notifyPageChanged( req->pageNumber(), DocumentObserver::Pixmap );
     }
@@ -4757,18 +5045,57 @@ void DocumentPrivate::textGenerationDone( Page *page )
 {
     if ( !m_pageController ) return;
 
-    // 1. If we reached the cache limit, delete the first text page from the fifo
-    if (m_allocatedTextPagesFifo.size() == m_maxAllocatedTextPages)
+    // 1. If we reached the cache limit, shared by all the documents, delete
+    // the oldest text pages of the least recently used documents
+    CacheArbiter::instance()->cleanupTextPages( m_maxAllocatedTextPages - 1, page );
+
+    // 2. Add the page to the fifo of generated text pages
+    m_allocatedTextPagesFifo.append( page->number() );
+}
+
+void DocumentPrivate::appendPages( const QVector< Page * > &pages )
+{
+    if ( pages.isEmpty() )
+        return;
+
+    const int firstPage = m_pagesVector.count();
+
+    // be quiet while restoring local annotations, like when opening
+    const bool showWarningLimitedAnnotSupport = m_showWarningLimitedAnnotSupport;
+    m_showWarningLimitedAnnotSupport = false;
+    beginAnnotationBatch();
+    foreach ( Page * p, pages )
     {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        if (pageToKick != page->number()) // this should never happen but better be safe than sorry
+        Q_ASSERT( p->number() == m_pagesVector.count() );
+        p->d->m_doc = this;
+        m_pagesVector.append( p );
+
+        QMap< int, QDomElement >::iterator it = m_pendingPageElements.find( p->number() );
+        if ( it != m_pendingPageElements.end() )
         {
-            m_pagesVector.at(pageToKick)->setTextPage( 0 ); // deletes the textpage
+            p->d->restoreLocalContents( it.value() );
+            m_pendingPageElements.erase( it );
         }
+
+        // like the pages that were there when the document was rotated
+        if ( m_rotation != Rotation0 )
+            p->d->rotateAt( m_rotation );
     }
+    endAnnotationBatch();
+    m_showWarningLimitedAnnotSupport = showWarningLimitedAnnotSupport;
+    clearFormFieldIndex();
 
-    // 2. Add the page to the fifo of generated text pages
-    m_allocatedTextPagesFifo.append( page->number() );
+    qCDebug(OkularCoreDebug) << "Appended pages" << firstPage << "to" << m_pagesVector.count() - 1;
+    foreachObserverD( notifySetup( m_pagesVector, DocumentObserver::PagesAdded ) );
+
+    // restore the saved viewport once its page exists, unless the user moved
+    // away from where the document was opened
+    if ( m_pendingViewport.isValid() && m_pendingViewport.pageNumber < m_pagesVector.count() )
+    {
+        if ( (*m_viewportIterator).pageNumber == m_pendingViewportFallbackPage )
+            m_parent->setViewport( m_pendingViewport );
+        m_pendingViewport = DocumentViewport();
+    }
 }
 
 void Document::setRotation( int r )
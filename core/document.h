@@ -347,6 +347,14 @@ class OKULARCORE_EXPORT Document : public QObject
          */
         bool supportsTiles() const;
 
+        /**
+         * Returns whether the generator is still going to append pages to the
+         * current document, see Generator::appendPages()
+         *
+         * @since 1.2
+         */
+        bool isAppendingPages() const;
+
         /**
          * Returns the list of supported page sizes or an empty list if this
          * feature is not available.
@@ -573,6 +581,32 @@ class OKULARCORE_EXPORT Document : public QObject
          */
         void removePageAnnotations( int page, const QList<Annotation*> &annotations );
 
+        /**
+         * Adds the given @p annotations to the given @p page, as one undo step.
+         *
+         * @since 1.2
+         */
+        void addPageAnnotations( int page, const QList<Annotation*> &annotations );
+
+        /**
+         * Starts a batch of annotation edits, to be ended by endAnnotationBatch().
+         *
+         * The edits made in between are undone and redone as a single step
+         * named @p text, and the observers are notified once per changed
+         * page when the batch ends, instead of after every edit. Batches can
+         * be nested, the outermost one counts.
+         *
+         * @since 1.2
+         */
+        void beginAnnotationBatch( const QString &text );
+
+        /**
+         * Ends the batch of annotation edits started by beginAnnotationBatch().
+         *
+         * @since 1.2
+         */
+        void endAnnotationBatch();
+
         /**
          * Sets the text selection for the given @p page.
          *
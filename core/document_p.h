@@ -21,6 +21,7 @@
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 #include <QtCore/QPointer>
+#include <QtXml/QDomElement>
 #include <QUrl>
 #include <KPluginMetaData>
 
@@ -41,6 +42,7 @@ struct RunningSearch;
 
 namespace Okular {
 class ConfigInterface;
+class FormField;
 class PageController;
 class SaveInterface;
 class Scripter;
@@ -66,6 +68,17 @@ namespace Okular {
 
 class FontExtractionThread;
 
+/**
+ * The fields read by the script of a calculate action.
+ */
+struct CalculateDependencies
+{
+    CalculateDependencies() : unknown( true ) {}
+
+    QStringList fieldNames;
+    bool unknown; // fields are looked up dynamically, so any of them may be read
+};
+
 struct DoContinueDirectionMatchSearchStruct
 {
     QSet< int > *pagesToNotify;
@@ -81,6 +94,8 @@ class DocumentPrivate
           : m_parent( parent ),
             m_tempFile( 0 ),
             m_docSize( -1 ),
+            m_pendingViewportFallbackPage( -1 ),
+            m_savedAnnotationsItems( 0 ),
             m_allocatedPixmapsTotalMemory( 0 ),
             m_maxAllocatedTextPages( 0 ),
             m_warnedOutOfMemory( false ),
@@ -95,10 +110,12 @@ class DocumentPrivate
             m_pageController( 0 ),
             m_closingLoop( 0 ),
             m_scripter( 0 ),
+            m_formFieldIndexBuilt( false ),
             m_archiveData( 0 ),
             m_fontsCached( false ),
             m_annotationEditingEnabled ( true ),
             m_annotationBeingModified( false ),
+            m_annotationBatchDepth( 0 ),
             m_synctex_scanner( 0 )
         {
             calculateMaxTextPages();
@@ -111,6 +128,7 @@ class DocumentPrivate
         qulonglong calculateMemoryToFree();
         void cleanupPixmapMemory();
         void cleanupPixmapMemory( qulonglong memoryToFree );
+        qulonglong freePixmapMemory( qulonglong memoryToFree );
         AllocatedPixmap * searchLowestPriorityPixmap( bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = 0 /* any */ );
         void calculateMaxTextPages();
         qulonglong getTotalMemory();
@@ -133,6 +151,9 @@ class DocumentPrivate
         bool savePageDocumentInfo( QTemporaryFile *infoFile, int what ) const;
         DocumentViewport nextDocumentViewport() const;
         void notifyAnnotationChanges( int page );
+        void refreshAnnotatedPixmaps( int page );
+        void beginAnnotationBatch();
+        void endAnnotationBatch();
         bool canAddAnnotationsNatively() const;
         bool canModifyExternalAnnotations() const;
         bool canRemoveExternalAnnotations() const;
@@ -145,7 +166,11 @@ class DocumentPrivate
         void performModifyPageAnnotation( int page, Annotation * annotation, bool appearanceChanged );
         void performSetAnnotationContents( const QString & newContents, Annotation *annot, int pageNumber );
 
-        void recalculateForms();
+        void recalculateForms( const FormField *changedField = nullptr );
+        bool calculateDependsOn( const Action *action, const QStringList &fieldNames );
+        void buildFormFieldIndex();
+        void clearFormFieldIndex();
+        FormField *formFieldByName( const QString &name, Page **page );
 
         // private slots
         void saveDocumentInfo() const;
@@ -174,6 +199,7 @@ class DocumentPrivate
          * Sets the bounding box of the given @p page (in terms of upright orientation, i.e., Rotation0).
          */
         void setPageBoundingBox( int page, const NormalizedRect& boundingBox );
+        void appendPages( const QVector< Page * > &pages );
 
         /**
          * Request a particular metadata of the Document itself (ie, not something
@@ -212,7 +238,16 @@ class DocumentPrivate
         QLinkedList< DocumentViewport > m_viewportHistory;
         QLinkedList< DocumentViewport >::iterator m_viewportIterator;
         DocumentViewport m_nextDocumentViewport; // see Link::Goto for an explanation
+        // the saved data of pages the generator has not appended yet, and the
+        // saved viewport if it is on one of them, along with the page shown instead
+        QMap< int, QDomElement > m_pendingPageElements;
+        DocumentViewport m_pendingViewport;
+        int m_pendingViewportFallbackPage;
         QString m_nextDocumentDestination;
+        // the serialized local annotations of the pages, saved again only
+        // when they change, and the page items they were saved with
+        mutable QHash< int, QString > m_savedAnnotations;
+        mutable int m_savedAnnotationsItems;
 
         // observers / requests / allocator stuff
         QSet< DocumentObserver * > m_observers;
@@ -261,6 +296,12 @@ class DocumentPrivate
 
         Scripter *m_scripter;
 
+        // the form fields of the pages by name and by id, built on first use
+        QHash< QString, QPair< FormField *, Page * > > m_formFieldsByName;
+        QHash< int, QVector< FormField * > > m_formFieldsById;
+        bool m_formFieldIndexBuilt;
+        QHash< const Action *, CalculateDependencies > m_calculateDependencies;
+
         ArchiveData *m_archiveData;
         QString m_archivedFileName;
 
@@ -275,6 +316,11 @@ class DocumentPrivate
         bool m_annotationEditingEnabled;
         bool m_annotationsNeedSaveAs;
         bool m_annotationBeingModified; // is an annotation currently being moved or resized?
+        // while annotations are edited in a batch, the pages to notify and
+        // to refresh when it ends
+        int m_annotationBatchDepth;
+        QSet< int > m_annotationBatchPages;
+        QSet< int > m_annotationBatchRefreshedPages;
         bool m_showWarningLimitedAnnotSupport;
 
         QUndoStack *m_undoStack;
@@ -24,6 +24,10 @@ void moveViewportIfBoundingRectNotFullyVisible( Okular::NormalizedRect boundingR
                                                 DocumentPrivate *docPriv,
                                                 int pageNumber )
 {
+    // a batch can edit annotations all over the document
+    if ( docPriv->m_annotationBatchDepth > 0 )
+        return;
+
     const Rotation pageRotation = docPriv->m_parent->page( pageNumber )->rotation();
     const QTransform rotationMatrix = Okular::buildRotationMatrix( pageRotation );
     boundingRect.transform( rotationMatrix );
@@ -56,6 +60,29 @@ Okular::NormalizedRect buildBoundingRectangleForButtons( const QList<Okular::For
     return boundingRect;
 }
 
+AnnotationBatchCommand::AnnotationBatchCommand( Okular::DocumentPrivate * docPriv, Bracket bracket )
+ : m_docPriv( docPriv ),
+   m_bracket( bracket )
+{
+}
+
+void AnnotationBatchCommand::undo()
+{
+    if ( m_bracket == End )
+        m_docPriv->beginAnnotationBatch();
+    else
+        m_docPriv->endAnnotationBatch();
+}
+
+void AnnotationBatchCommand::redo()
+{
+    if ( m_bracket == Begin )
+        m_docPriv->beginAnnotationBatch();
+    else
+        m_docPriv->endAnnotationBatch();
+}
+
+
 AddAnnotationCommand::AddAnnotationCommand( Okular::DocumentPrivate * docPriv,  Okular::Annotation* annotation, int pageNumber )
  : m_docPriv( docPriv ),
    m_annotation( annotation ),
@@ -24,6 +24,26 @@ class FormFieldText;
 class FormFieldButton;
 class FormFieldChoice;
 
+/**
+ * Brackets the commands of a batch of annotation edits in their undo macro,
+ * so that undoing and redoing the macro are batched too.
+ */
+class AnnotationBatchCommand : public QUndoCommand
+{
+    public:
+        enum Bracket { Begin, End };
+
+        AnnotationBatchCommand( Okular::DocumentPrivate * docPriv, Bracket bracket );
+
+        void undo() override;
+
+        void redo() override;
+
+    private:
+        Okular::DocumentPrivate * m_docPriv;
+        Bracket m_bracket;
+};
+
 class AddAnnotationCommand : public QUndoCommand
 {
     public:
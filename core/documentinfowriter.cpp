@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "documentinfowriter_p.h"
+
+// qt/kde includes
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QXmlStreamReader>
+#include <QtCore/QXmlStreamWriter>
+#include <QtXml/QDomElement>
+
+// local includes
+#include "debug_p.h"
+
+using namespace Okular;
+
+QString DocumentInfoSnapshot::serialize( const QDomElement &element )
+{
+    QString xml;
+    if ( element.isNull() )
+        return xml;
+
+    QTextStream stream( &xml );
+    element.save( stream, -1 );
+    return xml;
+}
+
+// copies the element serialized in @p xml to @p writer
+static void writeSerialized( QXmlStreamWriter &writer, const QString &xml )
+{
+    if ( xml.isEmpty() )
+        return;
+
+    QXmlStreamReader reader( xml );
+    while ( !reader.atEnd() )
+    {
+        reader.readNext();
+        if ( reader.isStartDocument() || reader.isEndDocument() || reader.isDTD() )
+            continue;
+        writer.writeCurrentToken( reader );
+    }
+}
+
+
+DocumentInfoWriter::DocumentInfoWriter()
+    : m_writing( false ), m_quit( false )
+{
+}
+
+DocumentInfoWriter::~DocumentInfoWriter()
+{
+    // write what is left before going away
+    m_mutex.lock();
+    m_quit = true;
+    m_queueChanged.wakeAll();
+    m_mutex.unlock();
+    wait();
+}
+
+DocumentInfoWriter *DocumentInfoWriter::instance()
+{
+    static DocumentInfoWriter writer;
+    return &writer;
+}
+
+void DocumentInfoWriter::save( const DocumentInfoSnapshot &snapshot )
+{
+    QMutexLocker locker( &m_mutex );
+
+    // only the latest contents of a file matter
+    QList< DocumentInfoSnapshot >::iterator it = m_queue.begin(), itEnd = m_queue.end();
+    for ( ; it != itEnd; ++it )
+    {
+        if ( it->fileName == snapshot.fileName )
+        {
+            *it = snapshot;
+            return;
+        }
+    }
+    m_queue.append( snapshot );
+    m_queueChanged.wakeAll();
+
+    if ( !isRunning() )
+        start( QThread::LowPriority );
+}
+
+void DocumentInfoWriter::waitForDone()
+{
+    QMutexLocker locker( &m_mutex );
+    while ( !m_queue.isEmpty() || m_writing )
+        m_queueChanged.wait( &m_mutex );
+}
+
+void DocumentInfoWriter::run()
+{
+    QMutexLocker locker( &m_mutex );
+    forever
+    {
+        while ( m_queue.isEmpty() && !m_quit )
+            m_queueChanged.wait( &m_mutex );
+        if ( m_queue.isEmpty() )
+            break;
+
+        const DocumentInfoSnapshot snapshot = m_queue.takeFirst();
+        m_writing = true;
+        locker.unlock();
+
+        write( snapshot );
+
+        locker.relock();
+        m_writing = false;
+        m_queueChanged.wakeAll();
+    }
+}
+
+bool DocumentInfoWriter::write( const DocumentInfoSnapshot &snapshot )
+{
+    QSaveFile infoFile( snapshot.fileName );
+    if ( !infoFile.open( QIODevice::WriteOnly ) )
+    {
+        qCWarning(OkularCoreDebug) << "Failed to open docdata file" << snapshot.fileName;
+        return false;
+    }
+
+    QXmlStreamWriter writer( &infoFile );
+    writer.setCodec( "UTF-8" );
+    writer.setAutoFormatting( true );
+    writer.writeStartDocument();
+    writer.writeDTD( QStringLiteral( "<!DOCTYPE documentInfo>" ) );
+    writer.writeStartElement( QStringLiteral( "documentInfo" ) );
+    writer.writeAttribute( QStringLiteral( "url" ), snapshot.url );
+
+    // <page list><page number='x'>.... </page> the pages that hold data
+    writer.writeStartElement( QStringLiteral( "pageList" ) );
+    foreach ( const DocumentInfoSnapshot::PageInfo &page, snapshot.pages )
+    {
+        writer.writeStartElement( QStringLiteral( "page" ) );
+        writer.writeAttribute( QStringLiteral( "number" ), QString::number( page.number ) );
+        writeSerialized( writer, page.annotations );
+        writeSerialized( writer, page.forms );
+        writer.writeEndElement();
+    }
+    foreach ( const QString &page, snapshot.pendingPages )
+        writeSerialized( writer, page );
+    writer.writeEndElement();
+
+    writeSerialized( writer, snapshot.generalInfo );
+
+    writer.writeEndElement();
+    writer.writeEndDocument();
+
+    // the previous file stays in place unless the new one is complete
+    if ( writer.hasError() || !infoFile.commit() )
+    {
+        qCWarning(OkularCoreDebug) << "Failed to write docdata file" << snapshot.fileName;
+        return false;
+    }
+    return true;
+}
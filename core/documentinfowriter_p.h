@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_DOCUMENTINFOWRITER_P_H_
+#define _OKULAR_DOCUMENTINFOWRITER_P_H_
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+class QDomElement;
+
+namespace Okular {
+
+/**
+ * The contents of a docdata file, taken on the GUI thread so that it can be
+ * written from another one. The elements are kept serialized.
+ */
+struct DocumentInfoSnapshot
+{
+    struct PageInfo
+    {
+        int number;
+        QString annotations;    // the <annotationList> element, if any
+        QString forms;          // the <forms> element, if any
+    };
+
+    static QString serialize( const QDomElement &element );
+
+    QString fileName;
+    QString url;
+    QVector< PageInfo > pages;
+    QStringList pendingPages;   // <page> elements of pages not loaded yet
+    QString generalInfo;        // the <generalInfo> element
+};
+
+/**
+ * Writes the docdata files in a thread of its own, in the order they were
+ * saved, and atomically so that a crash never leaves a truncated file.
+ */
+class DocumentInfoWriter : public QThread
+{
+    public:
+        static DocumentInfoWriter *instance();
+
+        ~DocumentInfoWriter();
+
+        /**
+         * Queues @p snapshot for writing, replacing a queued snapshot of the
+         * same file if it was not written yet.
+         */
+        void save( const DocumentInfoSnapshot &snapshot );
+
+        /**
+         * Blocks until the queued snapshots are written.
+         */
+        void waitForDone();
+
+        /**
+         * Writes @p snapshot right away, returns whether it succeeded.
+         */
+        static bool write( const DocumentInfoSnapshot &snapshot );
+
+    protected:
+        void run() override;
+
+    private:
+        DocumentInfoWriter();
+
+        QMutex m_mutex;
+        QWaitCondition m_queueChanged;
+        QList< DocumentInfoSnapshot > m_queue;
+        bool m_writing;
+        bool m_quit;
+};
+
+}
+
+#endif
@@ -102,7 +102,9 @@ void GeneratorPrivate::pixmapGenerationFinished()
     }
 
     const QImage& img = mPixmapGenerationThread->image();
-    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
+    QPixmap *pixmap = new QPixmap( QPixmap::fromImage( img ) );
+    PixmapRequestPrivate::get( request )->mTimes.converted = RenderTrace::now();
+    request->page()->setPixmap( request->observer(), pixmap, request->normalizedRect() );
     const int pageNumber = request->page()->number();
 
     if ( mPixmapGenerationThread->calcBoundingBox() )
@@ -258,7 +260,11 @@ void Generator::generatePixmap( PixmapRequest *request )
     }
 
     const QImage& img = image( request );
-    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( img ) ), request->normalizedRect() );
+    PixmapRequestPrivate *requestPrivate = PixmapRequestPrivate::get( request );
+    requestPrivate->mTimes.rendered = RenderTrace::now();
+    QPixmap *pixmap = new QPixmap( QPixmap::fromImage( img ) );
+    requestPrivate->mTimes.converted = RenderTrace::now();
+    request->page()->setPixmap( request->observer(), pixmap, request->normalizedRect() );
     const int pageNumber = request->page()->number();
 
     d->mPixmapReady = true;
@@ -463,6 +469,15 @@ void Generator::updatePageBoundingBox( int page, const NormalizedRect & bounding
         d->m_document->setPageBoundingBox( page, boundingBox );
 }
 
+void Generator::appendPages( const QVector< Page * > & pages )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->appendPages( pages );
+    else
+        qDeleteAll( pages );
+}
+
 void Generator::requestFontData(const Okular::FontInfo & /*font*/, QByteArray * /*data*/)
 {
 
@@ -567,6 +582,11 @@ const NormalizedRect& PixmapRequest::normalizedRect() const
     return d->mNormalizedRect;
 }
 
+PixmapRequestPrivate *PixmapRequestPrivate::get( const PixmapRequest *req )
+{
+    return req->d;
+}
+
 Okular::TilesManager* PixmapRequestPrivate::tilesManager() const
 {
     return mPage->d->tilesManager(mObserver);
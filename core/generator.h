@@ -208,7 +208,8 @@ class OKULARCORE_EXPORT Generator : public QObject
             PrintNative,       ///< Whether the Generator supports native cross-platform printing (QPainter-based).
             PrintPostscript,   ///< Whether the Generator supports postscript-based file printing.
             PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
-            TiledRendering     ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+            TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
+            IncrementalPages   ///< Whether the Generator is still going to append pages to the loaded document, see appendPages() @since 1.2
         };
 
         /**
@@ -556,6 +557,19 @@ class OKULARCORE_EXPORT Generator : public QObject
          */
         void updatePageBoundingBox( int page, const NormalizedRect & boundingBox );
 
+        /**
+         * Appends @p pages to the pages of the document after it has been loaded,
+         * for generators which paginate the document in the background. The
+         * Document takes the ownership of the pages, and notifies its observers.
+         *
+         * The generator has to have the IncrementalPages feature while it is going
+         * to append pages, so that the Document keeps the data of the pages that
+         * do not exist yet.
+         *
+         * @since 1.2
+         */
+        void appendPages( const QVector< Page * > & pages );
+
         /**
          * Returns DPI, previously set via setDPI()
          * @since 0.19 (KDE 4.13)
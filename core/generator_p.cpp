@@ -62,6 +62,7 @@ void PixmapGenerationThread::run()
     if ( mRequest )
     {
         mImage = mGenerator->image( mRequest );
+        PixmapRequestPrivate::get( mRequest )->mTimes.rendered = RenderTrace::now();
         if ( mCalcBoundingBox )
             mBoundingBox = Utils::imageBoundingBox( &mImage );
     }
@@ -11,6 +11,7 @@
 #define OKULAR_THREADEDGENERATOR_P_H
 
 #include "area.h"
+#include "rendertrace_p.h"
 
 #include <QtCore/QSet>
 #include <QtCore/QThread>
@@ -75,6 +76,8 @@ class PixmapRequestPrivate
         void swap();
         TilesManager *tilesManager() const;
 
+        static PixmapRequestPrivate *get( const PixmapRequest *req );
+
         DocumentObserver *mObserver;
         int mPageNumber;
         int mWidth;
@@ -85,6 +88,7 @@ class PixmapRequestPrivate
         bool mTile : 1;
         Page *mPage;
         NormalizedRect mNormalizedRect;
+        RenderTimestamps mTimes;
 };
 
 
@@ -53,7 +53,8 @@ class OKULARCORE_EXPORT DocumentObserver
          */
         enum SetupFlags {
             DocumentChanged = 1,    ///< The document is a new document.
-            NewLayoutForPages = 2   ///< All the pages have
+            NewLayoutForPages = 2,  ///< All the pages have
+            PagesAdded = 4          ///< Pages have been appended to the document, see Generator::appendPages() @since 1.2
         };
 
         /**
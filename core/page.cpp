@@ -10,9 +10,11 @@
 #include "page_p.h"
 
 // qt/kde includes
+#include <QtCore/QAtomicInt>
 #include <QtCore/QHash>
 #include <QtCore/QSet>
 #include <QtCore/QString>
+#include <QtCore/QTextStream>
 #include <QtCore/QVariant>
 #include <QtCore/QUuid>
 #include <QtGui/QPixmap>
@@ -73,6 +75,8 @@ PagePrivate::PagePrivate( Page *page, uint n, double w, double h, Rotation o )
       m_openingAction( 0 ), m_closingAction( 0 ), m_duration( -1 ),
       m_isBoundingBoxKnown( false )
 {
+    annotationsChanged();
+
     // avoid Division-By-Zero problems in the program
     if ( m_width <= 0 )
         m_width = 1;
@@ -121,6 +125,12 @@ void PagePrivate::imageRotationDone( RotationJob * job )
     }
 }
 
+void PagePrivate::annotationsChanged()
+{
+    static QAtomicInt lastRevision;
+    m_annotationsRevision = lastRevision.fetchAndAddRelaxed( 1 ) + 1;
+}
+
 QTransform PagePrivate::rotationMatrix() const
 {
     return Okular::buildRotationMatrix( m_rotation );
@@ -365,6 +375,7 @@ void PagePrivate::rotateAt( Rotation orientation )
 
     Rotation oldRotation = m_rotation;
     m_rotation = orientation;
+    annotationsChanged();
 
     /**
      * Rotate the images of the page.
@@ -420,6 +431,7 @@ void PagePrivate::changeSize( const PageSize &size )
     m_height = size.height();
     if ( m_rotation % 2 )
         qSwap( m_width, m_height );
+    annotationsChanged();
 }
 
 const ObjectRect * Page::objectRect( ObjectRect::ObjectType type, double x, double y, double xScale, double yScale ) const
@@ -650,6 +662,7 @@ void Page::addAnnotation( Annotation * annotation )
     annotation->d_ptr->annotationTransform( matrix );
 
     m_rects.append( rect );
+    d->annotationsChanged();
 }
 
 bool Page::removeAnnotation( Annotation * annotation )
@@ -674,6 +687,7 @@ bool Page::removeAnnotation( Annotation * annotation )
             qCDebug(OkularCoreDebug) << "removed annotation:" << annotation->uniqueName();
             annotation->d_ptr->m_page = 0;
             m_annotations.erase( aIt );
+            d->annotationsChanged();
             break;
         }
     }
@@ -787,6 +801,7 @@ void Page::deleteAnnotations()
     for ( ; aIt != aEnd; ++aIt )
         delete *aIt;
     m_annotations.clear();
+    d->annotationsChanged();
 }
 
 void PagePrivate::restoreLocalContents( const QDomNode & pageNode )
@@ -805,9 +820,13 @@ void PagePrivate::restoreLocalContents( const QDomNode & pageNode )
             QTime time;
             time.start();
 #endif
-            // Clone annotationList as root node in restoredLocalAnnotationList
-            const QDomNode clonedNode = restoredLocalAnnotationList.importNode( childElement, true );
-            restoredLocalAnnotationList.appendChild( clonedNode );
+            // Keep annotationList serialized in restoredLocalAnnotationList,
+            // it is only parsed again if it has to be saved as it was
+            if ( restoredLocalAnnotationList.isEmpty() )
+            {
+                QTextStream stream( &restoredLocalAnnotationList );
+                childElement.save( stream, -1 );
+            }
 
             // iterate over all annotations
             QDomNode annotationNode = childElement.firstChild();
@@ -873,34 +892,16 @@ void PagePrivate::restoreLocalContents( const QDomNode & pageNode )
     }
 }
 
-void PagePrivate::saveLocalContents( QDomNode & parentNode, QDomDocument & document, PageItems what ) const
+QDomElement PagePrivate::saveLocalAnnotations( QDomDocument & document, PageItems what ) const
 {
-    // create the page node and set the 'number' attribute
-    QDomElement pageElement = document.createElement( QStringLiteral("page") );
-    pageElement.setAttribute( QStringLiteral("number"), m_number );
-
-#if 0
-    // add bookmark info if is bookmarked
-    if ( d->m_bookmarked )
-    {
-        // create the pageElement's 'bookmark' child
-        QDomElement bookmarkElement = document.createElement( "bookmark" );
-        pageElement.appendChild( bookmarkElement );
-
-        // add attributes to the element
-        //bookmarkElement.setAttribute( "name", bookmark name );
-    }
-#endif
-
     // add annotations info if has got any
     if ( ( what & AnnotationPageItems ) && ( what & OriginalAnnotationPageItems ) )
     {
-        const QDomElement savedDocRoot = restoredLocalAnnotationList.documentElement();
-        if ( !savedDocRoot.isNull() )
+        QDomDocument savedDoc;
+        if ( !restoredLocalAnnotationList.isEmpty() && savedDoc.setContent( restoredLocalAnnotationList ) )
         {
-            // Import and append node in target document
-            const QDomNode importedNode = document.importNode( savedDocRoot, true );
-            pageElement.appendChild( importedNode );
+            // Import the node in target document
+            return document.importNode( savedDoc.documentElement(), true ).toElement();
         }
     }
     else if ( ( what & AnnotationPageItems ) && !m_page->m_annotations.isEmpty() )
@@ -925,37 +926,73 @@ void PagePrivate::saveLocalContents( QDomNode & parentNode, QDomDocument & docum
             }
         }
 
-        // append the annotationList element if annotations have been set
+        // return the annotationList element if annotations have been set
         if ( annotListElement.hasChildNodes() )
-            pageElement.appendChild( annotListElement );
+            return annotListElement;
     }
 
-    // add forms info if has got any
-    if ( ( what & FormFieldPageItems ) && !formfields.isEmpty() )
+    return QDomElement();
+}
+
+QDomElement PagePrivate::saveLocalForms( QDomDocument & document ) const
+{
+    if ( formfields.isEmpty() )
+        return QDomElement();
+
+    // create the formList
+    QDomElement formListElement = document.createElement( QStringLiteral("forms") );
+
+    // add every form data to the formList
+    QLinkedList< FormField * >::const_iterator fIt = formfields.constBegin(), fItEnd = formfields.constEnd();
+    for ( ; fIt != fItEnd; ++fIt )
     {
-        // create the formList
-        QDomElement formListElement = document.createElement( QStringLiteral("forms") );
+        // get the form field
+        const FormField * f = *fIt;
+
+        QString newvalue = f->d_ptr->value();
+        if ( f->d_ptr->m_default == newvalue )
+            continue;
+
+        // append an filled-up element called 'form' to the list
+        QDomElement formElement = document.createElement( QStringLiteral("form") );
+        formElement.setAttribute( QStringLiteral("id"), f->id() );
+        formElement.setAttribute( QStringLiteral("value"), newvalue );
+        formListElement.appendChild( formElement );
+    }
 
-        // add every form data to the formList
-        QLinkedList< FormField * >::const_iterator fIt = formfields.constBegin(), fItEnd = formfields.constEnd();
-        for ( ; fIt != fItEnd; ++fIt )
-        {
-            // get the form field
-            const FormField * f = *fIt;
+    // return the formList element if some fields have been changed
+    if ( formListElement.hasChildNodes() )
+        return formListElement;
+    return QDomElement();
+}
 
-            QString newvalue = f->d_ptr->value();
-            if ( f->d_ptr->m_default == newvalue )
-                continue;
+void PagePrivate::saveLocalContents( QDomNode & parentNode, QDomDocument & document, PageItems what ) const
+{
+    // create the page node and set the 'number' attribute
+    QDomElement pageElement = document.createElement( QStringLiteral("page") );
+    pageElement.setAttribute( QStringLiteral("number"), m_number );
 
-            // append an filled-up element called 'annotation' to the list
-            QDomElement formElement = document.createElement( QStringLiteral("form") );
-            formElement.setAttribute( QStringLiteral("id"), f->id() );
-            formElement.setAttribute( QStringLiteral("value"), newvalue );
-            formListElement.appendChild( formElement );
-        }
+#if 0
+    // add bookmark info if is bookmarked
+    if ( d->m_bookmarked )
+    {
+        // create the pageElement's 'bookmark' child
+        QDomElement bookmarkElement = document.createElement( "bookmark" );
+        pageElement.appendChild( bookmarkElement );
 
-        // append the annotationList element if annotations have been set
-        if ( formListElement.hasChildNodes() )
+        // add attributes to the element
+        //bookmarkElement.setAttribute( "name", bookmark name );
+    }
+#endif
+
+    const QDomElement annotListElement = saveLocalAnnotations( document, what );
+    if ( !annotListElement.isNull() )
+        pageElement.appendChild( annotListElement );
+
+    if ( what & FormFieldPageItems )
+    {
+        const QDomElement formListElement = saveLocalForms( document );
+        if ( !formListElement.isNull() )
             pageElement.appendChild( formListElement );
     }
 
@@ -63,6 +63,12 @@ class PagePrivate
         void imageRotationDone( RotationJob * job );
         QTransform rotationMatrix() const;
 
+        /**
+         * Gives the annotations of the page a new revision, for the painters
+         * caching them. Revisions are never reused, not even by other pages.
+         */
+        void annotationsChanged();
+
         /**
          * Loads the local contents (e.g. annotations) of the page.
          */
@@ -73,6 +79,18 @@ class PagePrivate
          */
         void saveLocalContents( QDomNode & parentNode, QDomDocument & document, PageItems what = AllPageItems ) const;
 
+        /**
+         * Creates the element holding the local annotations of the page,
+         * a null element if there are none.
+         */
+        QDomElement saveLocalAnnotations( QDomDocument & document, PageItems what = AllPageItems ) const;
+
+        /**
+         * Creates the element holding the values of the changed form
+         * fields of the page, a null element if there are none.
+         */
+        QDomElement saveLocalForms( QDomDocument & document ) const;
+
         /**
          * Rotates the image and object rects of the page to the given @p orientation.
          */
@@ -143,7 +161,8 @@ class PagePrivate
         QString m_label;
 
         bool m_isBoundingBoxKnown : 1;
-        QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
+        QString restoredLocalAnnotationList; // <annotationList>...</annotationList>
+        int m_annotationsRevision;
 };
 
 }
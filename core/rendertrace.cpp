@@ -0,0 +1,294 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "rendertrace_p.h"
+
+// qt/kde includes
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QObject>
+
+#include <string.h>
+
+// local includes
+#include "cachearbiter_p.h"
+#include "observer.h"
+
+using namespace Okular;
+
+// past this many events the trace is not recorded any more, it takes
+// about a hundred bytes of JSON per event
+static const int MaxTraceEvents = 1000000;
+
+static const char * const stageNames[ RenderTrace::StageCount ] = {
+    "queued", "rendered", "converted", "delivered", "painted"
+};
+
+static QString formatMsecs( qint64 usecs )
+{
+    return QString::number( usecs / 1000.0, 'f', 1 );
+}
+
+LatencyHistogram::LatencyHistogram()
+    : m_count( 0 ), m_total( 0 ), m_max( 0 )
+{
+    memset( m_buckets, 0, sizeof( m_buckets ) );
+}
+
+void LatencyHistogram::add( qint64 usecs )
+{
+    // bucket i counts the latencies below 2^i microseconds not counted by
+    // the previous buckets
+    int bucket = 0;
+    while ( bucket < Buckets - 1 && ( Q_INT64_C( 1 ) << bucket ) <= usecs )
+        ++bucket;
+
+    ++m_buckets[ bucket ];
+    ++m_count;
+    m_total += usecs;
+    m_max = qMax( m_max, usecs );
+}
+
+int LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::mean() const
+{
+    return m_count ? m_total / m_count : 0;
+}
+
+qint64 LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+qint64 LatencyHistogram::percentile( double fraction ) const
+{
+    const int wanted = qMax( 1, qRound( fraction * m_count ) );
+    int seen = 0;
+    for ( int i = 0; i < Buckets; ++i )
+    {
+        seen += m_buckets[ i ];
+        if ( seen >= wanted )
+            return qMin( Q_INT64_C( 1 ) << i, m_max );
+    }
+    return m_max;
+}
+
+
+RenderTrace::RenderTrace()
+    : m_traceFileName( QFile::decodeName( qgetenv( "OKULAR_RENDER_TRACE" ) ) )
+{
+}
+
+RenderTrace::~RenderTrace()
+{
+    if ( !m_traceFileName.isEmpty() )
+        writeTrace( m_traceFileName );
+}
+
+RenderTrace *RenderTrace::instance()
+{
+    static RenderTrace trace;
+    return &trace;
+}
+
+static QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+qint64 RenderTrace::now()
+{
+    static const QElapsedTimer clock = startedTimer();
+    return clock.nsecsElapsed();
+}
+
+void RenderTrace::requestDone( const RenderTimestamps &times, const DocumentObserver *observer, int page,
+                               int width, int height, const QString &generator )
+{
+    const qint64 end = now();
+
+    // generators that reimplement generatePixmap() do not tell when they
+    // are done rendering, the whole generation counts as rendering then
+    const qint64 rendered = times.rendered ? times.rendered : end;
+    const qint64 converted = times.converted ? times.converted : rendered;
+
+    QMutexLocker locker( &m_mutex );
+    if ( times.queued && times.dispatched )
+        record( Queued, times.queued, times.dispatched, observer, page, width, height, generator );
+    if ( times.dispatched )
+        record( Rendered, times.dispatched, rendered, observer, page, width, height, generator );
+    if ( times.rendered && times.converted )
+        record( Converted, rendered, converted, observer, page, width, height, generator );
+    record( Delivered, converted, end, observer, page, width, height, generator );
+}
+
+void RenderTrace::setQueueDepth( const void *document, int depth )
+{
+    QMutexLocker locker( &m_mutex );
+    m_queueDepths[ document ] = depth;
+}
+
+void RenderTrace::removeDocument( const void *document )
+{
+    QMutexLocker locker( &m_mutex );
+    m_queueDepths.remove( document );
+}
+
+void RenderTrace::removeObserver( const DocumentObserver *observer )
+{
+    QMutexLocker locker( &m_mutex );
+    for ( int stage = 0; stage < StageCount; ++stage )
+        m_observerHistograms[ stage ].remove( observer );
+    m_paintHits.remove( observer );
+    m_paintMisses.remove( observer );
+}
+
+void RenderTrace::paintDone( const DocumentObserver *observer, int page, qint64 start, bool hit )
+{
+    const qint64 end = now();
+
+    QMutexLocker locker( &m_mutex );
+    record( Painted, start, end, observer, page, 0, 0, QString() );
+    if ( hit )
+        ++m_paintHits[ observer ];
+    else
+        ++m_paintMisses[ observer ];
+}
+
+QStringList RenderTrace::report( const DocumentObserver *observer ) const
+{
+    const qulonglong memory = CacheArbiter::instance()->totalPixmapMemory();
+
+    QMutexLocker locker( &m_mutex );
+    int queueDepth = 0;
+    foreach ( const int depth, m_queueDepths )
+        queueDepth += depth;
+    const int hits = m_paintHits.value( observer );
+    const int paints = hits + m_paintMisses.value( observer );
+
+    QStringList lines;
+    lines << QStringLiteral( "queue %1, pixmaps %2 MiB, cache hits %3%" )
+                 .arg( queueDepth ).arg( memory / ( 1024 * 1024 ) ).arg( paints ? 100 * hits / paints : 100 );
+
+    for ( int stage = 0; stage < StageCount; ++stage )
+    {
+        const LatencyHistogram histogram = m_observerHistograms[ stage ].value( observer );
+        if ( !histogram.count() )
+            continue;
+        lines << QStringLiteral( "%1: p50 %2 ms, p90 %3 ms, max %4 ms (%5)" )
+                     .arg( QLatin1String( stageNames[ stage ] ) )
+                     .arg( formatMsecs( histogram.percentile( 0.5 ) ), formatMsecs( histogram.percentile( 0.9 ) ),
+                           formatMsecs( histogram.max() ) )
+                     .arg( histogram.count() );
+    }
+
+    QHash< QString, LatencyHistogram >::const_iterator it = m_generatorHistograms[ Rendered ].constBegin(), itEnd = m_generatorHistograms[ Rendered ].constEnd();
+    for ( ; it != itEnd; ++it )
+    {
+        lines << QStringLiteral( "%1 rendered: p50 %2 ms, p90 %3 ms, mean %4 ms (%5)" )
+                     .arg( it.key() )
+                     .arg( formatMsecs( it.value().percentile( 0.5 ) ), formatMsecs( it.value().percentile( 0.9 ) ),
+                           formatMsecs( it.value().mean() ) )
+                     .arg( it.value().count() );
+    }
+    return lines;
+}
+
+bool RenderTrace::writeTrace( const QString &fileName ) const
+{
+    QMutexLocker locker( &m_mutex );
+
+    // every stage gets its own track
+    const int pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for ( int stage = 0; stage < StageCount; ++stage )
+    {
+        QJsonObject args;
+        args.insert( QStringLiteral( "name" ), QLatin1String( stageNames[ stage ] ) );
+        QJsonObject event;
+        event.insert( QStringLiteral( "name" ), QStringLiteral( "thread_name" ) );
+        event.insert( QStringLiteral( "ph" ), QStringLiteral( "M" ) );
+        event.insert( QStringLiteral( "pid" ), pid );
+        event.insert( QStringLiteral( "tid" ), stage );
+        event.insert( QStringLiteral( "args" ), args );
+        events.append( event );
+    }
+
+    foreach ( const Event &e, m_events )
+    {
+        QJsonObject args;
+        args.insert( QStringLiteral( "page" ), e.page + 1 );
+        if ( e.width > 0 )
+        {
+            args.insert( QStringLiteral( "width" ), e.width );
+            args.insert( QStringLiteral( "height" ), e.height );
+        }
+        args.insert( QStringLiteral( "observer" ), QLatin1String( e.observer ) );
+        if ( !e.generator.isEmpty() )
+            args.insert( QStringLiteral( "generator" ), e.generator );
+
+        QJsonObject event;
+        event.insert( QStringLiteral( "name" ), QLatin1String( stageNames[ e.stage ] ) );
+        event.insert( QStringLiteral( "cat" ), QStringLiteral( "pixmap" ) );
+        event.insert( QStringLiteral( "ph" ), QStringLiteral( "X" ) );
+        event.insert( QStringLiteral( "ts" ), e.start / 1000.0 );
+        event.insert( QStringLiteral( "dur" ), e.duration / 1000.0 );
+        event.insert( QStringLiteral( "pid" ), pid );
+        event.insert( QStringLiteral( "tid" ), int( e.stage ) );
+        event.insert( QStringLiteral( "args" ), args );
+        events.append( event );
+    }
+
+    QJsonObject trace;
+    trace.insert( QStringLiteral( "traceEvents" ), events );
+    trace.insert( QStringLiteral( "displayTimeUnit" ), QStringLiteral( "ms" ) );
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+    return file.write( QJsonDocument( trace ).toJson( QJsonDocument::Compact ) ) != -1;
+}
+
+void RenderTrace::record( Stage stage, qint64 start, qint64 end, const DocumentObserver *observer, int page,
+                          int width, int height, const QString &generator )
+{
+    const qint64 duration = qMax( end - start, Q_INT64_C( 0 ) );
+    if ( !generator.isEmpty() )
+        m_generatorHistograms[ stage ][ generator ].add( duration / 1000 );
+    m_observerHistograms[ stage ][ observer ].add( duration / 1000 );
+
+    if ( m_traceFileName.isEmpty() || m_events.count() >= MaxTraceEvents )
+        return;
+
+    Event e;
+    e.stage = stage;
+    e.start = start;
+    e.duration = duration;
+    e.page = page;
+    e.width = width;
+    e.height = height;
+    e.observer = observerName( observer );
+    e.generator = generator;
+    m_events.append( e );
+}
+
+const char *RenderTrace::observerName( const DocumentObserver *observer )
+{
+    // the observers of the part are widgets, the other ones share a name
+    const QObject *object = dynamic_cast< const QObject * >( observer );
+    return object ? object->metaObject()->className() : "DocumentObserver";
+}
@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_RENDERTRACE_P_H_
+#define _OKULAR_RENDERTRACE_P_H_
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular {
+
+class DocumentObserver;
+
+/**
+ * When a pixmap request reached each stage, 0 for the stages it skipped.
+ */
+struct RenderTimestamps
+{
+    RenderTimestamps()
+        : queued( 0 ), dispatched( 0 ), rendered( 0 ), converted( 0 )
+    {
+    }
+
+    qint64 queued;
+    qint64 dispatched;
+    qint64 rendered;
+    qint64 converted;
+};
+
+/**
+ * Latencies in microseconds, counted in power of two buckets.
+ */
+class LatencyHistogram
+{
+    public:
+        LatencyHistogram();
+
+        void add( qint64 usecs );
+
+        int count() const;
+        qint64 mean() const;
+        qint64 max() const;
+
+        /**
+         * The upper bound of the bucket the @p fraction percentile falls in.
+         */
+        qint64 percentile( double fraction ) const;
+
+    private:
+        enum { Buckets = 32 };
+        int m_buckets[ Buckets ];
+        int m_count;
+        qint64 m_total;
+        qint64 m_max;
+};
+
+/**
+ * Follows the pixmap requests from the moment they are queued to the
+ * moment their pixmaps are painted, and aggregates the time they spend in
+ * every stage in histograms per generator and per observer.
+ *
+ * If the OKULAR_RENDER_TRACE environment variable names a file, every
+ * request is also written to it in the Chrome trace event format when the
+ * application quits; it can be opened with chrome://tracing or Perfetto.
+ */
+class RenderTrace
+{
+    public:
+        enum Stage
+        {
+            Queued,      ///< from requestPixmaps() to the generator
+            Rendered,    ///< the generator rendering the image
+            Converted,   ///< the conversion of the image to a pixmap
+            Delivered,   ///< from the pixmap to the document taking it
+            Painted,     ///< an observer painting a page
+            StageCount
+        };
+
+        OKULARCORE_EXPORT static RenderTrace *instance();
+
+        ~RenderTrace();
+
+        /**
+         * A monotonic timestamp in nanoseconds, safe to take in any thread.
+         */
+        OKULARCORE_EXPORT static qint64 now();
+
+        /**
+         * Records the stages of a request of @p observer for @p page,
+         * rendered by @p generator, once the document received its pixmap.
+         */
+        void requestDone( const RenderTimestamps &times, const DocumentObserver *observer, int page,
+                          int width, int height, const QString &generator );
+
+        /**
+         * Records the number of requests waiting in the queue of @p document.
+         */
+        void setQueueDepth( const void *document, int depth );
+        void removeDocument( const void *document );
+
+        /**
+         * Forgets the statistics of @p observer, which is going away.
+         */
+        void removeObserver( const DocumentObserver *observer );
+
+        /**
+         * Records that @p observer painted @p page since @p start, with the
+         * pixmap of the right size if @p hit, else with a scaled one.
+         */
+        OKULARCORE_EXPORT void paintDone( const DocumentObserver *observer, int page, qint64 start, bool hit );
+
+        /**
+         * The statistics of the requests of @p observer as text lines, for
+         * an overlay.
+         */
+        OKULARCORE_EXPORT QStringList report( const DocumentObserver *observer ) const;
+
+        /**
+         * Writes the recorded events in the Chrome trace event format.
+         */
+        bool writeTrace( const QString &fileName ) const;
+
+    private:
+        RenderTrace();
+
+        struct Event
+        {
+            Stage stage;
+            qint64 start;
+            qint64 duration;
+            int page;
+            int width;
+            int height;
+            const char *observer;
+            QString generator;
+        };
+
+        void record( Stage stage, qint64 start, qint64 end, const DocumentObserver *observer, int page,
+                     int width, int height, const QString &generator );
+        static const char *observerName( const DocumentObserver *observer );
+
+        mutable QMutex m_mutex;
+        QHash< QString, LatencyHistogram > m_generatorHistograms[ StageCount ];
+        QHash< const DocumentObserver *, LatencyHistogram > m_observerHistograms[ StageCount ];
+        QHash< const DocumentObserver *, int > m_paintHits;
+        QHash< const DocumentObserver *, int > m_paintMisses;
+        QHash< const void *, int > m_queueDepths;
+        QString m_traceFileName;
+        QVector< Event > m_events;
+};
+
+}
+
+#endif
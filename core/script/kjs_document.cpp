@@ -188,18 +188,11 @@ static KJSObject docGetField( KJSContext *context, void *object,
 
     QString cName = arguments.at( 0 ).toString( context );
 
-    QVector< Page * >::const_iterator pIt = doc->m_pagesVector.constBegin(), pEnd = doc->m_pagesVector.constEnd();
-    for ( ; pIt != pEnd; ++pIt )
+    Page *page = 0;
+    FormField *field = doc->formFieldByName( cName, &page );
+    if ( field )
     {
-        const QLinkedList< Okular::FormField * > pageFields = (*pIt)->formFields();
-        QLinkedList< Okular::FormField * >::const_iterator ffIt = pageFields.constBegin(), ffEnd = pageFields.constEnd();
-        for ( ; ffIt != ffEnd; ++ffIt )
-        {
-            if ( (*ffIt)->name() == cName )
-            {
-                return JSField::wrapField( context, *ffIt, *pIt );
-            }
-        }
+        return JSField::wrapField( context, field, page );
     }
     return KJSUndefined();
 }
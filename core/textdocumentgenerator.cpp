@@ -14,7 +14,9 @@
 #include <QtCore/QMutex>
 #include <QtCore/QStack>
 #include <QtCore/QTextStream>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
+#include <QtCore/qmath.h>
 #include <QtGui/QFontDatabase>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
@@ -28,8 +30,20 @@
 
 #include "document.h"
 
+#include <algorithm>
+#include <climits>
+
 using namespace Okular;
 
+// documents with more characters than this are paginated in the background
+static const int StreamingCharacterCount = 512 * 1024;
+// the pages laid out before handing the document out
+static const int InitialPages = 10;
+// how long the layout of the background pagination can block the event loop, in msecs
+static const int PaginationSliceTime = 20;
+// how often the pages laid out in the background are handed out, in msecs
+static const int PublicationInterval = 1000;
+
 /**
  * Generic Converter Implementation
  */
@@ -80,39 +94,74 @@ TextDocumentGenerator* TextDocumentConverter::generator() const
  */
 Okular::TextPage* TextDocumentGeneratorPrivate::createTextPage( int pageNumber ) const
 {
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     Q_Q( const TextDocumentGenerator );
-#endif
 
     Okular::TextPage *textPage = new Okular::TextPage;
 
     int start, end;
 
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->lock();
-#endif
     TextDocumentUtils::calculatePositions( mDocument, pageNumber, start, end );
 
-    {
-    QTextCursor cursor( mDocument );
-    for ( int i = start; i < end - 1; ++i ) {
-        cursor.setPosition( i );
-        cursor.setPosition( i + 1, QTextCursor::KeepAnchor );
-
-        QString text = cursor.selectedText();
-        if ( text.length() == 1 ) {
-            QRectF rect;
-            TextDocumentUtils::calculateBoundingRect( mDocument, i, i + 1, rect, pageNumber );
-            if ( pageNumber == -1 )
-                text = QStringLiteral("\n");
-
-            textPage->append( text, new Okular::NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) );
+    const QSizeF pageSize = mDocument->pageSize();
+    const QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+
+    // walk the blocks and their lines along with the characters, instead of
+    // looking them up again for every character
+    QTextBlock block = mDocument->findBlock( start );
+    QRectF blockRect = layout->blockBoundingRect( block );
+    QString blockText = block.text();
+    int line = 0;
+
+    QTextBlock nextBlock = block.next();
+    QRectF nextBlockRect = nextBlock.isValid() ? layout->blockBoundingRect( nextBlock ) : QRectF();
+
+    for ( int i = start; i < end - 1 && block.isValid(); ++i ) {
+        while ( block.isValid() && i >= block.position() + block.length() ) {
+            block = nextBlock;
+            blockRect = nextBlockRect;
+            blockText = block.text();
+            line = 0;
+            nextBlock = block.next();
+            nextBlockRect = nextBlock.isValid() ? layout->blockBoundingRect( nextBlock ) : QRectF();
         }
+        if ( !block.isValid() )
+            break;
+
+        const int pos = i - block.position();
+        QString text = pos < blockText.length() ? QString( blockText.at( pos ) ) : QString( mDocument->characterAt( i ) );
+
+        QRectF rect;
+        int page = -1;
+        const QTextLayout *blockLayout = block.layout();
+        const bool endInBlock = i + 1 < block.position() + block.length();
+        const QTextLayout *endLayout = endInBlock ? blockLayout : nextBlock.layout();
+        if ( blockLayout && blockLayout->lineCount() > 0 && endLayout && endLayout->lineCount() > 0 ) {
+            // the lines of pos and pos + 1, like QTextLayout::lineForTextPosition()
+            while ( line + 1 < blockLayout->lineCount() && blockLayout->lineAt( line + 1 ).textStart() <= pos )
+                ++line;
+            const QTextLine startLine = blockLayout->lineAt( line );
+
+            if ( endInBlock ) {
+                int endLine = line;
+                while ( endLine + 1 < blockLayout->lineCount() && blockLayout->lineAt( endLine + 1 ).textStart() <= pos + 1 )
+                    ++endLine;
+                TextDocumentUtils::calculateBoundingRect( pageSize, blockRect, startLine, pos,
+                                                          blockRect, blockLayout->lineAt( endLine ), pos + 1, rect, page );
+            } else {
+                TextDocumentUtils::calculateBoundingRect( pageSize, blockRect, startLine, pos,
+                                                          nextBlockRect, endLayout->lineAt( 0 ), 0, rect, page );
+            }
+        } else {
+            qCWarning(OkularCoreDebug) << "Start or end layout not found" << blockLayout << endLayout;
+        }
+
+        if ( page == -1 )
+            text = QStringLiteral("\n");
+
+        textPage->append( text, new Okular::NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) );
     }
-    }
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
-#endif
 
     return textPage;
 }
@@ -167,8 +216,12 @@ void TextDocumentGeneratorPrivate::addMetaData( DocumentInfo::Key key, const QSt
 
 void TextDocumentGeneratorPrivate::generateLinkInfos()
 {
-    for ( int i = 0; i < mLinkPositions.count(); ++i ) {
-        const LinkPosition &linkPosition = mLinkPositions[ i ];
+    // only the links already laid out, the others are done as the pagination goes on
+    const int laidOut = laidOutPosition();
+    for ( ; mLinkInfosGenerated < mLinkPositions.count(); ++mLinkInfosGenerated ) {
+        const LinkPosition &linkPosition = mLinkPositions[ mLinkInfosGenerated ];
+        if ( linkPosition.endPosition >= laidOut )
+            break;
 
         LinkInfo info;
         info.link = linkPosition.link;
@@ -183,8 +236,11 @@ void TextDocumentGeneratorPrivate::generateLinkInfos()
 
 void TextDocumentGeneratorPrivate::generateAnnotationInfos()
 {
-    for ( int i = 0; i < mAnnotationPositions.count(); ++i ) {
-        const AnnotationPosition &annotationPosition = mAnnotationPositions[ i ];
+    const int laidOut = laidOutPosition();
+    for ( ; mAnnotationInfosGenerated < mAnnotationPositions.count(); ++mAnnotationInfosGenerated ) {
+        const AnnotationPosition &annotationPosition = mAnnotationPositions[ mAnnotationInfosGenerated ];
+        if ( annotationPosition.endPosition >= laidOut )
+            break;
 
         AnnotationInfo info;
         info.annotation = annotationPosition.annotation;
@@ -199,6 +255,10 @@ void TextDocumentGeneratorPrivate::generateAnnotationInfos()
 
 void TextDocumentGeneratorPrivate::generateTitleInfos()
 {
+    // the synopsis is rebuilt with the titles laid out so far
+    mDocumentSynopsis = Okular::DocumentSynopsis();
+    const int laidOut = laidOutPosition();
+
     QStack< QPair<int,QDomNode> > parentNodeStack;
 
     QDomNode parentNode = mDocumentSynopsis;
@@ -207,6 +267,8 @@ void TextDocumentGeneratorPrivate::generateTitleInfos()
 
     for ( int i = 0; i < mTitlePositions.count(); ++i ) {
         const TitlePosition &position = mTitlePositions[ i ];
+        if ( position.block.position() >= laidOut )
+            break;
 
         Okular::DocumentViewport viewport = TextDocumentUtils::calculateViewport( mDocument, position.block );
 
@@ -233,6 +295,160 @@ void TextDocumentGeneratorPrivate::generateTitleInfos()
     }
 }
 
+QVector< Page * > TextDocumentGeneratorPrivate::createPages( int first, int last ) const
+{
+    const QSize size = mDocument->pageSize().toSize();
+
+    QVector< QLinkedList<Okular::ObjectRect*> > objects( last - first );
+    for ( int i = 0; i < mLinkInfos.count(); ++i ) {
+        const TextDocumentGeneratorPrivate::LinkInfo &info = mLinkInfos.at( i );
+
+        // in case that the converter report bogus link info data, do not assert here
+        if ( info.page < first || info.page >= last )
+          continue;
+
+        const QRectF rect = info.boundingRect;
+        objects[ info.page - first ].append( new Okular::ObjectRect( rect.left(), rect.top(), rect.right(), rect.bottom(), false,
+                                                                     Okular::ObjectRect::Action, info.link ) );
+    }
+
+    QVector< QLinkedList<Okular::Annotation*> > annots( last - first );
+    for ( int i = 0; i < mAnnotationInfos.count(); ++i ) {
+        const TextDocumentGeneratorPrivate::AnnotationInfo &info = mAnnotationInfos[ i ];
+        if ( info.page < first || info.page >= last )
+          continue;
+
+        annots[ info.page - first ].append( info.annotation );
+    }
+
+    QVector< Page * > pages( last - first );
+    for ( int i = first; i < last; ++i ) {
+        Okular::Page * page = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
+        pages[ i - first ] = page;
+
+        if ( !objects.at( i - first ).isEmpty() ) {
+            page->setObjectRects( objects.at( i - first ) );
+        }
+        QLinkedList<Okular::Annotation*>::ConstIterator annIt = annots.at( i - first ).begin(), annEnd = annots.at( i - first ).end();
+        for ( ; annIt != annEnd; ++annIt ) {
+            page->addAnnotation( *annIt );
+        }
+    }
+
+    return pages;
+}
+
+static bool linkPositionLessThan( const TextDocumentGeneratorPrivate::LinkPosition &p1, const TextDocumentGeneratorPrivate::LinkPosition &p2 )
+{
+    return p1.endPosition < p2.endPosition;
+}
+
+static bool annotationPositionLessThan( const TextDocumentGeneratorPrivate::AnnotationPosition &p1, const TextDocumentGeneratorPrivate::AnnotationPosition &p2 )
+{
+    return p1.endPosition < p2.endPosition;
+}
+
+/**
+ * Lays out the beginning of a big document, returning its number of pages,
+ * and schedules the layout of the rest in the background.
+ */
+int TextDocumentGeneratorPrivate::startPagination()
+{
+    Q_Q( TextDocumentGenerator );
+
+    // the objects are handed out as their text gets laid out
+    std::stable_sort( mLinkPositions.begin(), mLinkPositions.end(), linkPositionLessThan );
+    std::stable_sort( mAnnotationPositions.begin(), mAnnotationPositions.end(), annotationPositionLessThan );
+
+    // the document keeps being laid out in the GUI thread
+    q->setFeature( Generator::Threaded, false );
+    q->setFeature( Generator::IncrementalPages );
+
+    mNextBlock = mDocument->begin();
+    mLaidOutBottom = 0;
+    while ( !layoutNextBlocks( PaginationSliceTime ) && laidOutPages() < InitialPages )
+        ;
+
+    mLastPublication.start();
+    if ( mNextBlock.isValid() )
+        mPaginationTimer->start();
+    else
+        finishPagination();
+
+    return laidOutPages();
+}
+
+void TextDocumentGeneratorPrivate::finishPagination()
+{
+    Q_Q( TextDocumentGenerator );
+
+    mPaginationTimer->stop();
+    mNextBlock = QTextBlock();
+
+    q->setFeature( Generator::IncrementalPages, false );
+    if ( QFontDatabase::supportsThreadedFontRendering() )
+        q->setFeature( Generator::Threaded );
+}
+
+/**
+ * Lays out the blocks of the document for about @p msecs milliseconds,
+ * returns whether the whole document is laid out.
+ */
+bool TextDocumentGeneratorPrivate::layoutNextBlocks( int msecs )
+{
+    const QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+
+    QElapsedTimer timer;
+    timer.start();
+    while ( mNextBlock.isValid() && timer.elapsed() < msecs ) {
+        mLaidOutBottom = qMax( mLaidOutBottom, layout->blockBoundingRect( mNextBlock ).bottom() );
+        mNextBlock = mNextBlock.next();
+    }
+
+    return !mNextBlock.isValid();
+}
+
+int TextDocumentGeneratorPrivate::laidOutPages() const
+{
+    if ( !mNextBlock.isValid() )
+        return mDocument->pageCount();
+
+    // the last page is not complete yet
+    return qFloor( mLaidOutBottom / mDocument->pageSize().height() );
+}
+
+int TextDocumentGeneratorPrivate::laidOutPosition() const
+{
+    return mNextBlock.isValid() ? mNextBlock.position() : INT_MAX;
+}
+
+void TextDocumentGeneratorPrivate::paginate()
+{
+    Q_Q( TextDocumentGenerator );
+
+    const bool finished = layoutNextBlocks( PaginationSliceTime );
+
+    // hand out the pages in batches, the observers set up all of them again
+    if ( finished || mLastPublication.elapsed() >= PublicationInterval ) {
+        const int pageCount = laidOutPages();
+        if ( pageCount > mPublishedPages ) {
+            generateTitleInfos();
+            generateLinkInfos();
+            generateAnnotationInfos();
+
+            const QVector< Page * > pages = createPages( mPublishedPages, pageCount );
+            mPublishedPages = pageCount;
+            q->appendPages( pages );
+        }
+        mLastPublication.restart();
+    }
+
+    if ( finished )
+        finishPagination();
+    else
+        mPaginationTimer->start();
+}
+
 void TextDocumentGeneratorPrivate::initializeGenerator()
 {
     Q_Q( TextDocumentGenerator );
@@ -246,10 +462,13 @@ void TextDocumentGeneratorPrivate::initializeGenerator()
     q->setFeature( Generator::TextExtraction );
     q->setFeature( Generator::PrintNative );
     q->setFeature( Generator::PrintToFile );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
+    q->setFeature( Generator::TiledRendering );
     if ( QFontDatabase::supportsThreadedFontRendering() )
         q->setFeature( Generator::Threaded );
-#endif
+
+    mPaginationTimer = new QTimer( q );
+    mPaginationTimer->setSingleShot( true );
+    QObject::connect( mPaginationTimer, SIGNAL(timeout()), q, SLOT(paginate()) );
 
     QObject::connect( mConverter, SIGNAL(addAction(Action*,int,int)),
                       q, SLOT(addAction(Action*,int,int)) );
@@ -309,45 +528,24 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
     }
     d->mDocument = d->mConverter->document();
 
+    // lay out the document with the configured font now, in the GUI thread;
+    // threaded rendering only draws the finished layout
+    d->mDocument->setDefaultFont( d->mFont );
+
+    // big documents are paginated in the background, after handing out
+    // their first pages
+    int pageCount;
+    if ( d->mDocument->characterCount() > StreamingCharacterCount )
+        pageCount = d->startPagination();
+    else
+        pageCount = d->mDocument->pageCount();
+
     d->generateTitleInfos();
     d->generateLinkInfos();
     d->generateAnnotationInfos();
 
-    pagesVector.resize( d->mDocument->pageCount() );
-
-    const QSize size = d->mDocument->pageSize().toSize();
-
-    QVector< QLinkedList<Okular::ObjectRect*> > objects( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mLinkInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::LinkInfo &info = d->mLinkInfos.at( i );
-
-        // in case that the converter report bogus link info data, do not assert here
-        if ( info.page >= objects.count() )
-          continue;
-
-        const QRectF rect = info.boundingRect;
-        objects[ info.page ].append( new Okular::ObjectRect( rect.left(), rect.top(), rect.right(), rect.bottom(), false,
-                                                             Okular::ObjectRect::Action, info.link ) );
-    }
-
-    QVector< QLinkedList<Okular::Annotation*> > annots( d->mDocument->pageCount() );
-    for ( int i = 0; i < d->mAnnotationInfos.count(); ++i ) {
-        const TextDocumentGeneratorPrivate::AnnotationInfo &info = d->mAnnotationInfos[ i ];
-        annots[ info.page ].append( info.annotation );
-    }
-
-    for ( int i = 0; i < d->mDocument->pageCount(); ++i ) {
-        Okular::Page * page = new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 );
-        pagesVector[ i ] = page;
-
-        if ( !objects.at( i ).isEmpty() ) {
-            page->setObjectRects( objects.at( i ) );
-        }
-        QLinkedList<Okular::Annotation*>::ConstIterator annIt = annots.at( i ).begin(), annEnd = annots.at( i ).end();
-        for ( ; annIt != annEnd; ++annIt ) {
-            page->addAnnotation( *annIt );
-        }
-    }
+    pagesVector = d->createPages( 0, pageCount );
+    d->mPublishedPages = pageCount;
 
     return openResult;
 }
@@ -355,6 +553,13 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
 bool TextDocumentGenerator::doCloseDocument()
 {
     Q_D( TextDocumentGenerator );
+    if ( d->mNextBlock.isValid() )
+        d->finishPagination();
+    d->mLaidOutBottom = 0;
+    d->mPublishedPages = 0;
+    d->mLinkInfosGenerated = 0;
+    d->mAnnotationInfosGenerated = 0;
+
     delete d->mDocument;
     d->mDocument = 0;
 
@@ -385,42 +590,50 @@ QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
     if ( !mDocument )
         return QImage();
 
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     Q_Q( TextDocumentGenerator );
-#endif
 
-    QImage image( request->width(), request->height(), QImage::Format_ARGB32 );
+    const qreal width = request->width();
+    const qreal height = request->height();
+
+    // the area of the page to render, in pixels
+    QRect area( 0, 0, request->width(), request->height() );
+    if ( request->isTile() )
+        area = request->normalizedRect().geometry( request->width(), request->height() );
+
+    QImage image( area.size(), QImage::Format_ARGB32 );
     image.fill( Qt::white );
 
     QPainter p;
     p.begin( &image );
 
-    qreal width = request->width();
-    qreal height = request->height();
-
     const QSize size = mDocument->pageSize().toSize();
 
+    p.translate( -area.topLeft() );
     p.scale( width / (qreal)size.width(), height / (qreal)size.height() );
 
     QRect rect;
     rect = QRect( 0, request->pageNumber() * size.height(), size.width(), size.height() );
     p.translate( QPoint( 0, request->pageNumber() * size.height() * -1 ) );
     p.setClipRect( rect );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
+
+    // only lay out the lines of the document intersecting the area
+    const QRectF clip( area.x() * size.width() / width,
+                       request->pageNumber() * size.height() + area.y() * size.height() / height,
+                       area.width() * size.width() / width,
+                       area.height() * size.height() / height );
+
+    // the document is laid out in the GUI thread, so drawing it here only
+    // reads the layout; the lock keeps the GUI thread from changing it
     q->userMutex()->lock();
-#endif
     QAbstractTextDocumentLayout::PaintContext context;
     context.palette.setColor( QPalette::Text, Qt::black );
 //  FIXME Fix Qt, this doesn't work, we have horrible hacks
 //        in the generators that return html, remove that code
 //        if Qt ever gets fixed
 //     context.palette.setColor( QPalette::Link, Qt::blue );
-    context.clip = rect;
-    mDocument->setDefaultFont( mFont );
+    context.clip = clip.intersected( rect );
     mDocument->documentLayout()->draw( &p, context );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
-#endif
     p.end();
 
     return image;
@@ -438,6 +651,7 @@ bool TextDocumentGenerator::print( QPrinter& printer )
     if ( !d->mDocument )
         return false;
 
+    QMutexLocker locker( userMutex() );
     d->mDocument->print( &printer );
 
     return true;
@@ -491,6 +705,7 @@ bool TextDocumentGenerator::exportTo( const QString &fileName, const Okular::Exp
     if ( !d->mDocument )
         return false;
 
+    QMutexLocker locker( userMutex() );
     if ( format.mimeType().name() == QLatin1String( "application/pdf" ) ) {
         QFile file( fileName );
         if ( !file.open( QIODevice::WriteOnly ) )
@@ -530,6 +745,10 @@ bool TextDocumentGenerator::reparseConfig()
 
     if ( newFont != d->mFont ) {
         d->mFont = newFont;
+        if ( d->mDocument ) {
+            QMutexLocker locker( userMutex() );
+            d->mDocument->setDefaultFont( d->mFont );
+        }
         return true;
     }
 
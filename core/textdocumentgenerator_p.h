@@ -10,6 +10,7 @@
 #ifndef _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 #define _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 
+#include <QtCore/QElapsedTimer>
 #include <QtGui/QAbstractTextDocumentLayout>
 #include <QtGui/QTextBlock>
 #include <QtGui/QTextDocument>
@@ -20,10 +21,43 @@
 #include "textdocumentgenerator.h"
 #include "debug_p.h"
 
+class QTimer;
+
 namespace Okular {
 
 namespace TextDocumentUtils {
 
+        /**
+         * Calculates the normalized rect of the text between two cursor positions,
+         * given the bounding rects of their blocks, their lines and their positions
+         * in the blocks. Returns false if they are on different lines, in which case
+         * rect is a pseudo character at the end of the start line.
+         */
+        static bool calculateBoundingRect( const QSizeF &pageSize,
+                                           const QRectF &startBoundingRect, const QTextLine &startLine, int startPos,
+                                           const QRectF &endBoundingRect, const QTextLine &endLine, int endPos,
+                                           QRectF &rect, int &page )
+        {
+            double x = startBoundingRect.x() + startLine.cursorToX( startPos );
+            double y = startBoundingRect.y() + startLine.y();
+            double r = endBoundingRect.x() + endLine.cursorToX( endPos );
+            double b = endBoundingRect.y() + endLine.y() + endLine.height();
+
+            int offset = qRound( y ) % qRound( pageSize.height() );
+
+            if ( x > r ) { // line break, so return a pseudo character on the start line
+                rect = QRectF( x / pageSize.width(), offset / pageSize.height(),
+                               3 / pageSize.width(), startLine.height() / pageSize.height() );
+                page = -1;
+                return false;
+            }
+
+            page = qRound( y ) / qRound( pageSize.height() );
+            rect = QRectF( x / pageSize.width(), offset / pageSize.height(),
+                           (r - x) / pageSize.width(), (b - y) / pageSize.height() );
+            return true;
+        }
+
         static void calculateBoundingRect( QTextDocument *document, int startPosition, int endPosition,
                                            QRectF &rect, int &page )
         {
@@ -48,23 +82,8 @@ namespace TextDocumentUtils {
             const QTextLine startLine = startLayout->lineForTextPosition( startPos );
             const QTextLine endLine = endLayout->lineForTextPosition( endPos );
 
-            double x = startBoundingRect.x() + startLine.cursorToX( startPos );
-            double y = startBoundingRect.y() + startLine.y();
-            double r = endBoundingRect.x() + endLine.cursorToX( endPos );
-            double b = endBoundingRect.y() + endLine.y() + endLine.height();
-
-            int offset = qRound( y ) % qRound( pageSize.height() );
-
-            if ( x > r ) { // line break, so return a pseudo character on the start line
-                rect = QRectF( x / pageSize.width(), offset / pageSize.height(),
-                               3 / pageSize.width(), startLine.height() / pageSize.height() );
-                page = -1;
-                return;
-            }
-
-            page = qRound( y ) / qRound( pageSize.height() );
-            rect = QRectF( x / pageSize.width(), offset / pageSize.height(),
-                           (r - x) / pageSize.width(), (b - y) / pageSize.height() );
+            calculateBoundingRect( pageSize, startBoundingRect, startLine, startPos,
+                                   endBoundingRect, endLine, endPos, rect, page );
         }
 
         static void calculatePositions( QTextDocument *document, int page, int &start, int &end )
@@ -116,7 +135,9 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
 
     public:
         TextDocumentGeneratorPrivate( TextDocumentConverter *converter )
-            : mConverter( converter ), mDocument( 0 ), mGeneralSettings( 0 )
+            : mConverter( converter ), mDocument( 0 ), mGeneralSettings( 0 ),
+              mPaginationTimer( 0 ), mLaidOutBottom( 0 ), mPublishedPages( 0 ),
+              mLinkInfosGenerated( 0 ), mAnnotationInfosGenerated( 0 )
         {
         }
 
@@ -147,6 +168,15 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         void generateAnnotationInfos();
         void generateTitleInfos();
 
+        QVector< Page * > createPages( int first, int last ) const;
+
+        int startPagination();
+        void finishPagination();
+        bool layoutNextBlocks( int msecs );
+        int laidOutPages() const;
+        int laidOutPosition() const;
+        void paginate();
+
         TextDocumentConverter *mConverter;
 
         QTextDocument *mDocument;
@@ -196,6 +226,17 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         TextDocumentSettings *mGeneralSettings;
 
         QFont mFont;
+
+        // background pagination of big documents: the first block not laid
+        // out yet, the bottom of the laid out ones and how many pages have
+        // been handed to the document
+        QTimer *mPaginationTimer;
+        QElapsedTimer mLastPublication;
+        QTextBlock mNextBlock;
+        qreal mLaidOutBottom;
+        int mPublishedPages;
+        int mLinkInfosGenerated;
+        int mAnnotationInfosGenerated;
 };
 
 }
@@ -74,6 +74,7 @@ DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
 {
     setFeature( TextExtraction );
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintPostscript );
     if ( Okular::FilePrinter::ps2pdfAvailable() )
         setFeature( PrintToFile );
@@ -115,7 +116,16 @@ bool DjVuGenerator::doCloseDocument()
 QImage DjVuGenerator::image( Okular::PixmapRequest *request )
 {
     userMutex()->lock();
-    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    QImage img;
+    if ( request->isTile() )
+    {
+        const QRect rect = request->normalizedRect().geometry( request->width(), request->height() );
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation(), rect );
+    }
+    else
+    {
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    }
     userMutex()->unlock();
     return img;
 }
@@ -14,7 +14,6 @@
 #include <qfile.h>
 #include <qhash.h>
 #include <qlist.h>
-#include <qpainter.h>
 #include <qqueue.h>
 #include <qstring.h>
 
@@ -434,8 +433,10 @@ class KDjVu::Private
         {
         }
 
-        QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
-            int width, int row, int xdelta, int height, int col, int ydelta );
+        bool renderArea( ddjvu_page_t *djvupage, int width, int height,
+            const QRect &area, QImage *dest, const QPoint &destPos );
+        ddjvu_page_t *loadedPage( int page );
+        QImage renderImage( int page, int width, int height, const QRect &rect, bool *ok );
 
         void readBookmarks();
         void fillBookmarksRecurse( QDomDocument& maindoc, QDomNode& curnode,
@@ -466,16 +467,14 @@ class KDjVu::Private
 
 unsigned int KDjVu::Private::s_formatmask[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
-QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
-    int width, int row, int xdelta, int height, int col, int ydelta )
+bool KDjVu::Private::renderArea( ddjvu_page_t *djvupage, int width, int height,
+    const QRect &area, QImage *dest, const QPoint &destPos )
 {
     ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin( width - renderrect.x, xdelta );
-    int realheight = qMin( height - renderrect.y, ydelta );
-    renderrect.w = realwidth;
-    renderrect.h = realheight;
+    renderrect.x = area.x();
+    renderrect.y = area.y();
+    renderrect.w = area.width();
+    renderrect.h = area.height();
 #ifdef KDJVU_DEBUG
     qDebug() << "renderrect:" << renderrect;
 #endif
@@ -488,22 +487,33 @@ QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
     qDebug() << "pagerect:" << pagerect;
 #endif
     handle_ddjvu_messages( m_djvu_cxt, false );
-    QImage res_img( realwidth, realheight, QImage::Format_RGB32 );
     // the following line workarounds a rare crash in djvulibre;
     // it should be fixed with >= 3.5.21
     ddjvu_page_get_width( djvupage );
-    res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
-                  &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char *)res_img.bits() );
-    if (!res)
-    {
-        res_img.fill(Qt::white);
-    }
+    // render straight into the right place of the destination image
+    char *buffer = (char *)dest->bits() + destPos.y() * dest->bytesPerLine() + destPos.x() * 4;
+    const int res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR,
+                  &pagerect, &renderrect, m_format, dest->bytesPerLine(), buffer );
 #ifdef KDJVU_DEBUG
     qDebug() << "rendering result:" << res;
 #endif
     handle_ddjvu_messages( m_djvu_cxt, false );
 
-    return res_img;
+    return res != 0;
+}
+
+ddjvu_page_t *KDjVu::Private::loadedPage( int page )
+{
+    if ( !m_pages_cache.at( page ) )
+    {
+        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( m_djvu_document, page );
+        // wait for the new page to be loaded
+        ddjvu_status_t sts;
+        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
+            handle_ddjvu_messages( m_djvu_cxt, true );
+        m_pages_cache[page] = newpage;
+    }
+    return m_pages_cache[page];
 }
 
 void KDjVu::Private::readBookmarks()
@@ -936,17 +946,6 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
         }
     }
 
-    if ( !d->m_pages_cache.at( page ) )
-    {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( d->m_djvu_document, page );
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
-
 /*
     if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
     {
@@ -956,44 +955,8 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     }
 */
 
-    static const int xdelta = 1500;
-    static const int ydelta = 1500;
-
-    int xparts = width / xdelta + 1;
-    int yparts = height / ydelta + 1;
-
-    QImage newimg;
-
-    int res = 10000;
-    if ( ( xparts == 1 ) && ( yparts == 1 ) )
-    {
-         // only one part -- render at once with no need to auxiliary image
-         newimg = d->generateImageTile( djvupage, res,
-                 width, 0, xdelta, height, 0, ydelta );
-    }
-    else
-    {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
-        newimg = QImage( width, height, QImage::Format_RGB32 );
-        QPainter p;
-        p.begin( &newimg );
-        int parts = xparts * yparts;
-        for ( int i = 0; i < parts; ++i )
-        {
-            int row = i % xparts;
-            int col = i / xparts;
-            int tmpres = 0;
-            QImage tempp = d->generateImageTile( djvupage, tmpres,
-                    width, row, xdelta, height, col, ydelta );
-            if ( tmpres )
-            {
-                p.drawImage( row * xdelta, col * ydelta, tempp );
-            }
-            res = qMin( tmpres, res );
-        }
-        p.end();
-    }
+    bool res = false;
+    QImage newimg = d->renderImage( page, width, height, QRect( 0, 0, width, height ), &res );
 
     if ( res && d->m_cacheEnabled )
     {
@@ -1029,6 +992,46 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     return newimg;
 }
 
+QImage KDjVu::image( int page, int width, int height, int rotation, const QRect &rect )
+{
+    Q_UNUSED( rotation )
+
+    bool res = false;
+    return d->renderImage( page, width, height, rect, &res );
+}
+
+QImage KDjVu::Private::renderImage( int page, int width, int height, const QRect &rect, bool *ok )
+{
+    const QRect area = rect.intersected( QRect( 0, 0, width, height ) );
+    *ok = false;
+    if ( area.isEmpty() )
+        return QImage();
+
+    ddjvu_page_t *djvupage = loadedPage( page );
+
+    // djvulibre allocates temporary buffers as big as the render rect, so
+    // big areas are rendered piece by piece, each directly into the result
+    static const int xdelta = 1500;
+    static const int ydelta = 1500;
+
+    QImage newimg( area.size(), QImage::Format_RGB32 );
+    *ok = true;
+    for ( int y = 0; y < area.height(); y += ydelta )
+    {
+        for ( int x = 0; x < area.width(); x += xdelta )
+        {
+            const QRect part( area.x() + x, area.y() + y,
+                              qMin( xdelta, area.width() - x ), qMin( ydelta, area.height() - y ) );
+            if ( !renderArea( djvupage, width, height, part, &newimg, QPoint( x, y ) ) )
+                *ok = false;
+        }
+    }
+    if ( !*ok )
+        newimg.fill( Qt::white );
+
+    return newimg;
+}
+
 bool KDjVu::exportAsPostScript( const QString & fileName, const QList<int>& pageList ) const
 {
     if ( !d->m_djvu_document || fileName.trimmed().isEmpty() || pageList.isEmpty() )
@@ -257,6 +257,13 @@ class KDjVu
          */
         QImage image( int page, int width, int height, int rotation );
 
+        /**
+         * Render only the area \p rect of the specified \p page scaled to
+         * \p width x \p height (so \p rect is in the coordinates of that
+         * size). The internal cache is neither used nor filled.
+         */
+        QImage image( int page, int width, int height, int rotation, const QRect &rect );
+
         /**
          * Export the currently open document as PostScript file \p fileName.
          * \returns whether the exporting was successful
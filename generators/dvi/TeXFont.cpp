@@ -2,7 +2,42 @@
 #include <config.h>
 
 #include "TeXFont.h"
+#include "fontpool.h"
+
+#include <QMutexLocker>
 
 
 TeXFont::~TeXFont()
-{}
+{
+  parent->font_pool->glyphs.removeFont(this);
+}
+
+
+glyph* TeXFont::getGlyph(quint16 ch)
+{
+  QMutexLocker locker(&mutex);
+  return loadGlyph(ch);
+}
+
+
+glyphMask TeXFont::getGlyphMask(quint16 ch, double displayResolution_in_dpi)
+{
+  glyphMask mask;
+  if (ch >= TeXFontDefinition::max_num_of_chars_in_font)
+    return mask;
+
+  glyphCache &cache = parent->font_pool->glyphs;
+  if (cache.find(this, ch, displayResolution_in_dpi, &mask))
+    return mask;
+
+  // Two pages may miss the same glyph at the same time; it is then
+  // rasterised twice, which is cheaper than holding the lock of the
+  // font while looking into the cache.
+  QMutexLocker locker(&mutex);
+  loadGlyph(ch);
+  rasterizeGlyph(ch, displayResolution_in_dpi, &mask);
+  locker.unlock();
+
+  cache.insert(this, ch, displayResolution_in_dpi, mask);
+  return mask;
+}
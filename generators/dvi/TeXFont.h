@@ -12,6 +12,8 @@
 #include "glyph.h"
 #include "TeXFontDefinition.h"
 
+#include <QMutex>
+
 
 class TeXFont {
  public:
@@ -23,13 +25,16 @@ class TeXFont {
 
   virtual ~TeXFont();
 
-  void setDisplayResolution()
-    {
-      for(unsigned int i=0; i<TeXFontDefinition::max_num_of_chars_in_font; i++)
-        glyphtable[i].shrunkenCharacter = QImage();
-    }
+  // Loads the metrics of the character, and whatever else the font
+  // needs to rasterise it later. Fonts are shared by all the pages
+  // that are drawn at the same time, so this is thread safe.
+  glyph* getGlyph(quint16 character);
 
-  virtual glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) = 0;
+  // Returns the shrunken mask of the character at the given display
+  // resolution. Masks are kept in the glyphCache of the fontPool, so
+  // each character is only rasterised once per resolution. Thread
+  // safe.
+  glyphMask getGlyphMask(quint16 character, double displayResolution_in_dpi);
 
   // Checksum of the font. Used e.g. by PK fonts. This field is filled
   // in by the constructor, or set to 0.0, if the font format does not
@@ -41,8 +46,20 @@ class TeXFont {
   QString            errorMessage;
 
  protected:
+  // Does the work of getGlyph(). Called with the font locked.
+  virtual glyph* loadGlyph(quint16 character) = 0;
+
+  // Rasterises the character at the given resolution. Called with
+  // the font locked, and only for characters that have been loaded
+  // with loadGlyph().
+  virtual void rasterizeGlyph(quint16 character, double displayResolution_in_dpi, glyphMask *mask) = 0;
+
   glyph              glyphtable[TeXFontDefinition::max_num_of_chars_in_font];
   TeXFontDefinition *parent;
+
+ private:
+  // Guards the font file and the glyph table
+  QMutex             mutex;
 };
 
 #endif
@@ -204,9 +204,9 @@ void TeXFontDefinition::reset()
 
 void TeXFontDefinition::setDisplayResolution(double _displayResolution_in_dpi)
 {
+  // The glyphs of the previous resolution stay in the glyph cache of
+  // the font pool, and are reused if the resolution comes back
   displayResolution_in_dpi = _displayResolution_in_dpi;
-  if (font != 0)
-    font->setDisplayResolution();
 }
 
 
@@ -26,7 +26,9 @@ class TeXFont_PFB : public TeXFont {
   TeXFont_PFB(TeXFontDefinition *parent, fontEncoding *enc=0, double slant=0.0 );
   ~TeXFont_PFB();
 
-  glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) override;
+ protected:
+  glyph* loadGlyph(quint16 character) override;
+  void rasterizeGlyph(quint16 character, double displayResolution_in_dpi, glyphMask *mask) override;
 
  private:
   FT_Face       face;
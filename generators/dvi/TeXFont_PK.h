@@ -13,7 +13,9 @@ class TeXFont_PK : public TeXFont {
   TeXFont_PK(TeXFontDefinition *parent);
   ~TeXFont_PK();
 
-  glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) override;
+ protected:
+  glyph* loadGlyph(quint16 character) override;
+  void rasterizeGlyph(quint16 character, double displayResolution_in_dpi, glyphMask *mask) override;
 
  private:
   // open font file or NULL
@@ -120,42 +120,43 @@ TeXFont_TFM::~TeXFont_TFM()
 }
 
 
-glyph* TeXFont_TFM::getGlyph(quint16 characterCode, bool generateCharacterPixmap, const QColor& color)
+glyph* TeXFont_TFM::loadGlyph(quint16 characterCode)
 {
 #ifdef DEBUG_TFM
-  qCDebug(OkularDviDebug) << "TeXFont_TFM::getGlyph( ch=" << ch << ", generateCharacterPixmap=" << generateCharacterPixmap << " )";
+  qCDebug(OkularDviDebug) << "TeXFont_TFM::loadGlyph( ch=" << characterCode << " )";
 #endif
 
   // Paranoia checks
   if (characterCode >= TeXFontDefinition::max_num_of_chars_in_font) {
-    qCCritical(OkularDviDebug) << "TeXFont_TFM::getGlyph(): Argument is too big." << endl;
+    qCCritical(OkularDviDebug) << "TeXFont_TFM::loadGlyph(): Argument is too big." << endl;
     return glyphtable;
   }
 
   // This is the address of the glyph that will be returned.
-  class glyph *g = glyphtable+characterCode;
-
-  if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) ) {
-    g->color = color;
-    quint16 pixelWidth = (quint16)(parent->displayResolution_in_dpi *
-                                     design_size_in_TeX_points.toDouble() *
-                                     characterWidth_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
-    quint16 pixelHeight = (quint16)(parent->displayResolution_in_dpi *
-                                      design_size_in_TeX_points.toDouble() *
-                                      characterHeight_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
-
-    // Just make sure that weired TFM files never lead to giant
-    // pixmaps that eat all system memory...
-    if (pixelWidth > 50)
-      pixelWidth = 50;
-    if (pixelHeight > 50)
-      pixelHeight = 50;
-
-    g->shrunkenCharacter = QImage(pixelWidth, pixelHeight, QImage::Format_RGB32);
-    g->shrunkenCharacter.fill(color.rgba());
-    g->x2 = 0;
-    g->y2 = pixelHeight;
-  }
+  return glyphtable+characterCode;
+}
 
-  return g;
+
+void TeXFont_TFM::rasterizeGlyph(quint16 characterCode, double displayResolution_in_dpi, glyphMask *mask)
+{
+  quint16 pixelWidth = (quint16)(displayResolution_in_dpi *
+                                   design_size_in_TeX_points.toDouble() *
+                                   characterWidth_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
+  quint16 pixelHeight = (quint16)(displayResolution_in_dpi *
+                                    design_size_in_TeX_points.toDouble() *
+                                    characterHeight_in_units_of_design_size[characterCode].toDouble() * 100.0/7227.0 + 0.5);
+
+  // Just make sure that weired TFM files never lead to giant
+  // pixmaps that eat all system memory...
+  if (pixelWidth > 50)
+    pixelWidth = 50;
+  if (pixelHeight > 50)
+    pixelHeight = 50;
+
+  // TFM files have no glyph shapes, the character is drawn as a
+  // filled rectangle
+  mask->mask = QImage(pixelWidth, pixelHeight, QImage::Format_Alpha8);
+  mask->mask.fill(0xff);
+  mask->x2 = 0;
+  mask->y2 = pixelHeight;
 }
@@ -26,7 +26,9 @@ class TeXFont_TFM : public TeXFont {
   TeXFont_TFM(TeXFontDefinition *parent);
   ~TeXFont_TFM();
 
-  glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) override;
+ protected:
+  glyph* loadGlyph(quint16 character) override;
+  void rasterizeGlyph(quint16 character, double displayResolution_in_dpi, glyphMask *mask) override;
 
  private:
   fix_word characterWidth_in_units_of_design_size[256];
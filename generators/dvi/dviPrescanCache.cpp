@@ -0,0 +1,308 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// dviPrescanCache.cpp
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#include <config.h>
+
+#include "dviPrescanCache.h"
+#include "debug_dvi.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// Bump whenever the format of the cache or the output of the prescan
+// changes
+static const quint32 prescanCacheMagic = 0x44505343; // "DPSC"
+static const quint32 prescanCacheVersion = 2;
+
+// The caches of all documents together are kept below this size, and
+// those not used for this many days are removed
+static const qint64 prescanCacheSizeLimit = 64 * 1024 * 1024;
+static const int prescanCacheMaxAge = 30;
+
+// Caches older than this many days are written again when used
+static const int prescanCacheRefreshAge = 1;
+
+
+static QDataStream &operator<<(QDataStream &stream, const Length &length)
+{
+  return stream << length.getLength_in_mm();
+}
+
+
+static QDataStream &operator>>(QDataStream &stream, Length &length)
+{
+  double mm;
+  stream >> mm;
+  length.setLength_in_mm(mm);
+  return stream;
+}
+
+
+static QDataStream &operator<<(QDataStream &stream, const PrescanDependency &dependency)
+{
+  return stream << dependency.fileName << dependency.size << dependency.lastModified;
+}
+
+
+static QDataStream &operator>>(QDataStream &stream, PrescanDependency &dependency)
+{
+  return stream >> dependency.fileName >> dependency.size >> dependency.lastModified;
+}
+
+
+static QDataStream &operator<<(QDataStream &stream, const PrescanPage &page)
+{
+  stream << page.hash << page.postScript << page.postScriptHeader << page.background << page.paperSizes;
+
+  stream << quint32(page.anchors.count());
+  for(int i=0; i<page.anchors.count(); i++)
+    stream << page.anchors[i].first << quint16(page.anchors[i].second.page) << page.anchors[i].second.distance_from_top;
+
+  stream << quint32(page.sourceAnchors.count());
+  for(int i=0; i<page.sourceAnchors.count(); i++) {
+    const DVI_SourceFileAnchor &sfa = page.sourceAnchors[i];
+    stream << sfa.fileName << sfa.line << sfa.page << sfa.distance_from_top;
+  }
+
+  stream << quint32(page.bookmarks.count());
+  for(int i=0; i<page.bookmarks.count(); i++)
+    stream << page.bookmarks[i].title << page.bookmarks[i].anchorName << page.bookmarks[i].noOfChildren;
+
+  return stream << page.externalPSFiles << page.externalNONPSFiles << page.dependencies;
+}
+
+
+static QDataStream &operator>>(QDataStream &stream, PrescanPage &page)
+{
+  stream >> page.hash >> page.postScript >> page.postScriptHeader >> page.background >> page.paperSizes;
+
+  quint32 count;
+  stream >> count;
+  for(quint32 i=0; i<count && stream.status() == QDataStream::Ok; i++) {
+    QString name;
+    quint16 pageNumber;
+    Length distance;
+    stream >> name >> pageNumber >> distance;
+    page.anchors.append(qMakePair(name, Anchor(pageNumber, distance)));
+  }
+
+  stream >> count;
+  for(quint32 i=0; i<count && stream.status() == QDataStream::Ok; i++) {
+    DVI_SourceFileAnchor sfa;
+    stream >> sfa.fileName >> sfa.line >> sfa.page >> sfa.distance_from_top;
+    page.sourceAnchors.append(sfa);
+  }
+
+  stream >> count;
+  for(quint32 i=0; i<count && stream.status() == QDataStream::Ok; i++) {
+    PreBookmark bookmark;
+    stream >> bookmark.title >> bookmark.anchorName >> bookmark.noOfChildren;
+    page.bookmarks.append(bookmark);
+  }
+
+  return stream >> page.externalPSFiles >> page.externalNONPSFiles >> page.dependencies;
+}
+
+
+// Removes the least recently used caches in @p path, which are the
+// least recently written ones, until the rest fits the size limit
+static void pruneCacheDirectory(const QString &path)
+{
+  const QDateTime oldest = QDateTime::currentDateTime().addDays(-prescanCacheMaxAge);
+  const QFileInfoList files = QDir(path).entryInfoList(QDir::Files, QDir::Time);
+
+  qint64 total = 0;
+  foreach(const QFileInfo &fi, files) {
+    if (total + fi.size() <= prescanCacheSizeLimit && fi.lastModified() >= oldest) {
+      total += fi.size();
+      continue;
+    }
+    if (!QFile::remove(fi.absoluteFilePath()))
+      qCWarning(OkularDviDebug) << "Could not remove the prescan cache" << fi.absoluteFilePath();
+  }
+}
+
+
+PrescanDependency::PrescanDependency()
+{
+  size = -1;
+}
+
+
+PrescanDependency::PrescanDependency(const QString &_fileName)
+{
+  QFileInfo fi(_fileName);
+  fileName     = _fileName;
+  size         = fi.exists() ? fi.size() : -1;
+  lastModified = fi.lastModified();
+}
+
+
+bool PrescanDependency::operator==(const PrescanDependency &other) const
+{
+  return fileName == other.fileName && size == other.size && lastModified == other.lastModified;
+}
+
+
+PrescanPage::PrescanPage()
+{
+  externalPSFiles = 0;
+  externalNONPSFiles = 0;
+}
+
+
+void PrescanPage::addDependency(const QString &fileName)
+{
+  for(int i=0; i<dependencies.count(); i++)
+    if (dependencies[i].fileName == fileName)
+      return;
+
+  dependencies.append(PrescanDependency(fileName));
+}
+
+
+dviPrescanCache::dviPrescanCache(const QString &dviFileName, const QByteArray &_contextHash)
+{
+  QFileInfo fi(dviFileName);
+  fileName     = fi.absoluteFilePath();
+  contextHash  = _contextHash;
+  size         = fi.size();
+  lastModified = fi.lastModified();
+  upToDate     = false;
+
+  QCryptographicHash key(QCryptographicHash::Md5);
+  key.addData(fileName.toUtf8());
+  key.addData(contextHash);
+  cacheFileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+    + QLatin1String("/dviprescan/") + QString::fromLatin1(key.result().toHex());
+}
+
+
+void dviPrescanCache::load()
+{
+  pages.clear();
+  upToDate = false;
+
+  QFile file(cacheFileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+  lastSaved = QFileInfo(file).lastModified();
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_6);
+
+  quint32 magic, version;
+  stream >> magic >> version;
+  if (magic != prescanCacheMagic || version != prescanCacheVersion)
+    return;
+
+  QString cachedFileName;
+  qint64 cachedSize;
+  QDateTime cachedLastModified;
+  QByteArray cachedContextHash;
+  stream >> cachedFileName >> cachedSize >> cachedLastModified >> cachedContextHash;
+  if (cachedFileName != fileName || cachedContextHash != contextHash)
+    return;
+
+  quint32 count;
+  stream >> count;
+  QVector<PrescanPage> cachedPages;
+  for(quint32 i=0; i<count && stream.status() == QDataStream::Ok; i++) {
+    PrescanPage cachedPage;
+    stream >> cachedPage;
+    cachedPages.append(cachedPage);
+  }
+  if (stream.status() != QDataStream::Ok) {
+    qCWarning(OkularDviDebug) << "Discarding corrupt prescan cache" << cacheFileName;
+    return;
+  }
+
+  // Pages referring to files that changed since are scanned again. The
+  // same figures and headers tend to be used by many pages, so every
+  // file is only looked at once
+  QHash<QString, PrescanDependency> currentFiles;
+  for(int i=0; i<cachedPages.count(); i++) {
+    PrescanPage &cachedPage = cachedPages[i];
+    for(int j=0; j<cachedPage.dependencies.count() && !cachedPage.hash.isEmpty(); j++) {
+      const PrescanDependency &dependency = cachedPage.dependencies[j];
+      QHash<QString, PrescanDependency>::const_iterator it = currentFiles.constFind(dependency.fileName);
+      if (it == currentFiles.constEnd())
+        it = currentFiles.insert(dependency.fileName, PrescanDependency(dependency.fileName));
+      if (!(*it == dependency))
+        cachedPage.hash.clear();
+    }
+  }
+
+  pages = cachedPages;
+  upToDate = (cachedSize == size) && (cachedLastModified == lastModified);
+}
+
+
+bool dviPrescanCache::isUpToDate() const
+{
+  return upToDate;
+}
+
+
+bool dviPrescanCache::isAging() const
+{
+  return lastSaved.isValid() && lastSaved < QDateTime::currentDateTime().addDays(-prescanCacheRefreshAge);
+}
+
+
+const PrescanPage *dviPrescanCache::page(int pageIndex, const QByteArray &hash) const
+{
+  if (pageIndex < 0 || pageIndex >= pages.count() || pages[pageIndex].hash.isEmpty())
+    return 0;
+
+  return pages[pageIndex].hash == hash ? &pages[pageIndex] : 0;
+}
+
+
+const PrescanPage *dviPrescanCache::page(int pageIndex) const
+{
+  if (!upToDate || pageIndex < 0 || pageIndex >= pages.count() || pages[pageIndex].hash.isEmpty())
+    return 0;
+
+  return &pages[pageIndex];
+}
+
+
+void dviPrescanCache::save(const QVector<PrescanPage> &scannedPages) const
+{
+  const QString cacheDirectory = QFileInfo(cacheFileName).absolutePath();
+  QDir().mkpath(cacheDirectory);
+
+  QSaveFile file(cacheFileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_6);
+  stream << prescanCacheMagic << prescanCacheVersion;
+  stream << fileName << size << lastModified << contextHash;
+  stream << quint32(scannedPages.count());
+  for(int i=0; i<scannedPages.count(); i++)
+    stream << scannedPages[i];
+
+  if (!file.commit())
+    qCWarning(OkularDviDebug) << "Could not write the prescan cache" << cacheFileName;
+
+  pruneCacheDirectory(cacheDirectory);
+}
+
+
+QByteArray dviPrescanCache::pageHash(const quint8 *begin, const quint8 *end)
+{
+  return QCryptographicHash::hash(QByteArray::fromRawData((const char *)begin, end - begin), QCryptographicHash::Md5);
+}
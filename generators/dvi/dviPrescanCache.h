@@ -0,0 +1,130 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// dviPrescanCache.h
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#ifndef _DVIPRESCANCACHE_H
+#define _DVIPRESCANCACHE_H
+
+#include "anchor.h"
+#include "dviRenderer.h"
+#include "prebookmark.h"
+
+#include <QByteArray>
+#include <QColor>
+#include <QDateTime>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+/** A file the prescan of a page depends on, e.g. an EPS figure or a
+    PostScript header, with the size and modification time it had. */
+
+class PrescanDependency {
+ public:
+  PrescanDependency();
+  explicit PrescanDependency(const QString &fileName);
+
+  bool operator==(const PrescanDependency &other) const;
+
+  QString fileName;
+  // -1 if the file does not exist
+  qint64 size;
+  QDateTime lastModified;
+};
+
+
+/** What the prescan of a single page contributes to the document:
+    PostScript, anchors, source specials, bookmarks and PostScript
+    headers. Replaying it gives the same result as scanning the page
+    again. */
+
+class PrescanPage {
+ public:
+  PrescanPage();
+
+  // MD5 sum of the DVI code of the page, empty if the result of the
+  // scan must not be reused, e.g. because it refers to temporary files
+  QByteArray hash;
+
+  QString postScript;
+  QString postScriptHeader;
+
+  // background colour set by the page, invalid if none
+  QColor background;
+  QStringList paperSizes;
+
+  QList<QPair<QString, Anchor> > anchors;
+  QVector<DVI_SourceFileAnchor> sourceAnchors;
+  QVector<PreBookmark> bookmarks;
+
+  quint16 externalPSFiles;
+  quint16 externalNONPSFiles;
+
+  // files referenced by the specials of the page; the result must be
+  // scanned again when one of them changed
+  QVector<PrescanDependency> dependencies;
+
+  void addDependency(const QString &fileName);
+};
+
+
+/** Prescan results of a DVI file, stored in the cache directory of
+    the user. The cache is keyed by the file name and by a hash of the
+    document wide settings the prescan depends on, such as the font
+    definitions. It is valid as a
+    whole as long as size and modification time of the file do not
+    change; otherwise pages are reused one by one if their DVI code
+    did not change, which is the common case for documents that grew
+    at their end. In both cases, a page is scanned again if one of
+    the files referenced by its specials changed.
+
+    The caches of all documents are kept below a size limit, the least
+    recently used ones are removed first. */
+
+class dviPrescanCache {
+ public:
+  dviPrescanCache(const QString &dviFileName, const QByteArray &contextHash);
+
+  /** Reads the cache. */
+  void load();
+
+  /** Returns true if the file did not change since the cache was
+      written, so that all cached pages can be reused as they are. */
+  bool isUpToDate() const;
+
+  /** Returns true if the cache was written long ago, and should be
+      saved again even if nothing changed, so that it is not removed
+      as unused. */
+  bool isAging() const;
+
+  /** Returns the cached result for page @p pageIndex if its DVI code
+      hashes to @p hash, or 0. */
+  const PrescanPage *page(int pageIndex, const QByteArray &hash) const;
+
+  /** Returns the cached result for page @p pageIndex of an up to date
+      cache, or 0. */
+  const PrescanPage *page(int pageIndex) const;
+
+  void save(const QVector<PrescanPage> &pages) const;
+
+  static QByteArray pageHash(const quint8 *begin, const quint8 *end);
+
+ private:
+  QString fileName;
+  QByteArray contextHash;
+  QString cacheFileName;
+  qint64 size;
+  QDateTime lastModified;
+
+  bool upToDate;
+  QDateTime lastSaved;
+  QVector<PrescanPage> pages;
+};
+
+#endif
@@ -45,7 +45,7 @@
 
 dviRenderer::dviRenderer(bool useFontHinting)
   : dviFile(0),
-    font_pool(useFontHinting),
+    font_pool(new fontPool(useFontHinting)),
     resolutionInDPI(0),
     embedPS_progress(0),
     embedPS_numOfProgressedFiles(0),
@@ -64,18 +64,49 @@ dviRenderer::dviRenderer(bool useFontHinting)
     currentlyDrawnPage(0),
     m_eventLoop(0),
     foreGroundPainter(0),
-    fontpoolLocateFontsDone(false)
+    fontpoolLocateFontsDone(false),
+    prescanRecord(0),
+    documentRenderer(0)
 {
 #ifdef DEBUG_DVIRENDERER
   //qCDebug(OkularDviDebug) << "dviRenderer( parent=" << par << " )";
 #endif
 
-  connect(&font_pool, &fontPool::error, this, &dviRenderer::error);
-  connect(&font_pool, &fontPool::warning, this, &dviRenderer::warning);
+  connect(font_pool, &fontPool::error, this, &dviRenderer::error);
+  connect(font_pool, &fontPool::warning, this, &dviRenderer::warning);
   connect(PS_interface, &ghostscript_interface::error, this, &dviRenderer::error);
 }
 
 
+dviRenderer::dviRenderer(dviRenderer *document)
+  : dviFile(document->dviFile),
+    baseURL(document->baseURL),
+    font_pool(document->font_pool),
+    resolutionInDPI(0),
+    embedPS_progress(0),
+    embedPS_numOfProgressedFiles(0),
+    shrinkfactor(3),
+    source_href(0),
+    HTML_href(0),
+    editorCommand(document->editorCommand),
+    PostScriptOutPutString(0),
+    PS_interface(document->PS_interface),
+    _postscript(document->_postscript),
+    line_boundary_encountered(false),
+    word_boundary_encountered(false),
+    current_page(0),
+    penWidth_in_mInch(0),
+    number_of_elements_in_path(0),
+    currentlyDrawnPage(0),
+    m_eventLoop(0),
+    foreGroundPainter(0),
+    fontpoolLocateFontsDone(true),
+    prescanRecord(0),
+    documentRenderer(document)
+{
+}
+
+
 dviRenderer::~dviRenderer()
 {
 #ifdef DEBUG_DVIRENDERER
@@ -84,8 +115,30 @@ dviRenderer::~dviRenderer()
 
   QMutexLocker locker(&mutex);
 
-  delete PS_interface;
-  delete dviFile;
+  // Render contexts only borrow the document data
+  if (documentRenderer == 0) {
+    delete PS_interface;
+    delete dviFile;
+    delete font_pool;
+  }
+}
+
+
+dviRenderer* dviRenderer::createRenderContext()
+{
+  if (documentRenderer != 0)
+    return documentRenderer->createRenderContext();
+
+  QMutexLocker locker(&mutex);
+
+  // The render contexts share the fonts, so they must all be located
+  // before the first context draws anything
+  if ( !fontpoolLocateFontsDone ) {
+    font_pool->locateFonts();
+    fontpoolLocateFontsDone = true;
+  }
+
+  return new dviRenderer(this);
 }
 
 #if 0
@@ -94,7 +147,7 @@ void dviRenderer::setPrefs(bool flag_showPS, const QString &str_editorCommand, b
   //QMutexLocker locker(&mutex);
   _postscript = flag_showPS;
   editorCommand = str_editorCommand;
-  font_pool.setParameters( useFontHints );
+  font_pool->setParameters( useFontHints );
 }
 
 #endif
@@ -146,7 +199,7 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
      complicated) in case it was still in the document loading section.
    */
   if ( !fontpoolLocateFontsDone ) {
-    font_pool.locateFonts();
+    font_pool->locateFonts();
     fontpoolLocateFontsDone = true;
   }
 
@@ -458,7 +511,7 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
   }
 
   QApplication::setOverrideCursor( Qt::WaitCursor );
-  dvifile *dviFile_new = new dvifile(filename, &font_pool);
+  dvifile *dviFile_new = new dvifile(filename, font_pool);
 
   if ((dviFile == 0) || (dviFile->filename != filename))
     dviFile_new->sourceSpecialMarker = true;
@@ -479,8 +532,8 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
   _isModified = false;
   baseURL = base;
 
-  font_pool.setExtraSearchPath( fi.absolutePath() );
-  font_pool.setCMperDVIunit( dviFile->getCmPerDVIunit() );
+  font_pool->setExtraSearchPath( fi.absolutePath() );
+  font_pool->setCMperDVIunit( dviFile->getCmPerDVIunit() );
 
   // Extract PostScript from the DVI file, and store the PostScript
   // specials in PostScriptDirectory, and the headers in the
@@ -517,29 +570,7 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
   //QTime preScanTimer;
   //preScanTimer.start();
 #endif
-  dviFile->numberOfExternalPSFiles = 0;
-  quint16 currPageSav = current_page;
-  prebookmarks.clear();
-
-  for(current_page=0; current_page < dviFile->total_pages; current_page++) {
-    PostScriptOutPutString = new QString();
-
-    if (current_page < dviFile->total_pages) {
-      command_pointer = dviFile->dvi_Data() + dviFile->page_offset[int(current_page)];
-      end_pointer     = dviFile->dvi_Data() + dviFile->page_offset[int(current_page+1)];
-    } else
-      command_pointer = end_pointer = 0;
-
-    memset((char *) &currinf.data, 0, sizeof(currinf.data));
-    currinf.fonttable = &(dviFile->tn_table);
-    currinf._virtual  = NULL;
-    prescan(&dviRenderer::prescan_parseSpecials);
-
-    if (!PostScriptOutPutString->isEmpty())
-      PS_interface->setPostScript(current_page, *PostScriptOutPutString);
-    delete PostScriptOutPutString;
-  }
-  PostScriptOutPutString = NULL;
+  prescanDocument();
 
 #if 0
   // Generate the list of bookmarks
@@ -564,7 +595,6 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
 #ifdef PERFORMANCE_MEASUREMENT
   //qCDebug(OkularDviDebug) << "Time required for prescan phase: " << preScanTimer.restart() << "ms";
 #endif
-  current_page = currPageSav;
   // PRESCAN ENDS HERE
 
   pageSizes.resize(0);
@@ -673,8 +703,10 @@ void dviRenderer::setResolution(double resolution_in_DPI)
 
   resolutionInDPI = resolution_in_DPI;
 
-  // Pass the information on to the font pool.
-  font_pool.setDisplayResolution( resolutionInDPI );
+  // Pass the information on to the font pool. Render contexts share
+  // the pool, and pass their resolution on with each glyph instead.
+  if (documentRenderer == 0)
+    font_pool->setDisplayResolution( resolutionInDPI );
   shrinkfactor = 1200/resolutionInDPI;
   return;
 }
@@ -737,7 +769,7 @@ void dviRenderer::exportPDF()
 
 void dviRenderer::exportPS(const QString& fname, const QStringList& options, QPrinter* printer, QPrinter::Orientation orientation)
 {
-  QExplicitlySharedDataPointer<DVIExport> exporter(new DVIExportToPS(*this, fname, options, printer, font_pool.getUseFontHints(), orientation));
+  QExplicitlySharedDataPointer<DVIExport> exporter(new DVIExportToPS(*this, fname, options, printer, font_pool->getUseFontHints(), orientation));
   if (exporter->started())
     all_exports_[exporter.data()] = exporter;
 }
@@ -20,6 +20,7 @@
 #include "anchor.h"
 #include "prebookmark.h"
 
+#include <QColor>
 #include <QExplicitlySharedDataPointer>
 #include <QUrl>
 #include <QProgressDialog>
@@ -39,6 +40,7 @@ class ghostscript_interface;
 class QEventLoop;
 class QProgressDialog;
 class PreBookmark;
+class PrescanPage;
 class TeXFontDefinition;
 
 extern const int MFResolutions[];
@@ -95,6 +97,13 @@ public:
   dviRenderer(bool useFontHinting);
   virtual ~dviRenderer();
 
+  /** Creates a renderer that draws pages of this renderer's document.
+      It shares the DVI file, the fonts and the PostScript data with
+      this renderer, but has its own drawing state, so that several
+      pages can be drawn at the same time in different threads. The
+      document must not be changed while render contexts exist. */
+  dviRenderer*  createRenderContext();
+
   virtual bool  setFile(const QString &fname, const QUrl &base);
 
   dvifile* dviFile;
@@ -204,7 +213,7 @@ private:
 
   void  setResolution(double resolution_in_DPI);
 
-  fontPool      font_pool;
+  fontPool      *font_pool;
 
   double        resolutionInDPI;
 
@@ -223,6 +232,18 @@ private:
   void          prescan_ParsePSFileSpecial(const QString& cp);
   void          prescan_ParseSourceSpecial(const QString& cp);
   void          prescan_setChar(unsigned int ch);
+  void          prescan_setAnchor(const QString &name, const Anchor &anchor);
+
+  /** Prescans all pages of the document, reusing the results of the
+      prescan cache for the pages that did not change. */
+  void          prescanDocument();
+
+  /** Applies the cached prescan result of the current page. */
+  void          prescan_replay(const PrescanPage &page);
+
+  /** Hash of everything besides its own DVI code that the prescan of
+      a page depends on */
+  QByteArray    prescanContextHash() const;
 
   /* */
   QVector<PreBookmark> prebookmarks;
@@ -327,6 +348,17 @@ private:
 
   // was the locateFonts method of font pool executed?
   bool fontpoolLocateFontsDone;
+
+  // While prescanDocument() scans a page, this collects what the page
+  // contributes to the document; 0 otherwise
+  PrescanPage *prescanRecord;
+
+  // For render contexts, the renderer which owns the document data
+  // shared with this one; 0 if this renderer owns it
+  dviRenderer *documentRenderer;
+
+  // Used by createRenderContext()
+  explicit dviRenderer(dviRenderer *document);
 };
 
 #endif
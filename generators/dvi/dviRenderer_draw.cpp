@@ -73,6 +73,58 @@
 
 
 
+/** Draws a glyph mask in the given colour. Black glyphs, by far the
+    most common ones, are drawn straight from the mask; other colours
+    are applied to a copy. */
+
+static void drawGlyphMask(QPainter *painter, int x, int y, const QImage &mask, const QColor &color, bool alphaSupported)
+{
+  if (mask.isNull())
+    return;
+
+  if (alphaSupported && color == Qt::black) {
+    painter->drawImage(x, y, mask);
+    return;
+  }
+
+  QImage tinted(mask.width(), mask.height(), QImage::Format_ARGB32);
+  if (alphaSupported) {
+    // The glyph is a coloured rectangle, and its outline is defined by
+    // the alpha channel only. That ensures good quality rendering for
+    // overlapping characters.
+    for(int row=0; row<mask.height(); row++) {
+      const uchar *srcScanLine = mask.constScanLine(row);
+      QRgb *destScanLine = (QRgb *)tinted.scanLine(row);
+      for(int col=0; col<mask.width(); col++)
+        destScanLine[col] = qRgba(color.red(), color.green(), color.blue(), srcScanLine[col]);
+    }
+  } else {
+    // If the alpha channel is not supported, it is only used to store
+    // "maximally opaque" or "completely transparent" values, and the
+    // outline is defined by blending the colour with white. Overlapping
+    // characters are no longer correctly drawn, but quality is still
+    // sufficient for most purposes.
+    quint16 rInv = 0xFF - color.red();
+    quint16 gInv = 0xFF - color.green();
+    quint16 bInv = 0xFF - color.blue();
+
+    for(int row=0; row<mask.height(); row++) {
+      const uchar *srcScanLine = mask.constScanLine(row);
+      QRgb *destScanLine = (QRgb *)tinted.scanLine(row);
+      for(int col=0; col<mask.width(); col++) {
+        quint16 data = srcScanLine[col];
+        // data = 0 -> white; data = 0xff -> use "color"
+        destScanLine[col] = qRgba(0xFF - (rInv*data + 0x7F) / 0xFF,
+                                  0xFF - (gInv*data + 0x7F) / 0xFF,
+                                  0xFF - (bInv*data + 0x7F) / 0xFF,
+                                  (data > 0x03) ? 0xff : 0x00);
+      }
+    }
+  }
+  painter->drawImage(x, y, tinted);
+}
+
+
 /** Routine to print characters.  */
 
 void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
@@ -81,22 +133,21 @@ void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
   qCDebug(OkularDviDebug) << "set_char #" << ch;
 #endif
 
-  glyph *g;
-  if (colorStack.isEmpty())
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
-  else
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, colorStack.top());
+  TeXFont *font = (TeXFont *)(currinf.fontp->font);
+  glyph *g = font->getGlyph(ch);
   if (g == NULL)
     return;
 
   long dvi_h_sav = currinf.data.dvi_h;
 
-  QImage pix = g->shrunkenCharacter;
-  int x = ((int) ((currinf.data.dvi_h) / (shrinkfactor * 65536))) - g->x2;
-  int y = currinf.data.pxl_v - g->y2;
+  const glyphMask mask = font->getGlyphMask(ch, resolutionInDPI * currinf.fontp->enlargement);
+  const QImage &pix = mask.mask;
+  int x = ((int) ((currinf.data.dvi_h) / (shrinkfactor * 65536))) - mask.x2;
+  int y = currinf.data.pxl_v - mask.y2;
 
   // Draw the character.
-  foreGroundPainter->drawImage(x, y, pix);
+  drawGlyphMask(foreGroundPainter, x, y, pix, colorStack.isEmpty() ? globalColor : colorStack.top(),
+                font_pool->QPixmapSupportsAlpha);
 
   // Are we drawing text for a hyperlink? And are hyperlinks
   // enabled?
@@ -11,6 +11,7 @@
 #include "dviRenderer.h"
 #include "dvi.h"
 #include "dviFile.h"
+#include "dviPrescanCache.h"
 #include "debug_dvi.h"
 #include "prebookmark.h"
 #include "psgs.h"
@@ -23,6 +24,8 @@
 
 #include <QApplication>
 #include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDir>
 #include <QFileInfo>
 #include <QImage>
@@ -30,6 +33,8 @@
 #include <QProgressBar>
 #include <QTextStream>
 
+#include <algorithm>
+
 
 extern QPainter foreGroundPaint;
 extern void parse_special_argument(const QString& strg, const char* argument_name, int* variable);
@@ -245,6 +250,9 @@ void dviRenderer::prescan_ParsePapersizeSpecial(const QString& _cp)
   qCDebug(OkularDviDebug) << "Papersize-Special : papersize" << _cp;
 #endif
 
+  if (prescanRecord != 0)
+    prescanRecord->paperSizes.append(_cp);
+
   QString cp = _cp.simplified();
 
   if (cp[0] == QLatin1Char('=')) {
@@ -261,9 +269,12 @@ void dviRenderer::prescan_ParsePapersizeSpecial(const QString& _cp)
 void dviRenderer::prescan_ParseBackgroundSpecial(const QString& cp)
 {
   QColor col = parseColorSpecification(cp.trimmed());
-  if (col.isValid())
+  if (col.isValid()) {
+    if (prescanRecord != 0)
+      prescanRecord->background = col;
     for(quint16 page=current_page; page < dviFile->total_pages; page++)
       PS_interface->setBackgroundColor(page, col);
+  }
   return;
 }
 
@@ -274,7 +285,7 @@ void dviRenderer::prescan_ParseHTMLAnchorSpecial(const QString& _cp)
   cp.truncate(cp.indexOf(QLatin1Char('"')));
   Length l;
   l.setLength_in_inch(currinf.data.dvi_v/(resolutionInDPI*shrinkfactor));
-  anchorList[cp] = Anchor(current_page+1, l);
+  prescan_setAnchor(cp, Anchor(current_page+1, l));
 }
 
 
@@ -297,6 +308,9 @@ void dviRenderer::prescan_ParsePSHeaderSpecial(const QString& cp)
     _file = QString::fromLocal8Bit(proc.readLine().trimmed());
   }
 
+  if (prescanRecord != 0 && !_file.isEmpty())
+    prescanRecord->addDependency(_file);
+
   if (QFile::exists(_file))
     PS_interface->PostScriptHeaderString->append( QStringLiteral(" (%1) run\n").arg(_file) );
 }
@@ -360,7 +374,7 @@ void dviRenderer::prescan_ParsePSSpecial(const QString& cp)
         QString anchorName = cp.section(QLatin1Char('('), 1, 1).section(QLatin1Char(')'), 0, 0);
         Length l;
         l.setLength_in_inch(currinf.data.dvi_v/(resolutionInDPI*shrinkfactor));
-        anchorList[anchorName] = Anchor(current_page+1, l);
+        prescan_setAnchor(anchorName, Anchor(current_page+1, l));
       }
       // The PostScript code defines a bookmark
       if (cp.contains(QStringLiteral("/Dest")) && cp.contains(QStringLiteral("/Title"))) {
@@ -437,9 +451,16 @@ void dviRenderer::prescan_ParsePSFileSpecial(const QString& cp)
 
   // Now locate the Gfx file on the hard disk...
   EPSfilename = ghostscript_interface::locateEPSfile(EPSfilename, baseURL);
+  if (prescanRecord != 0)
+    prescanRecord->addDependency(EPSfilename);
 
   // If the EPSfilename really points to a PDF file, convert that file now.
   if (ending == QLatin1String("pdf")) {
+    // The converted file is temporary, so the page must be scanned
+    // again the next time
+    if (prescanRecord != 0)
+      prescanRecord->hash.clear();
+
     QString convErrorMsg;
     EPSfilename = dviFile->convertPDFtoPS(EPSfilename, &convErrorMsg);
     if (convErrorMsg.isEmpty() != true) {
@@ -592,6 +613,134 @@ void dviRenderer::prescan_parseSpecials(char *cp, quint8 *)
 }
 
 
+void dviRenderer::prescan_setAnchor(const QString &name, const Anchor &anchor)
+{
+  anchorList[name] = anchor;
+  if (prescanRecord != 0)
+    prescanRecord->anchors.append(qMakePair(name, anchor));
+}
+
+
+QByteArray dviRenderer::prescanContextHash() const
+{
+  QByteArray context;
+  QDataStream stream(&context, QIODevice::WriteOnly);
+  stream << dviFile->getMagnification() << dviFile->getCmPerDVIunit() << resolutionInDPI << shrinkfactor
+         << baseURL.toString();
+
+  // Character widths only count once the fonts have been loaded
+  QList<int> fontNumbers = dviFile->tn_table.keys();
+  std::sort(fontNumbers.begin(), fontNumbers.end());
+  foreach(int number, fontNumbers) {
+    const TeXFontDefinition *fontp = dviFile->tn_table.value(number);
+    stream << number << fontp->fontname << fontp->checksum << fontp->scaled_size_in_DVI_units
+           << fontp->enlargement << (fontp->set_char_p == &dviRenderer::set_char);
+  }
+
+  return QCryptographicHash::hash(context, QCryptographicHash::Md5);
+}
+
+
+void dviRenderer::prescanDocument()
+{
+  dviFile->numberOfExternalPSFiles = 0;
+  quint16 currPageSav = current_page;
+  prebookmarks.clear();
+
+  if (resolutionInDPI == 0.0)
+    setResolution(100);
+
+  dviPrescanCache cache(dviFile->filename, prescanContextHash());
+  cache.load();
+  const bool upToDate = cache.isUpToDate();
+
+  QVector<PrescanPage> pages(dviFile->total_pages);
+  bool changed = !upToDate;
+
+  for(current_page=0; current_page < dviFile->total_pages; current_page++) {
+    quint8 *begin = dviFile->dvi_Data() + dviFile->page_offset[int(current_page)];
+    quint8 *end   = dviFile->dvi_Data() + dviFile->page_offset[int(current_page+1)];
+
+    // If the file did not change, there is no need to hash the pages
+    QByteArray hash;
+    const PrescanPage *cached;
+    if (upToDate)
+      cached = cache.page(current_page);
+    else {
+      hash = dviPrescanCache::pageHash(begin, end);
+      cached = cache.page(current_page, hash);
+    }
+
+    if (cached != 0) {
+      prescan_replay(*cached);
+      pages[current_page] = *cached;
+      continue;
+    }
+
+    changed = true;
+    PrescanPage &record = pages[current_page];
+    record.hash = hash.isEmpty() ? dviPrescanCache::pageHash(begin, end) : hash;
+
+    const int sourceAnchorCount = sourceHyperLinkAnchors.count();
+    const int bookmarkCount = prebookmarks.count();
+    const int headerLength = PS_interface->PostScriptHeaderString->length();
+    const quint16 externalPSFiles = dviFile->numberOfExternalPSFiles;
+    const quint16 externalNONPSFiles = dviFile->numberOfExternalNONPSFiles;
+    prescanRecord = &record;
+
+    PostScriptOutPutString = new QString();
+
+    command_pointer = begin;
+    end_pointer     = end;
+
+    memset((char *) &currinf.data, 0, sizeof(currinf.data));
+    currinf.fonttable = &(dviFile->tn_table);
+    currinf._virtual  = NULL;
+    prescan(&dviRenderer::prescan_parseSpecials);
+
+    if (!PostScriptOutPutString->isEmpty())
+      PS_interface->setPostScript(current_page, *PostScriptOutPutString);
+    record.postScript = *PostScriptOutPutString;
+    delete PostScriptOutPutString;
+
+    prescanRecord = 0;
+    record.sourceAnchors      = sourceHyperLinkAnchors.mid(sourceAnchorCount);
+    record.bookmarks          = prebookmarks.mid(bookmarkCount);
+    record.postScriptHeader   = PS_interface->PostScriptHeaderString->mid(headerLength);
+    record.externalPSFiles    = dviFile->numberOfExternalPSFiles - externalPSFiles;
+    record.externalNONPSFiles = dviFile->numberOfExternalNONPSFiles - externalNONPSFiles;
+  }
+  PostScriptOutPutString = NULL;
+  current_page = currPageSav;
+
+  if (changed || cache.isAging())
+    cache.save(pages);
+}
+
+
+void dviRenderer::prescan_replay(const PrescanPage &page)
+{
+  foreach(const QString &paperSize, page.paperSizes)
+    prescan_ParsePapersizeSpecial(paperSize);
+
+  if (page.background.isValid())
+    for(quint16 p=current_page; p < dviFile->total_pages; p++)
+      PS_interface->setBackgroundColor(p, page.background);
+
+  for(int i=0; i<page.anchors.count(); i++)
+    anchorList[page.anchors[i].first] = page.anchors[i].second;
+
+  sourceHyperLinkAnchors += page.sourceAnchors;
+  prebookmarks += page.bookmarks;
+  PS_interface->PostScriptHeaderString->append(page.postScriptHeader);
+  dviFile->numberOfExternalPSFiles += page.externalPSFiles;
+  dviFile->numberOfExternalNONPSFiles += page.externalNONPSFiles;
+
+  if (!page.postScript.isEmpty())
+    PS_interface->setPostScript(current_page, page.postScript);
+}
+
+
 void dviRenderer::prescan_setChar(unsigned int ch)
 {
   TeXFontDefinition *fontp = currinf.fontp;
@@ -599,7 +748,7 @@ void dviRenderer::prescan_setChar(unsigned int ch)
     return;
 
   if (currinf.set_char_p == &dviRenderer::set_char) {
-    glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
+    glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch);
     if (g == NULL)
       return;
     currinf.data.dvi_h += (int)(currinf.fontp->scaled_size_in_DVI_units * dviFile->getCmPerDVIunit() *
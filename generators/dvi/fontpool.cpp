@@ -93,6 +93,7 @@ fontPool::~fontPool()
 #endif
 
   // need to manually clear the fonts _before_ freetype gets unloaded
+  glyphs.clear();
   qDeleteAll(fontList);
   fontList.clear();
 
@@ -106,14 +107,8 @@ fontPool::~fontPool()
 void fontPool::setParameters( bool _useFontHints )
 {
   // Check if glyphs need to be cleared
-  if (_useFontHints != useFontHints) {
-    double displayResolution = displayResolution_in_dpi;
-    QList<TeXFontDefinition*>::iterator it_fontp = fontList.begin();
-    for (; it_fontp != fontList.end(); ++it_fontp) {
-      TeXFontDefinition *fontp = *it_fontp;
-      fontp->setDisplayResolution(displayResolution * fontp->enlargement);
-    }
-  }
+  if (_useFontHints != useFontHints)
+    glyphs.clear();
 
   useFontHints = _useFontHints;
 }
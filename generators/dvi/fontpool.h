@@ -9,6 +9,7 @@
 
 #include "fontEncodingPool.h"
 #include "fontMap.h"
+#include "glyphCache.h"
 #include "TeXFontDefinition.h"
 
 #include <QList>
@@ -80,6 +81,9 @@ public:
   // This is the list which actually holds pointers to the fonts
   QList<TeXFontDefinition*> fontList;
 
+  // The shrunken glyphs of all fonts, at all display resolutions
+  glyphCache glyphs;
+
   // This method marks all fonts in the fontpool as "not in use". The
   // fonts are, however, not removed from memory until the method
   // release_fonts is called. The method is called when the dvi-file
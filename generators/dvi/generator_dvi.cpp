@@ -13,6 +13,7 @@
 #include <core/page.h>
 #include <core/sourcereference.h>
 #include <core/textpage.h>
+#include <core/utils.h>
 
 #include "generator_dvi.h"
 #include "debug_dvi.h"
@@ -31,6 +32,10 @@
 #include <qstack.h>
 #include <qtemporaryfile.h>
 #include <qmutex.h>
+#include <qpixmap.h>
+#include <qrunnable.h>
+#include <qthread.h>
+#include <qthreadpool.h>
 
 #include <KAboutData>
 #include <QtCore/QDebug>
@@ -42,8 +47,26 @@
 
 OKULAR_EXPORT_PLUGIN(DviGenerator, "libokularGenerator_dvi.json")
 
+class DviRenderJob : public QRunnable
+{
+    public:
+        DviRenderJob( DviGenerator *generator, Okular::PixmapRequest *request )
+            : m_generator( generator ), m_request( request )
+        {
+        }
+
+        void run() override
+        {
+            m_generator->renderPixmap( m_request );
+        }
+
+    private:
+        DviGenerator *m_generator;
+        Okular::PixmapRequest *m_request;
+};
+
 DviGenerator::DviGenerator( QObject *parent, const QVariantList &args ) : Okular::Generator( parent, args ),
-  m_fontExtracted( false ), m_docSynopsis( 0 ), m_dviRenderer( 0 )
+  m_fontExtracted( false ), m_docSynopsis( 0 ), m_dviRenderer( 0 ), m_renderJobs( 0 )
 {
     setFeature( Threaded );
     setFeature( TextExtraction );
@@ -51,6 +74,12 @@ DviGenerator::DviGenerator( QObject *parent, const QVariantList &args ) : Okular
     setFeature( PrintPostscript );
     if ( Okular::FilePrinter::ps2pdfAvailable() )
         setFeature( PrintToFile );
+
+    // the generator thread takes one core already
+    m_renderPool = new QThreadPool( this );
+    m_renderPool->setMaxThreadCount( qMax( 1, QThread::idealThreadCount() - 1 ) );
+
+    connect( this, &DviGenerator::imageDone, this, &DviGenerator::slotImageGenerated, Qt::QueuedConnection );
 }
 
 bool DviGenerator::loadDocument( const QString & fileName, QVector< Okular::Page * > &pagesVector )
@@ -107,6 +136,11 @@ bool DviGenerator::doCloseDocument()
 {
     delete m_docSynopsis;
     m_docSynopsis = 0;
+
+    m_renderPool->waitForDone();
+    qDeleteAll( m_renderContexts );
+    m_renderContexts.clear();
+    m_idleRenderContexts.clear();
     delete m_dviRenderer;
     m_dviRenderer = 0;
 
@@ -224,7 +258,15 @@ QImage DviGenerator::image( Okular::PixmapRequest *request )
         << endl;
 #endif
 
-        m_dviRenderer->drawPage( pageInfo );
+        // every page that is drawn gets a render context of its own, so
+        // that the other pages do not wait for it
+        dviRenderer *renderer = m_idleRenderContexts.isEmpty() ? createRenderContext() : m_idleRenderContexts.takeLast();
+        lock.unlock();
+
+        renderer->drawPage( pageInfo );
+
+        lock.relock();
+        m_idleRenderContexts.append( renderer );
 
         if ( ! pageInfo->img.isNull() )
         {
@@ -247,6 +289,61 @@ QImage DviGenerator::image( Okular::PixmapRequest *request )
     return ret;
 }
 
+dviRenderer *DviGenerator::createRenderContext()
+{
+    dviRenderer *renderer = m_dviRenderer->createRenderContext();
+
+    // created by whichever thread needed it first, but used by all of them
+    renderer->moveToThread( thread() );
+    connect(renderer, &dviRenderer::error, this, &DviGenerator::error);
+    connect(renderer, &dviRenderer::warning, this, &DviGenerator::warning);
+    connect(renderer, &dviRenderer::notice, this, &DviGenerator::notice);
+
+    m_renderContexts.append( renderer );
+    return renderer;
+}
+
+bool DviGenerator::canGeneratePixmap() const
+{
+    return Okular::Generator::canGeneratePixmap() || m_renderJobs < m_renderPool->maxThreadCount();
+}
+
+void DviGenerator::generatePixmap( Okular::PixmapRequest *request )
+{
+    // the generator thread gets the requests whenever it is free, as it
+    // extracts the text of the page too; the requests that come in
+    // meanwhile are drawn by the render pool
+    if ( Okular::Generator::canGeneratePixmap() )
+    {
+        Okular::Generator::generatePixmap( request );
+        return;
+    }
+
+    ++m_renderJobs;
+    if ( request->asynchronous() )
+        m_renderPool->start( new DviRenderJob( this, request ) );
+    else
+        slotImageGenerated( new QImage( image( request ) ), request );
+}
+
+void DviGenerator::renderPixmap( Okular::PixmapRequest *request )
+{
+    emit imageDone( new QImage( image( request ) ), request );
+}
+
+void DviGenerator::slotImageGenerated( QImage *img, Okular::PixmapRequest *request )
+{
+    --m_renderJobs;
+
+    if ( !request->isTile() && !request->page()->isBoundingBoxKnown() )
+        updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( img ) );
+
+    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( *img ) ), request->normalizedRect() );
+    delete img;
+
+    signalPixmapRequestDone( request );
+}
+
 Okular::TextPage* DviGenerator::textPage( Okular::Page *page )
 {
     qCDebug(OkularDviDebug);
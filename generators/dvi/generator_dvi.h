@@ -13,7 +13,9 @@
 #include <core/generator.h>
 
 #include <qbitarray.h>
+#include <qlist.h>
 
+class QThreadPool;
 class dviRenderer;
 class dviPageInfo;
 class Anchor;
@@ -44,12 +46,23 @@ class DviGenerator : public Okular::Generator
 
         QVariant metaData( const QString & key, const QVariant & option ) const override;
 
+        bool canGeneratePixmap() const override;
+        void generatePixmap( Okular::PixmapRequest * request ) override;
+
+    Q_SIGNALS:
+        void imageDone( QImage *image, Okular::PixmapRequest *request );
+
+    private Q_SLOTS:
+        void slotImageGenerated( QImage *img, Okular::PixmapRequest *request );
+
     protected:
         bool doCloseDocument() override;
         QImage image( Okular::PixmapRequest * request ) override;
         Okular::TextPage* textPage( Okular::Page *page ) override;
 
     private:
+        friend class DviRenderJob;
+
         double m_resolution;
         bool m_fontExtracted;
 
@@ -58,6 +71,18 @@ class DviGenerator : public Okular::Generator
         dviRenderer *m_dviRenderer;
         QBitArray m_linkGenerated;
 
+        // Render contexts of m_dviRenderer, one for each page that is
+        // drawn at the same time; guarded by the userMutex()
+        QList<dviRenderer*> m_renderContexts;
+        QList<dviRenderer*> m_idleRenderContexts;
+
+        // Draws the requests that come in while the generator thread is busy
+        QThreadPool *m_renderPool;
+        int m_renderJobs;
+
+        dviRenderer *createRenderContext();
+        void renderPixmap( Okular::PixmapRequest *request );
+
         void loadPages( QVector< Okular::Page * > & pagesVector );
         Okular::TextPage *extractTextFromPage( dviPageInfo *pageInfo );
         void fillViewportFromAnchor( Okular::DocumentViewport &vp, const Anchor &anch, 
@@ -36,3 +36,10 @@ glyph::glyph()
 
 glyph::~glyph()
 {}
+
+
+glyphMask::glyphMask()
+{
+  x2 = 0;
+  y2 = 0;
+}
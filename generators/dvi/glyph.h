@@ -3,7 +3,6 @@
 #ifndef _GLYPH_H
 #define _GLYPH_H
 
-#include <QColor>
 #include <QImage>
 
 
@@ -27,15 +26,21 @@ class glyph {
   // address of bitmap in font file
   long    addr;
 
-  QColor color;
-
   // DVI units to move reference point
   qint32 dvi_advance_in_units_of_design_size_by_2e20;
 
   // x and y offset in pixels
   short   x, y;
+};
+
+// The shrunken bitmap of a glyph at one display resolution. It only
+// holds coverage, the colour is applied when the glyph gets drawn.
+class glyphMask {
+ public:
+  glyphMask();
 
-  QImage shrunkenCharacter;
+  // Format_Alpha8 image, or a null image for empty glyphs
+  QImage mask;
 
   // x and y offset in pixels (shrunken bitmap)
   short   x2, y2;
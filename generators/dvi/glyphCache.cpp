@@ -0,0 +1,78 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// glyphCache.cpp
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#include <config.h>
+
+#include "glyphCache.h"
+
+#include <QHash>
+#include <QMutexLocker>
+
+// Memory the glyph masks of all resolutions may take together, in bytes
+static const int glyphCacheBudget = 32 * 1024 * 1024;
+
+
+uint qHash(const glyphCache::Key &key, uint seed)
+{
+  return qHash(key.font, seed) ^ qHash((key.resolution << 16) | key.ch, seed);
+}
+
+
+glyphCache::glyphCache()
+{
+  cache.setMaxCost(glyphCacheBudget);
+}
+
+
+glyphCache::Key glyphCache::makeKey(const TeXFont *font, quint16 ch, double resolution)
+{
+  Key key;
+  key.font = font;
+  key.ch = ch;
+  key.resolution = (quint32)(resolution*16.0 + 0.5);
+  return key;
+}
+
+
+bool glyphCache::find(const TeXFont *font, quint16 ch, double resolution, glyphMask *mask)
+{
+  QMutexLocker locker(&mutex);
+  glyphMask *cached = cache.object(makeKey(font, ch, resolution));
+  if (cached == 0)
+    return false;
+
+  *mask = *cached;
+  return true;
+}
+
+
+void glyphCache::insert(const TeXFont *font, quint16 ch, double resolution, const glyphMask &mask)
+{
+  // Empty masks are cached as well, so that missing characters are not
+  // looked up again; they cost one byte.
+  const int cost = qMax(1, mask.mask.bytesPerLine() * mask.mask.height());
+
+  QMutexLocker locker(&mutex);
+  cache.insert(makeKey(font, ch, resolution), new glyphMask(mask), cost);
+}
+
+
+void glyphCache::removeFont(const TeXFont *font)
+{
+  QMutexLocker locker(&mutex);
+  foreach(const Key &key, cache.keys()) {
+    if (key.font == font)
+      cache.remove(key);
+  }
+}
+
+
+void glyphCache::clear()
+{
+  QMutexLocker locker(&mutex);
+  cache.clear();
+}
@@ -0,0 +1,63 @@
+// -*- Mode: C++; c-basic-offset: 2; indent-tabs-mode: nil; c-brace-offset: 0; -*-
+// glyphCache.h
+//
+// Part of KDVI - A DVI previewer for the KDE desktop environment
+//
+// Distributed under the GPL
+
+#ifndef _GLYPHCACHE_H
+#define _GLYPHCACHE_H
+
+#include "glyph.h"
+
+#include <QCache>
+#include <QMutex>
+
+class TeXFont;
+
+
+/**
+ * Cache of the shrunken glyph masks of all the fonts of a fontPool.
+ *
+ * Masks are keyed by font, character and display resolution, so that
+ * zooming back to a resolution that was used before does not rasterise
+ * the glyphs again. The least recently used masks are dropped once the
+ * cache exceeds its memory budget. The cache is thread safe.
+ */
+class glyphCache {
+ public:
+  glyphCache();
+
+  /** Looks up the mask of character @p ch of @p font at @p resolution,
+      returns false if it is not cached. */
+  bool find(const TeXFont *font, quint16 ch, double resolution, glyphMask *mask);
+
+  void insert(const TeXFont *font, quint16 ch, double resolution, const glyphMask &mask);
+
+  /** Drops the masks of @p font, which is about to be deleted. */
+  void removeFont(const TeXFont *font);
+
+  void clear();
+
+ private:
+  struct Key {
+    const TeXFont *font;
+    quint16 ch;
+    // display resolution in 1/16 dpi, so that equal zoom levels
+    // compare equal in spite of rounding errors
+    quint32 resolution;
+
+    bool operator==(const Key &other) const
+    {
+      return font == other.font && ch == other.ch && resolution == other.resolution;
+    }
+  };
+  friend uint qHash(const Key &key, uint seed);
+
+  static Key makeKey(const TeXFont *font, quint16 ch, double resolution);
+
+  QMutex mutex;
+  QCache<Key, glyphMask> cache;
+};
+
+#endif
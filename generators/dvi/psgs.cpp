@@ -23,6 +23,7 @@
 
 #include <QtCore/qloggingcategory.h>
 #include <QDir>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPixmap>
 #include <QTextStream>
@@ -70,6 +71,8 @@ void ghostscript_interface::setPostScript(const PageNumber& page, const QString&
   qCDebug(OkularDviDebug) << "ghostscript_interface::setPostScript( " << page << ", ... )";
 #endif
 
+  QMutexLocker locker(&mutex);
+
   if (pageList.value(page) == 0) {
     pageInfo *info = new pageInfo(PostScript);
     // Check if dict is big enough
@@ -94,6 +97,8 @@ void ghostscript_interface::setBackgroundColor(const PageNumber& page, const QCo
   qCDebug(OkularDviDebug) << "ghostscript_interface::setBackgroundColor( " << page << ", " << background_color << " )";
 #endif
 
+  QMutexLocker locker(&mutex);
+
   if (pageList.value(page) == 0) {
     pageInfo *info = new pageInfo(QString::null);	//krazy:exclude=nullstrassign for old broken gcc
     info->background = background_color;
@@ -115,6 +120,8 @@ void ghostscript_interface::restoreBackgroundColor(const PageNumber& page)
 #ifdef DEBUG_PSGS
   qCDebug(OkularDviDebug) << "ghostscript_interface::restoreBackgroundColor( " << page << " )";
 #endif
+
+  QMutexLocker locker(&mutex);
   if (pageList.value(page) == 0)
     return;
 
@@ -130,6 +137,8 @@ QColor ghostscript_interface::getBackgroundColor(const PageNumber& page) const {
   qCDebug(OkularDviDebug) << "ghostscript_interface::getBackgroundColor( " << page << " )";
 #endif
 
+  QMutexLocker locker(&mutex);
+
   if (pageList.value(page) == 0)
     return Qt::white;
   else
@@ -138,6 +147,7 @@ QColor ghostscript_interface::getBackgroundColor(const PageNumber& page) const {
 
 
 void ghostscript_interface::clear() {
+  QMutexLocker locker(&mutex);
   PostScriptHeaderString->truncate(0);
 
   // Deletes all items, removes temporary files, etc.
@@ -157,6 +167,7 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber& page, co
   }
 
   pageInfo *info = pageList.value(page);
+  const QColor background = getBackgroundColor(page);
 
   // Generate a PNG-file
   // Step 1: Write the PostScriptString to a File
@@ -197,11 +208,11 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber& page, co
   if (!PostScriptHeaderString->toLatin1().isNull())
     os << PostScriptHeaderString->toLatin1();
 
-  if (info->background != Qt::white) {
+  if (background != Qt::white) {
     QString colorCommand = QStringLiteral("gsave %1 %2 %3 setrgbcolor clippath fill grestore\n").
-      arg(info->background.red()/255.0).
-      arg(info->background.green()/255.0).
-      arg(info->background.blue()/255.0);
+      arg(background.red()/255.0).
+      arg(background.green()/255.0).
+      arg(background.blue()/255.0);
     os << colorCommand.toLatin1();
   }
 
@@ -303,11 +314,6 @@ void ghostscript_interface::graphics(const PageNumber& page, double dpi, long ma
     return;
   }
 
-  resolution   = dpi;
-
-  pixel_page_w = paint->viewport().width();
-  pixel_page_h = paint->viewport().height();
-
   pageInfo *info = pageList.value(page);
 
   // No PostScript? Then return immediately.
@@ -318,6 +324,15 @@ void ghostscript_interface::graphics(const PageNumber& page, double dpi, long ma
     return;
   }
 
+  // The pages that are drawn at the same time take turns at running
+  // ghostscript
+  QMutexLocker locker(&gsMutex);
+
+  resolution   = dpi;
+
+  pixel_page_w = paint->viewport().width();
+  pixel_page_h = paint->viewport().height();
+
   QTemporaryFile gfxFile;
   gfxFile.open();
   const QString gfxFileName = gfxFile.fileName();
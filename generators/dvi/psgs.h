@@ -14,6 +14,7 @@
 #include <QColor>
 #include <QtGui/qevent.h>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
 
 class QUrl;
@@ -82,6 +83,15 @@ private:
   void                  gs_generate_graphics_file(const PageNumber& page, const QString& filename, long magnification);
   QHash<quint16,pageInfo*>   pageList;
 
+  // Guards the background colors of the pages, which are read and
+  // restored by all the pages that are drawn at the same time. The
+  // list itself only changes while the document is loaded.
+  mutable QMutex        mutex;
+
+  // Serialises the ghostscript runs, which use the fields below and
+  // the current output device
+  QMutex                gsMutex;
+
   double                resolution;   // in dots per inch
   int                   pixel_page_w; // in pixels
   int                   pixel_page_h; // in pixels
@@ -31,8 +31,12 @@
 
 OKULAR_EXPORT_PLUGIN(KIMGIOGenerator, "libokularGenerator_kimgio.json")
 
+// the memory the downscaled levels of the image may use together; the
+// level being used is kept even if it alone is bigger than this
+static const qint64 PyramidMemoryBudget = 64 * 1024 * 1024;
+
 KIMGIOGenerator::KIMGIOGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_levelsUseCounter( 0 )
 {
     setFeature( ReadRawData );
     setFeature( Threaded );
@@ -82,6 +86,10 @@ bool KIMGIOGenerator::loadDocumentInternal(const QByteArray & fileData, const QS
         exifMetadata.rotateExifQImage(m_img, exifMetadata.getImageOrientation());
     }
 
+    // the pyramid levels are built when first needed
+    m_levels.clear();
+    m_levelsUseCounter = 0;
+
     pagesVector.resize( 1 );
 
     Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
@@ -93,16 +101,83 @@ bool KIMGIOGenerator::loadDocumentInternal(const QByteArray & fileData, const QS
 bool KIMGIOGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_levels.clear();
 
     return true;
 }
 
+QImage KIMGIOGenerator::imageForSize( int width, int height )
+{
+    // find the smallest level which is still at least as big as requested
+    int level = 0;
+    QSize size = m_img.size();
+    while ( size.width() / 2 >= qMax( width, 1 ) && size.height() / 2 >= qMax( height, 1 ) )
+    {
+        size /= 2;
+        ++level;
+    }
+
+    if ( level == 0 )
+        return m_img;
+
+    if ( m_levels.count() < level )
+        m_levels.resize( level );
+
+    MipmapLevel & mipmap = m_levels[ level - 1 ];
+    if ( mipmap.image.isNull() )
+    {
+        // downscale the nearest bigger level that is available
+        const QImage * source = &m_img;
+        for ( int i = level - 2; i >= 0; --i )
+        {
+            if ( !m_levels.at( i ).image.isNull() )
+            {
+                source = &m_levels.at( i ).image;
+                break;
+            }
+        }
+        mipmap.image = source->scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    }
+    mipmap.lastUse = ++m_levelsUseCounter;
+
+    evictLevels( level - 1 );
+
+    return mipmap.image;
+}
+
+void KIMGIOGenerator::evictLevels( int keep )
+{
+    qint64 used = 0;
+    for ( int i = 0; i < m_levels.count(); ++i )
+        used += m_levels.at( i ).image.byteCount();
+
+    // drop the least recently used levels until we are within budget
+    while ( used > PyramidMemoryBudget )
+    {
+        int victim = -1;
+        for ( int i = 0; i < m_levels.count(); ++i )
+        {
+            const MipmapLevel & mipmap = m_levels.at( i );
+            if ( i == keep || mipmap.image.isNull() )
+                continue;
+            if ( victim == -1 || mipmap.lastUse < m_levels.at( victim ).lastUse )
+                victim = i;
+        }
+        if ( victim == -1 )
+            break;
+
+        used -= m_levels.at( victim ).image.byteCount();
+        m_levels[ victim ].image = QImage();
+    }
+}
+
 QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
 {
-    // perform a smooth scaled generation
+    // perform a smooth scaled generation from the closest pyramid level
     if ( request->isTile() )
     {
-        const QRect srcRect = request->normalizedRect().geometry( m_img.width(), m_img.height() );
+        const QImage source = imageForSize( request->width(), request->height() );
+        const QRect srcRect = request->normalizedRect().geometry( source.width(), source.height() );
         const QRect destRect = request->normalizedRect().geometry( request->width(), request->height() );
 
         QImage destImg( destRect.size(), QImage::Format_RGB32 );
@@ -110,7 +185,7 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
 
         QPainter p( &destImg );
         p.setRenderHint( QPainter::SmoothPixmapTransform );
-        p.drawImage( destImg.rect(), m_img, srcRect );
+        p.drawImage( destImg.rect(), source, srcRect );
 
         return destImg;
     }
@@ -121,7 +196,11 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
         if ( request->page()->rotation() % 2 == 1 )
             qSwap( width, height );
 
-        return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+        const QImage source = imageForSize( width, height );
+        if ( source.size() == QSize( width, height ) )
+            return source;
+
+        return source.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
     }
 }
 
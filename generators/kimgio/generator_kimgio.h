@@ -14,6 +14,7 @@
 #include <core/document.h>
 
 #include <QtGui/QImage>
+#include <QtCore/QVector>
 
 class KIMGIOGenerator : public Okular::Generator
 {
@@ -41,8 +42,23 @@ class KIMGIOGenerator : public Okular::Generator
     private:
         bool loadDocumentInternal(const QByteArray & fileData, const QString & fileName,
                                   QVector<Okular::Page*> & pagesVector );
+        QImage imageForSize( int width, int height );
+        void evictLevels( int keep );
+
+        // a level of the mipmap pyramid of m_img, built on demand
+        struct MipmapLevel
+        {
+            MipmapLevel() : lastUse( 0 ) {}
+
+            QImage image;
+            quint64 lastUse;
+        };
+
     private:
         QImage m_img;
+        // m_levels[i] is m_img scaled down by 2^(i+1)
+        QVector<MipmapLevel> m_levels;
+        quint64 m_levelsUseCounter;
         Okular::DocumentInfo docInfo;
 };
 
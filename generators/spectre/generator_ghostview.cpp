@@ -41,15 +41,15 @@ OKULAR_EXPORT_PLUGIN(GSGenerator, "libokularGenerator_ghostview.json")
 
 GSGenerator::GSGenerator( QObject *parent, const QVariantList &args ) :
     Okular::Generator( parent, args ),
-    m_internalDocument(0),
-    m_request(0)
+    m_internalDocument(0)
 {
     setFeature( PrintPostscript );
     setFeature( PrintToFile );
+    setFeature( TiledRendering );
 
-    GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
-    if (!renderer->isRunning()) renderer->start();
-    connect(renderer, &GSRendererThread::imageDone, this, &GSGenerator::slotImageGenerated, Qt::QueuedConnection);
+    GSRendererPool *renderers = GSRendererPool::getCreatePool();
+    renderers->setThreadCount(GSSettings::renderThreads());
+    connect(renderers, &GSRendererPool::imageDone, this, &GSGenerator::slotImageGenerated, Qt::QueuedConnection);
 }
 
 GSGenerator::~GSGenerator()
@@ -74,6 +74,7 @@ bool GSGenerator::reparseConfig()
     SET_HINT(TextAntialiasMetaData, true, AAtext)
 #undef SET_HINT
     }
+    GSRendererPool::getCreatePool()->setThreadCount(GSSettings::renderThreads());
     return changed;
 }
 
@@ -171,17 +172,16 @@ bool GSGenerator::doCloseDocument()
 
 void GSGenerator::slotImageGenerated(QImage *img, Okular::PixmapRequest *request)
 {
-    // This can happen as GSInterpreterCMD is a singleton and on creation signals all the slots
+    // This can happen as GSRendererPool is a singleton and signals all the slots
     // of all the generators attached to it
-    if (request != m_request) return;
+    if (!m_requests.remove(request)) return;
 
-    if ( !request->page()->isBoundingBoxKnown() )
+    if ( !request->isTile() && !request->page()->isBoundingBoxKnown() )
         updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( img ) );
 
-    m_request = 0;
     QPixmap *pix = new QPixmap(QPixmap::fromImage(*img));
     delete img;
-    request->page()->setPixmap( request->observer(), pix );
+    request->page()->setPixmap( request->observer(), pix, request->normalizedRect() );
     signalPixmapRequestDone( request );
 }
 
@@ -212,8 +212,6 @@ void GSGenerator::generatePixmap( Okular::PixmapRequest * req )
 
     SpectrePage *page = spectre_document_get_page(m_internalDocument, req->pageNumber());
 
-    GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
-
     GSRendererThreadRequest gsreq(this);
     gsreq.spectrePage = page;
     gsreq.platformFonts = GSSettings::platformFonts();
@@ -237,13 +235,13 @@ void GSGenerator::generatePixmap( Okular::PixmapRequest * req )
                               (double)req->height() / req->page()->height() );
     }
     gsreq.request = req;
-    m_request = req;
-    renderer->addRequest(gsreq);
+    m_requests.insert(req);
+    GSRendererPool::getCreatePool()->addRequest(gsreq);
 }
 
 bool GSGenerator::canGeneratePixmap() const
 {
-    return !m_request;
+    return m_requests.count() < GSRendererPool::getCreatePool()->threadCount();
 }
 
 Okular::DocumentInfo GSGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
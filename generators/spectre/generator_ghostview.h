@@ -13,6 +13,8 @@
 #include <core/generator.h>
 #include <interfaces/configinterface.h>
 
+#include <qset.h>
+
 #include <libspectre/spectre.h>
 
 class GSGenerator : public Okular::Generator, public Okular::ConfigInterface
@@ -61,7 +63,8 @@ class GSGenerator : public Okular::Generator, public Okular::ConfigInterface
         // backendish stuff
         SpectreDocument *m_internalDocument;
 
-        Okular::PixmapRequest *m_request;
+        // the requests being rendered by the GSRendererPool
+        QSet<Okular::PixmapRequest*> m_requests;
 
         bool cache_AAtext;
         bool cache_AAgfx;
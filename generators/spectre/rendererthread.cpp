@@ -13,19 +13,72 @@
 
 #include "spectre_debug.h"
 
+#include "core/area.h"
 #include "core/generator.h"
 #include "core/page.h"
 #include "core/utils.h"
 
-GSRendererThread *GSRendererThread::theRenderer = 0;
+GSRendererPool *GSRendererPool::thePool = 0;
 
-GSRendererThread *GSRendererThread::getCreateRenderer()
+GSRendererPool *GSRendererPool::getCreatePool()
 {
-    if (!theRenderer) theRenderer = new GSRendererThread();
-    return theRenderer;
+    if (!thePool) thePool = new GSRendererPool();
+    return thePool;
 }
 
-GSRendererThread::GSRendererThread()
+GSRendererPool::GSRendererPool()
+    : m_threadCount(0)
+{
+}
+
+void GSRendererPool::addRequest(const GSRendererThreadRequest &req)
+{
+    m_queueMutex.lock();
+    // less is better, requests of the same priority are rendered in order
+    QLinkedList<GSRendererThreadRequest>::iterator it = m_queue.begin();
+    while (it != m_queue.end() && (!(*it).request || (*it).request->priority() <= req.request->priority()))
+        ++it;
+    m_queue.insert(it, req);
+    m_queueMutex.unlock();
+    m_semaphore.release();
+}
+
+GSRendererThreadRequest GSRendererPool::takeRequest()
+{
+    m_semaphore.acquire();
+    QMutexLocker locker(&m_queueMutex);
+    return m_queue.takeFirst();
+}
+
+void GSRendererPool::setThreadCount(int count)
+{
+    count = qMax(1, count);
+
+    for ( ; m_threadCount < count; ++m_threadCount)
+    {
+        GSRendererThread *renderer = new GSRendererThread(this);
+        connect(renderer, &GSRendererThread::imageDone, this, &GSRendererPool::imageDone, Qt::DirectConnection);
+        connect(renderer, &QThread::finished, renderer, &QObject::deleteLater);
+        renderer->start();
+    }
+
+    // whichever renderers are idle first quit
+    for ( ; m_threadCount > count; --m_threadCount)
+    {
+        m_queueMutex.lock();
+        m_queue.prepend(GSRendererThreadRequest(0));
+        m_queueMutex.unlock();
+        m_semaphore.release();
+    }
+}
+
+int GSRendererPool::threadCount() const
+{
+    return m_threadCount;
+}
+
+GSRendererThread::GSRendererThread(GSRendererPool *pool)
+    : m_pool(pool)
 {
     m_renderContext = spectre_render_context_new();
 }
@@ -35,102 +88,125 @@ GSRendererThread::~GSRendererThread()
     spectre_render_context_free(m_renderContext);
 }
 
-void GSRendererThread::addRequest(const GSRendererThreadRequest &req)
+void GSRendererThread::run()
 {
-    m_queueMutex.lock();
-    m_queue.enqueue(req);
-    m_queueMutex.unlock();
-    m_semaphore.release();
+    while(1)
+    {
+        const GSRendererThreadRequest req = m_pool->takeRequest();
+        if (!req.request)
+            return;
+
+        render(req);
+    }
 }
 
-void GSRendererThread::run()
+void GSRendererThread::render(const GSRendererThreadRequest &req)
 {
-    while(1)
+    spectre_render_context_set_scale(m_renderContext, req.magnify, req.magnify);
+    spectre_render_context_set_use_platform_fonts(m_renderContext, req.platformFonts);
+    spectre_render_context_set_antialias_bits(m_renderContext, req.graphicsAAbits, req.textAAbits);
+    // Do not use spectre_render_context_set_rotation makes some files not render correctly, e.g. bug210499.ps
+    // so we basically do the rendering without any rotation and then rotate to the orientation as needed
+    // spectre_render_context_set_rotation(m_renderContext, req.orientation);
+
+    unsigned char *data = NULL;
+    int row_length = 0;
+    int pageWidth = req.request->width();
+    int pageHeight = req.request->height();
+
+    if ( req.orientation % 2 )
+        qSwap( pageWidth, pageHeight );
+
+    // the area to render, in the coordinates of the unrotated page
+    QRect area( 0, 0, pageWidth, pageHeight );
+    QSize wantedSize( req.request->width(), req.request->height() );
+    if ( req.request->isTile() )
     {
-        m_semaphore.acquire();
+        const Okular::NormalizedRect &rect = req.request->normalizedRect();
+        Okular::NormalizedRect unrotated = rect;
+        switch (req.orientation)
         {
-            m_queueMutex.lock();
-            GSRendererThreadRequest req = m_queue.dequeue();
-            m_queueMutex.unlock();
-
-            spectre_render_context_set_scale(m_renderContext, req.magnify, req.magnify);
-            spectre_render_context_set_use_platform_fonts(m_renderContext, req.platformFonts);
-            spectre_render_context_set_antialias_bits(m_renderContext, req.graphicsAAbits, req.textAAbits);
-            // Do not use spectre_render_context_set_rotation makes some files not render correctly, e.g. bug210499.ps
-            // so we basically do the rendering without any rotation and then rotate to the orientation as needed
-            // spectre_render_context_set_rotation(m_renderContext, req.orientation);
-
-            unsigned char *data = NULL;
-            int row_length = 0;
-            int wantedWidth = req.request->width();
-            int wantedHeight = req.request->height();
-
-            if ( req.orientation % 2 )
-                qSwap( wantedWidth, wantedHeight );
-
-            spectre_page_render(req.spectrePage, m_renderContext, &data, &row_length);
-
-            // Qt needs the missing alpha of QImage::Format_RGB32 to be 0xff
-            if (data && data[3] != 0xff)
-            {
-                for (int i = 3; i < row_length * wantedHeight; i += 4)
-                    data[i] = 0xff;
-            }
-
-            QImage img;
-            if (row_length == wantedWidth * 4)
-            {
-                img = QImage(data, wantedWidth, wantedHeight, QImage::Format_RGB32);
-            }
-            else
-            {
-                // In case this ends up beign very slow we can try with some memmove
-                QImage aux(data, row_length / 4, wantedHeight, QImage::Format_RGB32);
-                img = QImage(aux.copy(0, 0, wantedWidth, wantedHeight));
-            }
-
-            switch (req.orientation)
-            {
-                case Okular::Rotation90:
-                {
-                    QTransform m;
-                    m.rotate(90);
-                    img = img.transformed( m );
-                    break;
-                }
-
-                case Okular::Rotation180:
-                {
-                    QTransform m;
-                    m.rotate(180);
-                    img = img.transformed( m );
-                    break;
-                }
-                case Okular::Rotation270:
-                {
-                    QTransform m;
-                    m.rotate(270);
-                    img = img.transformed( m );
-                }
-            }
-
-            QImage *image = new QImage(img.copy());
-            free(data);
-
-            if (image->width() != req.request->width() || image->height() != req.request->height())
-            {
-                qCWarning(OkularSpectreDebug).nospace() << "Generated image does not match wanted size: "
-                    << "[" << image->width() << "x" << image->height() << "] vs requested "
-                    << "[" << req.request->width() << "x" << req.request->height() << "]";
-                QImage aux = image->scaled(wantedWidth, wantedHeight);
-                delete image;
-                image = new QImage(aux);
-            }
-            emit imageDone(image, req.request);
-
-            spectre_page_free(req.spectrePage);
+            case Okular::Rotation90:
+                unrotated = Okular::NormalizedRect( rect.top, 1 - rect.right, rect.bottom, 1 - rect.left );
+                break;
+            case Okular::Rotation180:
+                unrotated = Okular::NormalizedRect( 1 - rect.right, 1 - rect.bottom, 1 - rect.left, 1 - rect.top );
+                break;
+            case Okular::Rotation270:
+                unrotated = Okular::NormalizedRect( 1 - rect.bottom, rect.left, 1 - rect.top, rect.right );
+                break;
         }
+        area = unrotated.geometry( pageWidth, pageHeight ).intersected( area );
+        wantedSize = rect.geometry( req.request->width(), req.request->height() ).size();
     }
+
+    if ( req.request->isTile() )
+        spectre_page_render_slice(req.spectrePage, m_renderContext, area.x(), area.y(), area.width(), area.height(), &data, &row_length);
+    else
+        spectre_page_render(req.spectrePage, m_renderContext, &data, &row_length);
+
+    const int wantedWidth = area.width();
+    const int wantedHeight = area.height();
+
+    // Qt needs the missing alpha of QImage::Format_RGB32 to be 0xff
+    if (data && data[3] != 0xff)
+    {
+        for (int i = 3; i < row_length * wantedHeight; i += 4)
+            data[i] = 0xff;
+    }
+
+    QImage img;
+    if (row_length == wantedWidth * 4)
+    {
+        img = QImage(data, wantedWidth, wantedHeight, QImage::Format_RGB32);
+    }
+    else
+    {
+        // In case this ends up beign very slow we can try with some memmove
+        QImage aux(data, row_length / 4, wantedHeight, QImage::Format_RGB32);
+        img = QImage(aux.copy(0, 0, wantedWidth, wantedHeight));
+    }
+
+    switch (req.orientation)
+    {
+        case Okular::Rotation90:
+        {
+            QTransform m;
+            m.rotate(90);
+            img = img.transformed( m );
+            break;
+        }
+
+        case Okular::Rotation180:
+        {
+            QTransform m;
+            m.rotate(180);
+            img = img.transformed( m );
+            break;
+        }
+        case Okular::Rotation270:
+        {
+            QTransform m;
+            m.rotate(270);
+            img = img.transformed( m );
+        }
+    }
+
+    QImage *image = new QImage(img.copy());
+    free(data);
+
+    if (image->size() != wantedSize)
+    {
+        qCWarning(OkularSpectreDebug).nospace() << "Generated image does not match wanted size: "
+            << "[" << image->width() << "x" << image->height() << "] vs requested "
+            << "[" << wantedSize.width() << "x" << wantedSize.height() << "]";
+        QImage aux = image->scaled(wantedSize);
+        delete image;
+        image = new QImage(aux);
+    }
+    emit imageDone(image, req.request);
+
+    spectre_page_free(req.spectrePage);
 }
 
 /* kate: replace-tabs on; indent-width 4; */
@@ -10,8 +10,8 @@
 #ifndef _OKULAR_GSRENDERERTHREAD_H_
 #define _OKULAR_GSRENDERERTHREAD_H_
 
+#include <qlinkedlist.h>
 #include <qmutex.h>
-#include <qqueue.h>
 #include <qsemaphore.h>
 #include <qstring.h>
 #include <qthread.h>
@@ -50,31 +50,69 @@ struct GSRendererThreadRequest
 };
 Q_DECLARE_TYPEINFO(GSRendererThreadRequest, Q_MOVABLE_TYPE);
 
+class GSRendererPool;
+
+/**
+ * One renderer of the GSRendererPool, with a spectre render context of
+ * its own.
+ */
 class GSRendererThread : public QThread
 {
 Q_OBJECT
     public:
-        static GSRendererThread *getCreateRenderer();
-
+        explicit GSRendererThread(GSRendererPool *pool);
         ~GSRendererThread();
 
+    Q_SIGNALS:
+        void imageDone(QImage *image, Okular::PixmapRequest *request);
+
+    private:
+        void run() override;
+        void render(const GSRendererThreadRequest &req);
+
+        GSRendererPool *m_pool;
+        SpectreRenderContext *m_renderContext;
+};
+
+/**
+ * The renderers shared by all the documents.
+ *
+ * The requests wait in a single queue, ordered by their priority, that
+ * all the renderers take requests from.
+ */
+class GSRendererPool : public QObject
+{
+Q_OBJECT
+    public:
+        static GSRendererPool *getCreatePool();
+
         void addRequest(const GSRendererThreadRequest &req);
 
+        /**
+         * Starts or stops renderers until there are @p count of them.
+         */
+        void setThreadCount(int count);
+        int threadCount() const;
+
     Q_SIGNALS:
         void imageDone(QImage *image, Okular::PixmapRequest *request);
 
     private:
-        GSRendererThread();
+        friend class GSRendererThread;
 
-        QSemaphore m_semaphore;
+        GSRendererPool();
 
-        static GSRendererThread *theRenderer;
+        // Blocks until there is a request. Requests without an
+        // Okular::PixmapRequest tell the renderer to quit.
+        GSRendererThreadRequest takeRequest();
 
-        void run() override;
+        static GSRendererPool *thePool;
 
-        SpectreRenderContext *m_renderContext;
-        QQueue<GSRendererThreadRequest> m_queue;
+        QSemaphore m_semaphore;
+        QLinkedList<GSRendererThreadRequest> m_queue;
         QMutex m_queueMutex;
+
+        int m_threadCount;
 };
 
 #endif
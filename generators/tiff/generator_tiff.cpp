@@ -16,6 +16,7 @@
 #include <qimage.h>
 #include <qlist.h>
 #include <qpainter.h>
+#include <qvector.h>
 #include <QtPrintSupport/QPrinter>
 
 #include <kaboutdata.h>
@@ -30,6 +31,8 @@
 #include <tiff.h>
 #include <tiffio.h>
 
+#include <algorithm>
+
 #define TiffDebug 4714
 
 tsize_t okular_tiffReadProc( thandle_t handle, tdata_t buf, tsize_t size )
@@ -85,17 +88,111 @@ void okular_tiffUnmapProc( thandle_t, tdata_t, toff_t )
 }
 
 
+// a reduced resolution version of a page, stored either as a SubIFD of
+// the page directory or as a directory of its own following the page
+struct ReducedImage
+{
+    tdir_t directory;
+    toff_t subIfdOffset;
+    uint32 width;
+    uint32 height;
+};
+
+static bool reducedImageWiderThan( const ReducedImage & a, const ReducedImage & b )
+{
+    return a.width > b.width;
+}
+
 class TIFFGenerator::Private
 {
     public:
         Private()
           : tiff( 0 ), dev( 0 ) {}
 
+        const ReducedImage * reducedImageFor( int page, int width, int height ) const;
+        bool setReducedImage( const ReducedImage & image );
+
         TIFF* tiff;
         QByteArray data;
         QIODevice* dev;
+        // the reduced resolution images of each page, biggest first
+        QHash< int, QVector< ReducedImage > > reducedImages;
 };
 
+const ReducedImage * TIFFGenerator::Private::reducedImageFor( int page, int width, int height ) const
+{
+    // the smallest image that does not need to be scaled up
+    const ReducedImage * best = 0;
+    QHash< int, QVector< ReducedImage > >::const_iterator it = reducedImages.constFind( page );
+    if ( it == reducedImages.constEnd() )
+        return 0;
+
+    foreach ( const ReducedImage & image, it.value() )
+    {
+        if ( (int)image.width < width || (int)image.height < height )
+            break;
+        best = &image;
+    }
+    return best;
+}
+
+bool TIFFGenerator::Private::setReducedImage( const ReducedImage & image )
+{
+    if ( !TIFFSetDirectory( tiff, image.directory ) )
+        return false;
+    return image.subIfdOffset == 0 || TIFFSetSubDirectory( tiff, image.subIfdOffset );
+}
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+// TIFFRGBAImage packs pixels as ABGR words, which are RGBA bytes in memory
+static const QImage::Format tiffRasterFormat = QImage::Format_RGBA8888;
+#else
+static const QImage::Format tiffRasterFormat = QImage::Format_RGB32;
+#endif
+
+static QImage convertTiffRaster( QImage & raster )
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // let Qt swizzle the channels with its vectorized conversions
+    return raster.convertToFormat( QImage::Format_RGB32 );
+#else
+    // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
+    uint32 * data = (uint32 *)raster.bits();
+    const uint32 size = raster.width() * raster.height();
+    for ( uint32 i = 0; i < size; ++i )
+    {
+        const uint32 pixel = data[i];
+        data[i] = ( pixel & 0xFF00FF00 ) | ( ( pixel >> 16 ) & 0xFF ) | ( ( pixel & 0xFF ) << 16 );
+    }
+    return raster;
+#endif
+}
+
+// read the area rect of the current directory, decoding only the strips or
+// tiles covering it
+static QImage readTiffRegion( TIFF *tiff, const QRect & rect, uint32 orientation )
+{
+    char emsg[1024];
+    TIFFRGBAImage rgba;
+    if ( !TIFFRGBAImageOK( tiff, emsg ) || !TIFFRGBAImageBegin( &rgba, tiff, 0, emsg ) )
+    {
+        qCWarning(OkularTiffDebug) << "Cannot read the image:" << emsg;
+        return QImage();
+    }
+
+    rgba.req_orientation = orientation;
+    rgba.row_offset = rect.y();
+    rgba.col_offset = rect.x();
+
+    QImage raster( rect.size(), tiffRasterFormat );
+    const int ok = TIFFRGBAImageGet( &rgba, (uint32 *)raster.bits(), rect.width(), rect.height() );
+    TIFFRGBAImageEnd( &rgba );
+    if ( !ok )
+        return QImage();
+
+    return convertTiffRaster( raster );
+}
+
 static QDateTime convertTIFFDateTime( const char* tiffdate )
 {
     if ( !tiffdate )
@@ -164,6 +261,7 @@ TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
       d( new Private )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( ReadRawData );
@@ -227,6 +325,7 @@ bool TIFFGenerator::doCloseDocument()
         delete d->dev;
         d->dev = 0;
         d->data.clear();
+        d->reducedImages.clear();
         m_pageMapping.clear();
     }
 
@@ -238,7 +337,8 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
     bool generated = false;
     QImage img;
 
-    if ( TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
+    const int pageNumber = request->page()->number();
+    if ( TIFFSetDirectory( d->tiff, mapPage( pageNumber ) ) )
     {
         int rotation = request->page()->rotation();
         uint32 width = 1;
@@ -250,28 +350,43 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
         if ( !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
             orientation = ORIENTATION_TOPLEFT;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
+        int reqwidth = request->width();
+        int reqheight = request->height();
+        if ( rotation % 2 == 1 )
+            qSwap( reqwidth, reqheight );
+
+        // decode a reduced resolution image instead of the full page, if
+        // there is one big enough for the request
+        const ReducedImage * reduced = d->reducedImageFor( pageNumber, reqwidth, reqheight );
+        if ( reduced && d->setReducedImage( *reduced ) )
+        {
+            width = reduced->width;
+            height = reduced->height;
+        }
+        else if ( reduced )
+        {
+            TIFFSetDirectory( d->tiff, mapPage( pageNumber ) );
+        }
+
+        QRect srcRect( 0, 0, width, height );
+        QSize destSize( reqwidth, reqheight );
+        if ( request->isTile() )
+        {
+            srcRect = request->normalizedRect().geometry( width, height ).intersected( srcRect );
+            destSize = request->normalizedRect().geometry( request->width(), request->height() ).size();
+        }
 
         // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
+        if ( !srcRect.isEmpty() && !destSize.isEmpty() )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
+            QImage image = readTiffRegion( d->tiff, srcRect, orientation );
+            if ( !image.isNull() )
             {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+                if ( image.size() != destSize )
+                    image = image.scaled( destSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+                img = image;
+                generated = true;
             }
-
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if ( rotation % 2 == 1 )
-                qSwap( reqwidth, reqheight );
-            img = image.scaled( reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
-
-            generated = true;
         }
     }
 
@@ -354,6 +469,40 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
+        // reduced resolution versions of the previous page are not pages
+        uint32 subfileType = 0;
+        if ( realdirs > 0 && TIFFGetField( d->tiff, TIFFTAG_SUBFILETYPE, &subfileType ) && ( subfileType & FILETYPE_REDUCEDIMAGE ) )
+        {
+            const ReducedImage reduced = { i, 0, width, height };
+            d->reducedImages[ realdirs - 1 ].append( reduced );
+            continue;
+        }
+
+        // collect the reduced resolution images stored as SubIFDs
+        uint16 subIfdCount = 0;
+        toff_t * subIfdArray = 0;
+        if ( TIFFGetField( d->tiff, TIFFTAG_SUBIFD, &subIfdCount, &subIfdArray ) && subIfdCount > 0 )
+        {
+            // the array belongs to the current directory, copy it before moving away
+            QVector< toff_t > subIfds( subIfdCount );
+            std::copy( subIfdArray, subIfdArray + subIfdCount, subIfds.begin() );
+            foreach ( toff_t offset, subIfds )
+            {
+                uint32 subWidth = 0;
+                uint32 subHeight = 0;
+                subfileType = 0;
+                if ( TIFFSetSubDirectory( d->tiff, offset )
+                     && TIFFGetField( d->tiff, TIFFTAG_SUBFILETYPE, &subfileType ) && ( subfileType & FILETYPE_REDUCEDIMAGE )
+                     && TIFFGetField( d->tiff, TIFFTAG_IMAGEWIDTH, &subWidth ) == 1
+                     && TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &subHeight ) == 1 )
+                {
+                    const ReducedImage reduced = { i, offset, subWidth, subHeight };
+                    d->reducedImages[ realdirs ].append( reduced );
+                }
+            }
+            TIFFSetDirectory( d->tiff, i );
+        }
+
         adaptSizeToResolution( d->tiff, TIFFTAG_XRESOLUTION, dpi.width(), &width );
         adaptSizeToResolution( d->tiff, TIFFTAG_YRESOLUTION, dpi.height(), &height );
 
@@ -366,6 +515,12 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
     }
 
     pagesVector.resize( realdirs );
+
+    QHash< int, QVector< ReducedImage > >::iterator it = d->reducedImages.begin(), itEnd = d->reducedImages.end();
+    for ( ; it != itEnd; ++it )
+    {
+        std::sort( it.value().begin(), it.value().end(), reducedImageWiderThan );
+    }
 }
 
 bool TIFFGenerator::print( QPrinter& printer )
@@ -388,20 +543,12 @@ bool TIFFGenerator::print( QPrinter& printer )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
-
         // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, ORIENTATION_TOPLEFT ) != 0 )
+        QImage image = readTiffRegion( d->tiff, QRect( 0, 0, width, height ), ORIENTATION_TOPLEFT );
+        if ( image.isNull() )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
-            {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
+            image = QImage( width, height, QImage::Format_RGB32 );
+            image.fill( qRgb( 255, 255, 255 ) );
         }
 
         if ( i != 0 )
@@ -20,6 +20,12 @@ namespace Txt
             Document( const QString &fileName );
             ~Document();
 
+            /**
+             * Returns the name of the encoding detected for @p array,
+             * or an empty array if none could be detected.
+             */
+            static QByteArray detectEncoding( const QByteArray &array );
+
         private:
             QString toUnicode( const QByteArray &array );
     };
@@ -10,16 +10,224 @@
 
 #include "generator_txt.h"
 #include "converter.h"
+#include "mappeddocument.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+#include <QtGui/QFontDatabase>
+#include <QtGui/QFontMetricsF>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
 
 #include <KAboutData>
 #include <klocalizedstring.h>
 #include <KConfigDialog>
 
+#include <core/page.h>
+#include <core/textpage.h>
+
 OKULAR_EXPORT_PLUGIN(TxtGenerator, "libokularGenerator_txt.json")
 
+// files from this size on are memory mapped instead of being laid out by a QTextDocument
+static const qint64 MappedFileSize = 16 * 1024 * 1024;
+
+// pages of a mapped file handed out before its index is complete
+static const int InitialPages = 10;
+
+// how long each slice of background indexing runs, in milliseconds
+static const int IndexSliceTime = 20;
+
+// how often indexed pages are handed out to the document, in milliseconds
+static const int PublicationInterval = 1000;
+
+// margin around the text of mapped pages, in points
+static const int PageMargin = 36;
+
 TxtGenerator::TxtGenerator(QObject *parent, const QVariantList &args)
-    : Okular::TextDocumentGenerator(new Txt::Converter, QStringLiteral("okular_txt_generator_settings") , parent, args)
+    : Okular::TextDocumentGenerator(new Txt::Converter, QStringLiteral("okular_txt_generator_settings") , parent, args),
+      m_mappedDocument( 0 ), m_publishedPages( 0 ), m_ascent( 0 )
+{
+    m_indexTimer = new QTimer( this );
+    m_indexTimer->setSingleShot( true );
+    m_indexTimer->setInterval( 0 );
+    connect( m_indexTimer, SIGNAL(timeout()), this, SLOT(indexNextRows()) );
+}
+
+TxtGenerator::~TxtGenerator()
+{
+    delete m_mappedDocument;
+}
+
+Okular::Document::OpenResult TxtGenerator::loadDocumentWithPassword( const QString & fileName, QVector<Okular::Page*> & pagesVector, const QString &password )
 {
+    if ( QFileInfo( fileName ).size() < MappedFileSize )
+        return Okular::TextDocumentGenerator::loadDocumentWithPassword( fileName, pagesVector, password );
+
+    m_mappedDocument = new Txt::MappedDocument;
+    if ( !m_mappedDocument->open( fileName ) )
+    {
+        // decode the whole file instead, like for small files
+        delete m_mappedDocument;
+        m_mappedDocument = 0;
+        return Okular::TextDocumentGenerator::loadDocumentWithPassword( fileName, pagesVector, password );
+    }
+
+    // rows are laid out in a grid, so the font has to be fixed pitch
+    m_font = QFontDatabase::systemFont( QFontDatabase::FixedFont );
+    m_font.setPixelSize( 12 );
+    const QFontMetricsF metrics( m_font );
+    m_cellSize = QSizeF( metrics.width( QLatin1Char( 'M' ) ), metrics.lineSpacing() );
+    m_ascent = metrics.ascent();
+
+    setFeature( IncrementalPages );
+    while ( !m_mappedDocument->indexRows( IndexSliceTime ) && m_mappedDocument->pageCount() < InitialPages )
+        ;
+
+    m_publishedPages = m_mappedDocument->pageCount();
+    pagesVector = createPages( 0, m_publishedPages );
+
+    m_lastPublication.start();
+    if ( m_mappedDocument->isIndexed() )
+        finishIndexing();
+    else
+        m_indexTimer->start();
+
+    return Okular::Document::OpenSuccess;
+}
+
+bool TxtGenerator::doCloseDocument()
+{
+    if ( m_mappedDocument )
+    {
+        finishIndexing();
+        m_publishedPages = 0;
+
+        delete m_mappedDocument;
+        m_mappedDocument = 0;
+    }
+
+    return Okular::TextDocumentGenerator::doCloseDocument();
+}
+
+QSizeF TxtGenerator::pageSize() const
+{
+    return QSizeF( Txt::MappedDocument::Columns * m_cellSize.width() + 2 * PageMargin,
+                   Txt::MappedDocument::RowsPerPage * m_cellSize.height() + 2 * PageMargin );
+}
+
+QVector<Okular::Page*> TxtGenerator::createPages( int first, int last ) const
+{
+    const QSizeF size = pageSize();
+
+    QVector<Okular::Page*> pages;
+    pages.reserve( last - first );
+    for ( int i = first; i < last; ++i )
+        pages.append( new Okular::Page( i, size.width(), size.height(), Okular::Rotation0 ) );
+    return pages;
+}
+
+void TxtGenerator::indexNextRows()
+{
+    const bool finished = m_mappedDocument->indexRows( IndexSliceTime );
+
+    // hand out the pages in batches, the observers set up all of them again
+    if ( finished || m_lastPublication.elapsed() >= PublicationInterval )
+    {
+        const int pageCount = m_mappedDocument->pageCount();
+        if ( pageCount > m_publishedPages )
+        {
+            const QVector<Okular::Page*> pages = createPages( m_publishedPages, pageCount );
+            m_publishedPages = pageCount;
+            appendPages( pages );
+        }
+        m_lastPublication.restart();
+    }
+
+    if ( finished )
+        finishIndexing();
+    else
+        m_indexTimer->start();
+}
+
+void TxtGenerator::finishIndexing()
+{
+    m_indexTimer->stop();
+    setFeature( IncrementalPages, false );
+}
+
+QImage TxtGenerator::image( Okular::PixmapRequest *request )
+{
+    if ( !m_mappedDocument )
+        return Okular::TextDocumentGenerator::image( request );
+
+    const qreal pageWidth = pageSize().width();
+    const qreal pageHeight = pageSize().height();
+
+    // the area of the page to render, in pixels
+    QRect area( 0, 0, request->width(), request->height() );
+    if ( request->isTile() )
+        area = request->normalizedRect().geometry( request->width(), request->height() );
+
+    QImage image( area.size(), QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+
+    const QVector<Txt::MappedDocument::Row> rows = m_mappedDocument->pageRows( request->pageNumber() );
+
+    QPainter p( &image );
+    p.translate( -area.topLeft() );
+    p.scale( request->width() / pageWidth, request->height() / pageHeight );
+    p.setFont( m_font );
+    p.setPen( Qt::black );
+
+    // only draw the rows intersecting the area
+    const qreal top = area.top() * pageHeight / request->height() - PageMargin;
+    const qreal bottom = area.bottom() * pageHeight / request->height() - PageMargin;
+    const int firstRow = qMax( 0, int( top / m_cellSize.height() ) );
+    const int lastRow = qMin( rows.count() - 1, int( bottom / m_cellSize.height() ) );
+    for ( int i = firstRow; i <= lastRow; ++i )
+        p.drawText( QPointF( PageMargin, PageMargin + i * m_cellSize.height() + m_ascent ), rows.at( i ).text );
+
+    p.end();
+    return image;
+}
+
+Okular::TextPage* TxtGenerator::textPage( Okular::Page *page )
+{
+    if ( !m_mappedDocument )
+        return Okular::TextDocumentGenerator::textPage( page );
+
+    const qreal pageWidth = pageSize().width();
+    const qreal pageHeight = pageSize().height();
+    const qreal cellWidth = m_cellSize.width() / pageWidth;
+    const qreal cellHeight = m_cellSize.height() / pageHeight;
+
+    Okular::TextPage *textPage = new Okular::TextPage;
+
+    const QVector<Txt::MappedDocument::Row> rows = m_mappedDocument->pageRows( page->number() );
+    for ( int i = 0; i < rows.count(); ++i )
+    {
+        const Txt::MappedDocument::Row &row = rows.at( i );
+        const qreal top = ( PageMargin + i * m_cellSize.height() ) / pageHeight;
+        qreal left = PageMargin / pageWidth;
+        for ( int j = 0; j < row.text.length(); ++j, left += cellWidth )
+            textPage->append( row.text.mid( j, 1 ), new Okular::NormalizedRect( left, top, left + cellWidth, top + cellHeight ) );
+
+        if ( row.endsLine )
+            textPage->append( QStringLiteral( "\n" ), new Okular::NormalizedRect( left, top, left, top + cellHeight ) );
+    }
+
+    return textPage;
+}
+
+Okular::DocumentInfo TxtGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
+{
+    if ( !m_mappedDocument )
+        return Okular::TextDocumentGenerator::generateDocumentInfo( keys );
+
+    Okular::DocumentInfo docInfo;
+    if ( keys.contains( Okular::DocumentInfo::MimeType ) )
+        docInfo.set( Okular::DocumentInfo::MimeType, QStringLiteral( "text/plain" ) );
+    return docInfo;
 }
 
 void TxtGenerator::addPages( KConfigDialog* dlg )
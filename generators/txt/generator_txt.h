@@ -14,6 +14,16 @@
 
 #include <core/textdocumentgenerator.h>
 
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QFont>
+
+class QTimer;
+
+namespace Txt
+{
+    class MappedDocument;
+}
+
 class TxtGenerator : public Okular::TextDocumentGenerator
 {
     Q_OBJECT
@@ -21,9 +31,36 @@ class TxtGenerator : public Okular::TextDocumentGenerator
 
 public:
     TxtGenerator(QObject *parent, const QVariantList &args);
-    ~TxtGenerator() {}
+    ~TxtGenerator();
+
+    Okular::Document::OpenResult loadDocumentWithPassword( const QString & fileName, QVector<Okular::Page*> & pagesVector, const QString &password ) override;
+
+    Okular::DocumentInfo generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const override;
 
     void addPages( KConfigDialog* dlg ) override;
+
+protected:
+    bool doCloseDocument() override;
+    QImage image( Okular::PixmapRequest *request ) override;
+    Okular::TextPage* textPage( Okular::Page *page ) override;
+
+private Q_SLOTS:
+    void indexNextRows();
+
+private:
+    QSizeF pageSize() const;
+    QVector<Okular::Page*> createPages( int first, int last ) const;
+    void finishIndexing();
+
+    // set while a file too big for a QTextDocument is shown mapped
+    Txt::MappedDocument *m_mappedDocument;
+    QTimer *m_indexTimer;
+    QElapsedTimer m_lastPublication;
+    int m_publishedPages;
+
+    QFont m_font;
+    QSizeF m_cellSize;
+    qreal m_ascent;
 };
 
 #endif
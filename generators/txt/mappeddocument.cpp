@@ -0,0 +1,276 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "mappeddocument.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QTextCodec>
+#include <QtCore/QTextDecoder>
+
+#include "document.h"
+#include "debug_txt.h"
+
+using namespace Txt;
+
+// how much of the file is fed to the encoding prober
+static const int EncodingProbeSize = 1024 * 1024;
+
+// expands tabs to the next multiple of TabWidth, like scanRow() counts them
+static QString expandTabs( const QString &text )
+{
+    if ( !text.contains( QLatin1Char( '\t' ) ) )
+        return text;
+
+    QString expanded;
+    expanded.reserve( text.length() + MappedDocument::TabWidth );
+    int column = 0;
+    for ( int i = 0; i < text.length(); ++i )
+    {
+        const QChar c = text.at( i );
+        if ( c == QLatin1Char( '\t' ) )
+        {
+            const int next = ( column / MappedDocument::TabWidth + 1 ) * MappedDocument::TabWidth;
+            expanded.append( QString( next - column, QLatin1Char( ' ' ) ) );
+            column = next;
+        }
+        else
+        {
+            expanded.append( c );
+            ++column;
+        }
+    }
+    return expanded;
+}
+
+// whether every byte decodes by itself to one character, so that a row can
+// start at any byte
+static bool isSingleByte( QTextCodec *codec )
+{
+    for ( int i = 0; i < 256; ++i )
+    {
+        const char c = i;
+        QTextCodec::ConverterState state;
+        if ( codec->toUnicode( &c, 1, &state ).length() != 1 || state.remainingChars != 0 )
+            return false;
+    }
+    return true;
+}
+
+// UTF-16 and UTF-32, in any byte order
+static bool isWideUnicode( int mib )
+{
+    return ( mib >= 1013 && mib <= 1015 ) || ( mib >= 1017 && mib <= 1019 );
+}
+
+MappedDocument::MappedDocument()
+    : m_data( 0 ), m_size( 0 ), m_codec( 0 ), m_utf8( false ),
+      m_unitSize( 1 ), m_bigEndian( false ), m_indexedOffset( 0 ), m_rowsInPage( 0 )
+{
+}
+
+MappedDocument::~MappedDocument()
+{
+    close();
+}
+
+bool MappedDocument::open( const QString &fileName )
+{
+    close();
+
+    m_file.setFileName( fileName );
+    if ( !m_file.open( QIODevice::ReadOnly ) )
+    {
+        qCDebug(OkularTxtDebug) << "Can't open file" << fileName;
+        return false;
+    }
+
+    m_size = m_file.size();
+    if ( m_size > 0 )
+    {
+        m_data = m_file.map( 0, m_size );
+        if ( !m_data )
+        {
+            qCDebug(OkularTxtDebug) << "Can't map file" << fileName << m_file.errorString();
+            m_file.close();
+            m_size = 0;
+            return false;
+        }
+    }
+
+    const QByteArray head = QByteArray::fromRawData( reinterpret_cast<const char *>( m_data ), qMin<qint64>( m_size, EncodingProbeSize ) );
+    const QByteArray encoding = Document::detectEncoding( head );
+    if ( !encoding.isEmpty() )
+        m_codec = QTextCodec::codecForName( encoding );
+    if ( !m_codec )
+        m_codec = QTextCodec::codecForName( "UTF-8" );
+    // a byte order mark tells the exact UTF flavour
+    m_codec = QTextCodec::codecForUtfText( head, m_codec );
+    m_utf8 = m_codec->mibEnum() == 106;
+
+    // rows are split on the encoded line breaks, so pages can only be
+    // decoded on their own if every code unit that is not part of a line
+    // break can be looked at without the ones before it
+    QTextCodec::ConverterState state( QTextCodec::IgnoreHeader );
+    const QByteArray lineBreak = m_codec->fromUnicode( QStringLiteral( "\n" ).constData(), 1, &state );
+    m_unitSize = lineBreak.size();
+    m_bigEndian = lineBreak.startsWith( '\0' );
+    const bool splittable = m_unitSize == 1 ? lineBreak == "\n" && ( m_utf8 || isSingleByte( m_codec ) )
+                                            : isWideUnicode( m_codec->mibEnum() );
+    if ( !splittable )
+    {
+        qCDebug(OkularTxtDebug) << "Can't split" << m_codec->name() << "text in pages";
+        close();
+        return false;
+    }
+
+    // the byte order mark is not part of the text
+    qint64 start = 0;
+    if ( m_unitSize > 1 && m_size >= m_unitSize && unitAt( 0 ) == 0xFEFF )
+        start = m_unitSize;
+    else if ( m_utf8 && head.startsWith( "\xEF\xBB\xBF" ) )
+        start = 3;
+
+    m_pageOffsets.append( start );
+    m_indexedOffset = start;
+    return true;
+}
+
+void MappedDocument::close()
+{
+    QMutexLocker locker( &m_indexMutex );
+    if ( m_data )
+        m_file.unmap( const_cast<uchar *>( m_data ) );
+    m_data = 0;
+    m_file.close();
+    m_size = 0;
+    m_codec = 0;
+    m_utf8 = false;
+    m_unitSize = 1;
+    m_bigEndian = false;
+    m_pageOffsets.clear();
+    m_indexedOffset = 0;
+    m_rowsInPage = 0;
+}
+
+uint MappedDocument::unitAt( qint64 pos ) const
+{
+    if ( m_unitSize == 1 )
+        return m_data[ pos ];
+
+    uint unit = 0;
+    for ( int i = 0; i < m_unitSize; ++i )
+        unit |= uint( m_data[ pos + i ] ) << ( 8 * ( m_bigEndian ? m_unitSize - 1 - i : i ) );
+    return unit;
+}
+
+qint64 MappedDocument::scanRow( qint64 start, qint64 *next ) const
+{
+    int column = 0;
+    for ( qint64 pos = start; pos + m_unitSize <= m_size; pos += m_unitSize )
+    {
+        const uint c = unitAt( pos );
+        if ( c == '\n' )
+        {
+            *next = pos + m_unitSize;
+            return pos;
+        }
+
+        // UTF-8 continuation bytes, low surrogates and carriage returns take
+        // no column, so rows are never wrapped in the middle of a character
+        if ( c == '\r' || ( m_utf8 && ( c & 0xC0 ) == 0x80 ) || ( m_unitSize == 2 && QChar::isLowSurrogate( c ) ) )
+            continue;
+
+        if ( column >= Columns )
+        {
+            *next = pos;
+            return pos;
+        }
+        column = c == '\t' ? ( column / TabWidth + 1 ) * TabWidth : column + 1;
+    }
+
+    *next = m_size;
+    return m_size;
+}
+
+bool MappedDocument::indexRows( int msecs )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int rows = 0;
+    while ( m_indexedOffset < m_size )
+    {
+        qint64 next;
+        scanRow( m_indexedOffset, &next );
+        m_indexedOffset = next;
+
+        if ( ++m_rowsInPage == RowsPerPage && m_indexedOffset < m_size )
+        {
+            QMutexLocker locker( &m_indexMutex );
+            m_pageOffsets.append( m_indexedOffset );
+            m_rowsInPage = 0;
+        }
+
+        if ( ( ++rows % 1024 ) == 0 && timer.elapsed() >= msecs )
+            break;
+    }
+
+    return isIndexed();
+}
+
+bool MappedDocument::isIndexed() const
+{
+    return m_indexedOffset >= m_size;
+}
+
+int MappedDocument::pageCount() const
+{
+    // the last page is only known to be complete once the whole file is indexed
+    QMutexLocker locker( &m_indexMutex );
+    return isIndexed() ? m_pageOffsets.count() : m_pageOffsets.count() - 1;
+}
+
+bool MappedDocument::pageRange( int page, qint64 *start, qint64 *end ) const
+{
+    QMutexLocker locker( &m_indexMutex );
+    if ( page < 0 || page >= m_pageOffsets.count() )
+        return false;
+
+    *start = m_pageOffsets.at( page );
+    *end = page + 1 < m_pageOffsets.count() ? m_pageOffsets.at( page + 1 ) : m_size;
+    return true;
+}
+
+QVector<MappedDocument::Row> MappedDocument::pageRows( int page ) const
+{
+    QVector<Row> rows;
+    qint64 start, end;
+    if ( !pageRange( page, &start, &end ) )
+        return rows;
+
+    // pages start at character boundaries, so a new decoder can take over;
+    // it must not drop a U+FEFF at the start of the page as a byte order mark
+    QScopedPointer<QTextDecoder> decoder( m_codec->makeDecoder( QTextCodec::IgnoreHeader ) );
+    rows.reserve( RowsPerPage );
+    while ( start < end && rows.count() < RowsPerPage )
+    {
+        qint64 next;
+        const qint64 rowEnd = scanRow( start, &next );
+
+        Row row;
+        QString text = decoder->toUnicode( reinterpret_cast<const char *>( m_data + start ), rowEnd - start );
+        text.remove( QLatin1Char( '\r' ) );
+        row.text = expandTabs( text );
+        row.endsLine = next > rowEnd;
+        rows.append( row );
+
+        start = next;
+    }
+    return rows;
+}
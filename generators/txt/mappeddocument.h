@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _TXT_MAPPEDDOCUMENT_H_
+#define _TXT_MAPPEDDOCUMENT_H_
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class QTextCodec;
+
+namespace Txt
+{
+    /**
+     * A plain text file that is memory mapped instead of read, used for
+     * files too big to be laid out by QTextDocument.
+     *
+     * The text is split in rows of at most Columns characters and pages of
+     * RowsPerPage rows; the byte offset where each page starts is indexed
+     * incrementally with indexRows(), so that the first pages are available
+     * long before the whole file has been scanned.
+     */
+    class MappedDocument
+    {
+        public:
+            enum {
+                Columns = 100,
+                RowsPerPage = 60,
+                TabWidth = 8
+            };
+
+            struct Row
+            {
+                QString text;
+                bool endsLine;  ///< whether the row ends with a line break rather than being wrapped
+            };
+
+            MappedDocument();
+            ~MappedDocument();
+
+            /**
+             * Maps @p fileName and detects its encoding.
+             *
+             * Fails for encodings where the start of a row can't be found
+             * without decoding the file from its beginning, like the
+             * stateful and the legacy multibyte ones.
+             */
+            bool open( const QString &fileName );
+
+            /**
+             * Unmaps the file and forgets the page index.
+             */
+            void close();
+
+            /**
+             * Indexes rows for about @p msecs milliseconds.
+             *
+             * Returns whether the whole file has been indexed.
+             */
+            bool indexRows( int msecs );
+
+            /**
+             * Returns whether the whole file has been indexed.
+             */
+            bool isIndexed() const;
+
+            /**
+             * Returns the number of pages whose extent is known.
+             */
+            int pageCount() const;
+
+            /**
+             * Returns the rows of @p page, decoded. Thread safe.
+             */
+            QVector<Row> pageRows( int page ) const;
+
+        private:
+            uint unitAt( qint64 pos ) const;
+            qint64 scanRow( qint64 start, qint64 *next ) const;
+            bool pageRange( int page, qint64 *start, qint64 *end ) const;
+
+            QFile m_file;
+            const uchar *m_data;
+            qint64 m_size;
+            QTextCodec *m_codec;
+            bool m_utf8;
+            int m_unitSize;     ///< size in bytes of a code unit: 1, or 2 and 4 for UTF-16 and UTF-32
+            bool m_bigEndian;
+
+            // start offset of every page seen so far, guarded by m_indexMutex
+            mutable QMutex m_indexMutex;
+            QVector<qint64> m_pageOffsets;
+            qint64 m_indexedOffset;
+            int m_rowsInPage;
+    };
+}
+
+#endif
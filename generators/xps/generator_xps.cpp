@@ -720,6 +720,182 @@ static QString unicodeString( const QString &raw )
 }
 
 
+// the memory the display lists of all the pages of a file may use together
+static const qint64 DisplayListsMemoryBudget = 64 * 1024 * 1024;
+
+XpsDisplayList::XpsDisplayList()
+    : m_opacity( 1.0 )
+{
+}
+
+void XpsDisplayList::append( Operation operation, int argument )
+{
+    Command command;
+    command.operation = operation;
+    command.argument = argument;
+    m_commands.append( command );
+}
+
+void XpsDisplayList::save()
+{
+    m_states.push( qMakePair( m_font, m_opacity ) );
+    append( Save );
+}
+
+void XpsDisplayList::restore()
+{
+    if ( !m_states.isEmpty() ) {
+        const QPair<QFont, qreal> state = m_states.pop();
+        m_font = state.first;
+        m_opacity = state.second;
+    }
+    append( Restore );
+}
+
+void XpsDisplayList::setFont( const QFont &font )
+{
+    m_font = font;
+    m_fonts.append( font );
+    append( SetFont, m_fonts.count() - 1 );
+}
+
+void XpsDisplayList::setBrush( const QBrush &brush )
+{
+    m_brushes.append( brush );
+    append( SetBrush, m_brushes.count() - 1 );
+}
+
+void XpsDisplayList::setPen( const QPen &pen )
+{
+    m_pens.append( pen );
+    append( SetPen, m_pens.count() - 1 );
+}
+
+void XpsDisplayList::setOpacity( qreal opacity )
+{
+    m_opacity = opacity;
+    m_values.append( opacity );
+    append( SetOpacity, m_values.count() - 1 );
+}
+
+qreal XpsDisplayList::opacity() const
+{
+    return m_opacity;
+}
+
+void XpsDisplayList::setWorldTransform( const QTransform &matrix, bool combine )
+{
+    // all the transformations of a page are relative to the one of its parent
+    Q_ASSERT( combine );
+    Q_UNUSED( combine )
+    m_transforms.append( matrix );
+    append( CombineTransform, m_transforms.count() - 1 );
+}
+
+void XpsDisplayList::setClipPath( const QPainterPath &path )
+{
+    m_paths.append( path );
+    append( SetClipPath, m_paths.count() - 1 );
+}
+
+void XpsDisplayList::setLayoutDirection( Qt::LayoutDirection direction )
+{
+    append( SetLayoutDirection, direction );
+}
+
+QFontMetrics XpsDisplayList::fontMetrics() const
+{
+    // the pages are rendered with one point being one drawing unit, i.e.
+    // at 72 dpi, so a point is also a pixel
+    QFont font( m_font );
+    if ( font.pointSizeF() > 0 )
+        font.setPixelSize( qRound( font.pointSizeF() ) );
+    return QFontMetrics( font );
+}
+
+void XpsDisplayList::drawPath( const QPainterPath &path )
+{
+    m_paths.append( path );
+    append( DrawPath, m_paths.count() - 1 );
+}
+
+void XpsDisplayList::drawGlyphRun( const QString &text, const QVector<QPointF> &positions )
+{
+    Q_ASSERT( text.size() == positions.size() );
+    m_texts.append( text );
+    m_positions.append( positions );
+    append( DrawGlyphRun, m_texts.count() - 1 );
+}
+
+void XpsDisplayList::replay( QPainter *painter ) const
+{
+    Q_FOREACH ( const Command &command, m_commands ) {
+        switch ( command.operation ) {
+            case Save:
+                painter->save();
+                break;
+            case Restore:
+                painter->restore();
+                break;
+            case SetFont:
+                painter->setFont( m_fonts.at( command.argument ) );
+                break;
+            case SetBrush:
+                painter->setBrush( m_brushes.at( command.argument ) );
+                break;
+            case SetPen:
+                painter->setPen( m_pens.at( command.argument ) );
+                break;
+            case SetOpacity:
+                painter->setOpacity( m_values.at( command.argument ) );
+                break;
+            case CombineTransform:
+                painter->setWorldTransform( m_transforms.at( command.argument ), true );
+                break;
+            case SetClipPath:
+                painter->setClipPath( m_paths.at( command.argument ) );
+                break;
+            case SetLayoutDirection:
+                painter->setLayoutDirection( (Qt::LayoutDirection)command.argument );
+                break;
+            case DrawPath:
+                painter->drawPath( m_paths.at( command.argument ) );
+                break;
+            case DrawGlyphRun: {
+                const QString &text = m_texts.at( command.argument );
+                const QVector<QPointF> &positions = m_positions.at( command.argument );
+                for ( int i = 0; i < text.size(); ++i ) {
+                    painter->drawText( positions.at( i ), QString( text.at( i ) ) );
+                }
+                break;
+            }
+        }
+    }
+}
+
+qint64 XpsDisplayList::memoryUsage() const
+{
+    qint64 usage = m_commands.count() * sizeof( Command );
+    Q_FOREACH ( const QBrush &brush, m_brushes ) {
+        usage += sizeof( QBrush );
+        // the decoded images of the page
+        if ( brush.style() == Qt::TexturePattern )
+            usage += brush.textureImage().byteCount();
+    }
+    Q_FOREACH ( const QPainterPath &path, m_paths ) {
+        usage += sizeof( QPainterPath ) + path.elementCount() * sizeof( QPainterPath::Element );
+    }
+    Q_FOREACH ( const QString &text, m_texts ) {
+        usage += sizeof( QString ) + text.size() * sizeof( QChar );
+    }
+    Q_FOREACH ( const QVector<QPointF> &positions, m_positions ) {
+        usage += sizeof( QVector<QPointF> ) + positions.size() * sizeof( QPointF );
+    }
+    usage += m_fonts.count() * sizeof( QFont ) + m_pens.count() * sizeof( QPen )
+           + m_values.count() * sizeof( qreal ) + m_transforms.count() * sizeof( QTransform );
+    return usage;
+}
+
 XpsHandler::XpsHandler(XpsPage *page): m_page(page)
 {
     m_painter = NULL;
@@ -908,9 +1084,10 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     QString stringToDraw( unicodeString( node.attributes.value( QStringLiteral("UnicodeString") ) ) );
     QPointF originAdvance(0, 0);
     QFontMetrics metrics = m_painter->fontMetrics();
+    QVector<QPointF> positions( stringToDraw.size() );
     for ( int i = 0; i < stringToDraw.size(); ++i ) {
         QChar thisChar = stringToDraw.at( i );
-        m_painter->drawText( origin + originAdvance, QString( thisChar ) );
+        positions[i] = origin + originAdvance;
 	const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
         if ( advanceWidth > 0.0 ) {
             originAdvance.rx() += advanceWidth;
@@ -918,6 +1095,7 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
             originAdvance.rx() += metrics.width( thisChar );
         }
     }
+    m_painter->drawGlyphRun( stringToDraw, positions );
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
     // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
@@ -1377,10 +1555,8 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
 }
 
 XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
-    m_fileName( fileName ), m_pageIsRendered(false)
+    m_fileName( fileName ), m_displayList( 0 ), m_displayListMemoryUsage( 0 )
 {
-    m_pageImage = NULL;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
     const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( fileName ));
@@ -1406,47 +1582,65 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
+    delete m_displayList;
 }
 
-bool XpsPage::renderToImage( QImage *p )
+const XpsDisplayList * XpsPage::displayList()
 {
+    if ( !m_displayList ) {
+        m_displayList = new XpsDisplayList();
 
-    if ((m_pageImage == NULL) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage( p->size(), QImage::Format_ARGB32 );
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX( 2835 );
-        m_pageImage->setDotsPerMeterY( 2835 );
+        XpsHandler handler( this );
+        handler.m_painter = m_displayList;
+        QXmlSimpleReader parser;
+        parser.setContentHandler( &handler );
+        parser.setErrorHandler( &handler );
+        const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
+        QByteArray data = readFileOrDirectoryParts( pageFile );
+        QBuffer buffer( &data );
+        QXmlInputSource source( &buffer );
+        bool ok = parser.parse( source );
+        qCWarning(OkularXpsDebug) << "Parse result: " << ok;
 
-        m_pageIsRendered = false;
-    }
-    if (! m_pageIsRendered) {
-        m_pageImage->fill( qRgba( 255, 255, 255, 255 ) );
-        QPainter painter( m_pageImage );
-        renderToPainter( &painter );
-        m_pageIsRendered = true;
+        m_displayListMemoryUsage = m_displayList->memoryUsage();
     }
 
-    *p = *m_pageImage;
+    m_file->retainDisplayList( this );
+
+    return m_displayList;
+}
+
+qint64 XpsPage::displayListMemoryUsage() const
+{
+    return m_displayList ? m_displayListMemoryUsage : 0;
+}
+
+void XpsPage::releaseDisplayList()
+{
+    delete m_displayList;
+    m_displayList = 0;
+    m_displayListMemoryUsage = 0;
+}
+
+bool XpsPage::renderToImage( QImage *p, const QSize &pageSize, const QPoint &offset )
+{
+    // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
+    p->setDotsPerMeterX( 2835 );
+    p->setDotsPerMeterY( 2835 );
+    p->fill( qRgba( 255, 255, 255, 255 ) );
+
+    QPainter painter( p );
+    painter.translate( -offset );
+    painter.scale( (qreal)pageSize.width() / size().width(), (qreal)pageSize.height() / size().height() );
+    displayList()->replay( &painter );
 
     return true;
 }
 
 bool XpsPage::renderToPainter( QPainter *painter )
 {
-    XpsHandler handler( this );
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
-    QXmlSimpleReader parser;
-    parser.setContentHandler( &handler );
-    parser.setErrorHandler( &handler );
-    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
-    QByteArray data = readFileOrDirectoryParts( pageFile );
-    QBuffer buffer( &data );
-    QXmlInputSource source( &buffer );
-    bool ok = parser.parse( source );
-    qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    displayList()->replay( painter );
 
     return true;
 }
@@ -1536,6 +1730,23 @@ KZip * XpsFile::xpsArchive() {
     return m_xpsArchive;
 }
 
+void XpsFile::retainDisplayList( XpsPage *page )
+{
+    if ( !m_displayListPages.isEmpty() && m_displayListPages.last() == page )
+        return;
+
+    if ( m_displayListPages.removeOne( page ) )
+        m_displayListsMemoryUsage -= page->displayListMemoryUsage();
+    m_displayListPages.append( page );
+    m_displayListsMemoryUsage += page->displayListMemoryUsage();
+
+    while ( m_displayListsMemoryUsage > DisplayListsMemoryBudget && m_displayListPages.first() != page ) {
+        XpsPage *oldest = m_displayListPages.takeFirst();
+        m_displayListsMemoryUsage -= oldest->displayListMemoryUsage();
+        oldest->releaseDisplayList();
+    }
+}
+
 QImage XpsPage::loadImageFromFile( const QString &fileName )
 {
     // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
@@ -1557,28 +1768,27 @@ QImage XpsPage::loadImageFromFile( const QString &fileName )
         XPS standard requires to use 96dpi for images which doesn't have dpi specified (in file). When Qt loads such an image,
         it sets its dpi to qt_defaultDpi and doesn't allow to find out that it happend.
 
-        To workaround this I used this procedure: load image, set its dpi to 96, load image again. When dpi isn't set in file,
-        dpi set by me stays unchanged.
+        To workaround this the image is decoded into an image of its size and format whose dpi is already 96: the image
+        handlers reuse it, and only change its dpi when the file specifies one. Handlers that allocate an image of their
+        own give it the default dpi of Qt, as before.
 
         Trolltech task ID: 159527.
 
     */
 
-    QImage image;
     QByteArray data = imageFile->data();
 
     QBuffer buffer(&data);
     buffer.open(QBuffer::ReadOnly);
 
     QImageReader reader(&buffer);
-    image = reader.read();
-
-    image.setDotsPerMeterX(qRound(96 / 0.0254));
-    image.setDotsPerMeterY(qRound(96 / 0.0254));
-  
-    buffer.seek(0);
-    reader.setDevice(&buffer);
-    reader.read(&image);
+    QImage image( reader.size(), reader.imageFormat() );
+    if ( !image.isNull() ) {
+        image.setDotsPerMeterX(qRound(96 / 0.0254));
+        image.setDotsPerMeterY(qRound(96 / 0.0254));
+    }
+    if ( !reader.read( &image ) )
+        return QImage();
 
     return image;
 }
@@ -1869,6 +2079,7 @@ XpsPage* XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_displayListsMemoryUsage( 0 )
 {
 }
 
@@ -2028,6 +2239,9 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    m_displayListPages.clear();
+    m_displayListsMemoryUsage = 0;
+
     qDeleteAll( m_documents );
     m_documents.clear();
 
@@ -2060,6 +2274,7 @@ XpsGenerator::XpsGenerator( QObject *parent, const QVariantList &args )
   : Okular::Generator( parent, args ), m_xpsFile( 0 )
 {
     setFeature( TextExtraction );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     // activate the threaded rendering iif:
@@ -2111,9 +2326,12 @@ QImage XpsGenerator::image( Okular::PixmapRequest * request )
 {
     QMutexLocker lock( userMutex() );
     QSize size( (int)request->width(), (int)request->height() );
-    QImage image( size, QImage::Format_RGB32 );
+    QRect area( QPoint( 0, 0 ), size );
+    if ( request->isTile() )
+        area = request->normalizedRect().geometry( size.width(), size.height() );
+    QImage image( area.size(), QImage::Format_RGB32 );
     XpsPage *pageToRender = m_xpsFile->page( request->page()->number() );
-    pageToRender->renderToImage( &image );
+    pageToRender->renderToImage( &image, size, area.topLeft() );
     return image;
 }
 
@@ -2189,6 +2407,10 @@ bool XpsGenerator::print( QPrinter &printer )
 
     QPainter painter( &printer );
 
+    // the display lists are shared with the rendering thread, which may
+    // release the one of a page while it is being replayed here
+    QMutexLocker lock( userMutex() );
+
     for ( int i = 0; i < pageList.count(); ++i )
     {
         if ( i != 0 )
@@ -26,7 +26,10 @@
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
+#include <QFontMetrics>
 #include <QImage>
+#include <QPainterPath>
+#include <QPen>
 #include <QXmlStreamReader>
 #include <QXmlDefaultHandler>
 #include <QStack>
@@ -107,6 +110,72 @@ struct XpsPathGeometry
 class XpsPage;
 class XpsFile;
 
+/**
+    The painting operations of a page, recorded once while parsing it and
+    replayed on a QPainter for every rendering.
+
+    It offers the subset of the QPainter API used by XpsHandler.
+*/
+class XpsDisplayList
+{
+public:
+    XpsDisplayList();
+
+    void save();
+    void restore();
+
+    void setFont( const QFont &font );
+    void setBrush( const QBrush &brush );
+    void setPen( const QPen &pen );
+    void setOpacity( qreal opacity );
+    qreal opacity() const;
+    void setWorldTransform( const QTransform &matrix, bool combine );
+    void setClipPath( const QPainterPath &path );
+    void setLayoutDirection( Qt::LayoutDirection direction );
+    QFontMetrics fontMetrics() const;
+
+    void drawPath( const QPainterPath &path );
+    void drawGlyphRun( const QString &text, const QVector<QPointF> &positions );
+
+    /**
+       paint the recorded operations using the given painter
+    */
+    void replay( QPainter *painter ) const;
+
+    /**
+       an estimation of the memory used by the recorded operations, in bytes
+    */
+    qint64 memoryUsage() const;
+
+private:
+    enum Operation { Save, Restore, SetFont, SetBrush, SetPen, SetOpacity, CombineTransform,
+                     SetClipPath, SetLayoutDirection, DrawPath, DrawGlyphRun };
+
+    struct Command
+    {
+        Operation operation;
+        // index in the vector holding the argument of the operation
+        int argument;
+    };
+
+    void append( Operation operation, int argument = -1 );
+
+    QVector<Command> m_commands;
+    QVector<QFont> m_fonts;
+    QVector<QBrush> m_brushes;
+    QVector<QPen> m_pens;
+    QVector<qreal> m_values;
+    QVector<QTransform> m_transforms;
+    QVector<QPainterPath> m_paths;
+    QVector<QString> m_texts;
+    QVector< QVector<QPointF> > m_positions;
+
+    // the state needed while recording
+    QFont m_font;
+    qreal m_opacity;
+    QStack< QPair<QFont, qreal> > m_states;
+};
+
 class XpsHandler: public QXmlDefaultHandler
 {
 public:
@@ -138,7 +207,7 @@ protected:
     void processPathGeometry( XpsRenderNode &node );
     void processPathFigure( XpsRenderNode &node );
 
-    QPainter *m_painter;
+    XpsDisplayList *m_painter;
 
     QImage m_image;
 
@@ -154,13 +223,18 @@ public:
     ~XpsPage();
 
     QSizeF size() const;
-    bool renderToImage( QImage *p );
+    bool renderToImage( QImage *p, const QSize &pageSize, const QPoint &offset );
     bool renderToPainter( QPainter *painter );
     Okular::TextPage* textPage();
 
     QImage loadImageFromFile( const QString &filename );
 
+    qint64 displayListMemoryUsage() const;
+    void releaseDisplayList();
+
 private:
+    const XpsDisplayList * displayList();
+
     XpsFile *m_file;
     const QString m_fileName;
 
@@ -172,8 +246,8 @@ private:
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
+    XpsDisplayList *m_displayList;
+    qint64 m_displayListMemoryUsage;
 
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
@@ -275,6 +349,12 @@ public:
 
     KZip* xpsArchive();
 
+    /**
+       mark the display list of the page as the most recently used one,
+       releasing the least recently used ones if they take too much memory
+    */
+    void retainDisplayList( XpsPage *page );
+
 
 private:
     int loadFontByName( const QString &fontName );
@@ -295,6 +375,10 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    // the pages having a display list, least recently used first
+    QList<XpsPage*> m_displayListPages;
+    qint64 m_displayListsMemoryUsage;
 };
 
 
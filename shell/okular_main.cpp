@@ -167,7 +167,10 @@ Status main(const QStringList &paths, const QString &serializedOptions)
         // Page only makes sense if we are opening one file
         const QString page = ShellUtils::page(serializedOptions);
         const QUrl url = ShellUtils::urlFromArg(paths[i], ShellUtils::qfileExistFunc(), page);
-        if ( shell->openDocument( url, serializedOptions) )
+        // the documents between the first and the last one go to tabs that
+        // are only loaded when activated
+        const bool hibernated = i > 0 && i < paths.count() - 1;
+        if ( shell->openDocument( url, serializedOptions, hibernated ) )
         {
             ++i;
         }
@@ -109,6 +109,10 @@ Shell::Shell( const QString &serializedOptions )
     connect( m_tabWidget, &QTabWidget::tabCloseRequested, this, &Shell::closeTab );
     connect( m_tabWidget->tabBar(), &QTabBar::tabMoved, this, &Shell::moveTabData );
 
+    m_hibernateTimer = new QTimer( this );
+    m_hibernateTimer->setInterval( 60 * 1000 );
+    connect( m_hibernateTimer, &QTimer::timeout, this, &Shell::hibernateBackgroundTabs );
+
     setCentralWidget( m_tabWidget );
 
     // then, setup our actions
@@ -120,9 +124,12 @@ Shell::Shell( const QString &serializedOptions )
     connectPart( firstPart );
 
     m_tabs.append( firstPart );
+    m_tabs.last().lastActive.start();
     m_tabWidget->addTab( firstPart->widget(), QString() );
 
     readSettings();
+    if ( m_hibernateTabsAfter > 0 )
+        m_hibernateTimer->start();
 
     m_unique = ShellUtils::unique(serializedOptions);
     if (m_unique)
@@ -200,7 +207,7 @@ Shell::~Shell()
 
 // Open a new document if we have space for it
 // This can hang if called on a unique instance and openUrl pops a messageBox
-bool Shell::openDocument( const QUrl& url, const QString &serializedOptions )
+bool Shell::openDocument( const QUrl& url, const QString &serializedOptions, bool hibernated )
 {
     if( m_tabs.size() <= 0 )
        return false;
@@ -209,13 +216,13 @@ bool Shell::openDocument( const QUrl& url, const QString &serializedOptions )
 
     // Return false if we can't open new tabs and the only part is occupied
     if ( !dynamic_cast<Okular::ViewerInterface*>(part)->openNewFilesInTabs()
-         && !part->url().isEmpty()
+         && !tabUrl( 0 ).isEmpty()
          && !ShellUtils::unique(serializedOptions))
     {
         return false;
     }
 
-    openUrl( url, serializedOptions );
+    openUrl( url, serializedOptions, hibernated );
 
     return true;
 }
@@ -233,7 +240,7 @@ bool Shell::canOpenDocs( int numDocs, int desktop )
    KParts::ReadWritePart* const part = m_tabs[0].part;
    const bool allowTabs = dynamic_cast<Okular::ViewerInterface*>(part)->openNewFilesInTabs();
 
-   if( !allowTabs && (numDocs > 1 || !part->url().isEmpty()) )
+   if( !allowTabs && (numDocs > 1 || !tabUrl( 0 ).isEmpty()) )
       return false;
 
    const KWindowInfo winfo( window()->effectiveWinId(), KWindowSystem::WMDesktop );
@@ -243,13 +250,13 @@ bool Shell::canOpenDocs( int numDocs, int desktop )
    return true;
 }
 
-void Shell::openUrl( const QUrl & url, const QString &serializedOptions )
+void Shell::openUrl( const QUrl & url, const QString &serializedOptions, bool hibernated )
 {
     const int activeTab = m_tabWidget->currentIndex();
     if ( activeTab < m_tabs.size() )
     {
         KParts::ReadWritePart* const activePart = m_tabs[activeTab].part;
-        if( !activePart->url().isEmpty() )
+        if( !tabUrl( activeTab ).isEmpty() )
         {
             if( m_unique )
             {
@@ -260,7 +267,7 @@ void Shell::openUrl( const QUrl & url, const QString &serializedOptions )
             {
                 if( dynamic_cast<Okular::ViewerInterface *>(activePart)->openNewFilesInTabs() )
                 {
-                    openNewTab( url, serializedOptions );
+                    openNewTab( url, serializedOptions, hibernated );
                 }
                 else
                 {
@@ -314,6 +321,8 @@ void Shell::readSettings()
         m_menuBarWasShown = group.readEntry( shouldShowMenuBarComingFromFullScreen, true );
         m_toolBarWasShown = group.readEntry( shouldShowToolBarComingFromFullScreen, true );
     }
+
+    m_hibernateTabsAfter = group.readEntry( "HibernateTabsAfter", 30 );
 }
 
 void Shell::writeSettings()
@@ -370,7 +379,7 @@ void Shell::saveProperties(KConfigGroup &group)
     QStringList urls;
     for( int i = 0; i < m_tabs.size(); ++i )
     {
-        urls.append( m_tabs[i].part->url().url() );
+        urls.append( tabUrl( i ).url() );
     }
     group.writePathEntry( SESSION_URL_KEY, urls );
     group.writeEntry( SESSION_TAB_KEY, m_tabWidget->currentIndex() );
@@ -379,18 +388,35 @@ void Shell::saveProperties(KConfigGroup &group)
 void Shell::readProperties(const KConfigGroup &group)
 {
     // Reopen documents based on saved settings
-    QStringList urls = group.readPathEntry( SESSION_URL_KEY, QStringList() );
+    const QStringList urls = group.readPathEntry( SESSION_URL_KEY, QStringList() );
+    const int desiredTab = group.readEntry<int>( SESSION_TAB_KEY, 0 );
 
-    while( !urls.isEmpty() )
+    // only the document of the active tab is loaded now, the others when
+    // their tab is first activated
+    for( int i = 0; i < urls.size(); ++i )
     {
-        openUrl( QUrl(urls.takeFirst()) );
+        const QUrl url( urls[i] );
+        if( i == 0 && i != desiredTab && desiredTab < urls.size() && tabUrl( 0 ).isEmpty() )
+        {
+            m_tabWidget->setTabText( 0, url.fileName() );
+            m_tabs[0].hibernatedUrl = url;
+        }
+        else
+        {
+            openUrl( url, QString(), i != desiredTab );
+        }
     }
 
-    int desiredTab = group.readEntry<int>( SESSION_TAB_KEY, 0 );
     if( desiredTab < m_tabs.size() )
     {
         setActiveTab( desiredTab );
     }
+
+    // the tab shown may not be the one that was active, eg when restoring
+    // without tabs
+    const int activeTab = m_tabWidget->currentIndex();
+    if( !m_tabs[activeTab].hibernatedUrl.isEmpty() )
+        wakeUpTab( activeTab );
 }
 
 QStringList Shell::fileFormats() const
@@ -564,6 +590,10 @@ void Shell::setActiveTab( int tab )
     createGUI( m_tabs[tab].part );
     m_printAction->setEnabled( m_tabs[tab].printEnabled );
     m_closeAction->setEnabled( m_tabs[tab].closeEnabled );
+    m_tabs[tab].lastActive.start();
+
+    if( !m_tabs[tab].hibernatedUrl.isEmpty() )
+        wakeUpTab( tab );
 }
 
 void Shell::closeTab( int tab )
@@ -588,7 +618,7 @@ void Shell::closeTab( int tab )
 
 }
 
-void Shell::openNewTab( const QUrl& url, const QString &serializedOptions )
+void Shell::openNewTab( const QUrl& url, const QString &serializedOptions, bool hibernated )
 {
     // Tabs are hidden when there's only one, so show it
     if( m_tabs.size() == 1 )
@@ -608,6 +638,16 @@ void Shell::openNewTab( const QUrl& url, const QString &serializedOptions )
     KParts::ReadWritePart* const part = m_tabs[newIndex].part;
     m_tabWidget->addTab( part->widget(), url.fileName() );
 
+    if( hibernated )
+    {
+        m_tabs[newIndex].hibernatedUrl = url;
+        m_tabs[newIndex].hibernatedOptions = serializedOptions;
+        m_tabs[newIndex].lastActive.start();
+        const QMimeType mimeType = QMimeDatabase().mimeTypeForFile( url.fileName(), QMimeDatabase::MatchExtension );
+        m_tabWidget->setTabIcon( newIndex, QIcon::fromTheme( mimeType.iconName() ) );
+        return;
+    }
+
     applyOptionsToPart(part, serializedOptions);
 
     int previousActiveTab = m_tabWidget->currentIndex();
@@ -619,6 +659,52 @@ void Shell::openNewTab( const QUrl& url, const QString &serializedOptions )
         setActiveTab( previousActiveTab );
 }
 
+void Shell::hibernateTab( int tab )
+{
+    TabState &state = m_tabs[tab];
+    const QUrl url = state.part->url();
+    if( url.isEmpty() || state.part->isModified() )
+        return;
+
+    // the viewport is saved with the document data, and restored on reopening
+    if( state.part->closeUrl( false ) )
+        state.hibernatedUrl = url;
+}
+
+void Shell::wakeUpTab( int tab )
+{
+    KParts::ReadWritePart* const part = m_tabs[tab].part;
+    const QUrl url = m_tabs[tab].hibernatedUrl;
+    const QString serializedOptions = m_tabs[tab].hibernatedOptions;
+    m_tabs[tab].hibernatedUrl = QUrl();
+    m_tabs[tab].hibernatedOptions.clear();
+
+    applyOptionsToPart( part, serializedOptions );
+    if( part->openUrl( url ) )
+        m_recent->addUrl( url );
+    else
+        m_recent->removeUrl( url );
+}
+
+void Shell::hibernateBackgroundTabs()
+{
+    const int activeTab = m_tabWidget->currentIndex();
+    for( int i = 0; i < m_tabs.size(); ++i )
+    {
+        if( i == activeTab )
+            m_tabs[i].lastActive.start();
+        else if( m_tabs[i].hibernatedUrl.isEmpty() && m_tabs[i].lastActive.elapsed() >= m_hibernateTabsAfter * 60 * 1000 )
+            hibernateTab( i );
+    }
+}
+
+QUrl Shell::tabUrl( int tab ) const
+{
+    if( !m_tabs[tab].hibernatedUrl.isEmpty() )
+        return m_tabs[tab].hibernatedUrl;
+    return m_tabs[tab].part->url();
+}
+
 void Shell::applyOptionsToPart( QObject* part, const QString &serializedOptions )
 {
     KDocumentViewer* const doc = qobject_cast<KDocumentViewer*>(part);
@@ -20,6 +20,7 @@
 #include <kparts/readwritepart.h>
 #include <QMimeType>
 #include <QMimeDatabase>
+#include <QElapsedTimer>
 #include <qaction.h>
 
 #include <QtDBus/QtDBus>
@@ -27,6 +28,7 @@
 class KRecentFilesAction;
 class KToggleAction;
 class QTabWidget;
+class QTimer;
 class KPluginFactory;
 
 class KDocumentViewer;
@@ -69,7 +71,11 @@ public:
    **/
   bool isValid() const;
 
-  bool openDocument(const QUrl &url, const QString &serializedOptions);
+  /**
+   * Opens @p url, in a hibernated tab if @p hibernated is set and it gets
+   * a new tab: only the url is kept until the tab is first activated.
+   */
+  bool openDocument(const QUrl &url, const QString &serializedOptions, bool hibernated = false);
 
 public Q_SLOTS:
   Q_SCRIPTABLE Q_NOREPLY void tryRaise();
@@ -109,7 +115,7 @@ private Q_SLOTS:
   void slotUpdateFullScreen();
   void slotShowMenubar();
 
-  void openUrl( const QUrl & url, const QString &serializedOptions = QString() );
+  void openUrl( const QUrl & url, const QString &serializedOptions = QString(), bool hibernated = false );
   void showOpenRecentMenu();
   void closeUrl();
   void print();
@@ -127,6 +133,8 @@ private Q_SLOTS:
 
   void slotFitWindowToPage( const QSize& pageViewSize, const QSize& pageSize );
 
+  void hibernateBackgroundTabs();
+
 Q_SIGNALS:
   void moveSplitter(int sideWidgetSize);
 
@@ -134,7 +142,10 @@ private:
   void setupAccel();
   void setupActions();
   QStringList fileFormats() const;
-  void openNewTab( const QUrl& url, const QString &serializedOptions );
+  void openNewTab( const QUrl& url, const QString &serializedOptions, bool hibernated = false );
+  void hibernateTab( int tab );
+  void wakeUpTab( int tab );
+  QUrl tabUrl( int tab ) const;
   void applyOptionsToPart( QObject* part, const QString &serializedOptions );
   void connectPart( QObject* part );
   int  findTabIndex( QObject* sender );
@@ -165,10 +176,16 @@ private:
     KParts::ReadWritePart* part;
     bool printEnabled;
     bool closeEnabled;
+    // document of a hibernated tab, opened when the tab gets activated
+    QUrl hibernatedUrl;
+    QString hibernatedOptions;
+    QElapsedTimer lastActive;
   };
   QList<TabState> m_tabs;
   QAction* m_nextTabAction;
   QAction* m_prevTabAction;
+  QTimer* m_hibernateTimer;
+  int m_hibernateTabsAfter; // minutes, 0 to never hibernate tabs
 
 #ifndef Q_OS_WIN
   KActivities::ResourceInstance* m_activityResource;
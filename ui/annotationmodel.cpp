@@ -12,6 +12,7 @@
 #include <qlinkedlist.h>
 #include <qlist.h>
 #include <qpointer.h>
+#include <qset.h>
 
 #include <QIcon>
 #include <KLocalizedString>
@@ -62,11 +63,13 @@ public:
 
     QModelIndex indexForItem( AnnItem *item ) const;
     void rebuildTree( const QVector< Okular::Page * > &pages );
+    void updateBranch( int page, const QLinkedList< Okular::Annotation* > &annots );
     AnnItem* findItem( int page, int *index ) const;
 
     AnnotationModel *q;
     AnnItem *root;
     QPointer< Okular::Document > document;
+    int pageCount;
 };
 
 
@@ -96,7 +99,7 @@ AnnItem::~AnnItem()
 
 
 AnnotationModelPrivate::AnnotationModelPrivate( AnnotationModel *qq )
-    : q( qq ), root( new AnnItem )
+    : q( qq ), root( new AnnItem ), pageCount( 0 )
 {
 }
 
@@ -107,15 +110,26 @@ AnnotationModelPrivate::~AnnotationModelPrivate()
 
 void AnnotationModelPrivate::notifySetup( const QVector< Okular::Page * > &pages, int setupFlags )
 {
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    if ( setupFlags & Okular::DocumentObserver::DocumentChanged )
+    {
+        q->beginResetModel();
+        qDeleteAll( root->children );
+        root->children.clear();
+
+        rebuildTree( pages );
+        pageCount = pages.count();
+        q->endResetModel();
         return;
+    }
 
-    q->beginResetModel();
-    qDeleteAll( root->children );
-    root->children.clear();
+    if ( !( setupFlags & Okular::DocumentObserver::PagesAdded ) )
+        return;
 
-    rebuildTree( pages );
-    q->endResetModel();
+    // only the appended pages are new, the branches of the other ones are
+    // kept up to date by notifyPageChanged()
+    for ( int i = pageCount; i < pages.count(); ++i )
+        updateBranch( i, filterOutWidgetAnnotations( pages.at( i )->annotations() ) );
+    pageCount = pages.count();
 }
 
 void AnnotationModelPrivate::notifyPageChanged( int page, int flags )
@@ -124,7 +138,11 @@ void AnnotationModelPrivate::notifyPageChanged( int page, int flags )
     if ( !(flags & Okular::DocumentObserver::Annotations ) )
         return;
 
-    const QLinkedList< Okular::Annotation* > annots = filterOutWidgetAnnotations( document->page( page )->annotations() );
+    updateBranch( page, filterOutWidgetAnnotations( document->page( page )->annotations() ) );
+}
+
+void AnnotationModelPrivate::updateBranch( int page, const QLinkedList< Okular::Annotation* > &annots )
+{
     int annItemIndex = -1;
     AnnItem *annItem = findItem( page, &annItemIndex );
     // case 1: the page has no more annotations
@@ -133,97 +151,91 @@ void AnnotationModelPrivate::notifyPageChanged( int page, int flags )
     {
         if ( annItem )
         {
-            q->beginRemoveRows( indexForItem( root ), annItemIndex, annItemIndex );
-            delete root->children.at( annItemIndex );
-            root->children.removeAt( annItemIndex );
+            q->beginRemoveRows( QModelIndex(), annItemIndex, annItemIndex );
+            delete root->children.takeAt( annItemIndex );
             q->endRemoveRows();
         }
         return;
     }
     // case 2: no existing branch
-    //         => add a new branch, and add the annotations for the page
+    //         => add a new branch, with the annotations for the page
     if ( !annItem )
     {
-        int i = 0;
-        while ( i < root->children.count() && root->children.at( i )->page < page ) ++i;
-
-        AnnItem *annItem = new AnnItem();
+        annItem = new AnnItem();
         annItem->page = page;
         annItem->parent = root;
-        q->beginInsertRows( indexForItem( root ), i, i );
-        annItem->parent->children.insert( i, annItem );
-        q->endInsertRows();
         QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        int newid = 0;
-        for ( ; it != itEnd; ++it, ++newid )
-        {
-            q->beginInsertRows( indexForItem( annItem ), newid, newid );
+        for ( ; it != itEnd; ++it )
             new AnnItem( annItem, *it );
-            q->endInsertRows();
-        }
+
+        q->beginInsertRows( QModelIndex(), annItemIndex, annItemIndex );
+        root->children.insert( annItemIndex, annItem );
+        q->endInsertRows();
         return;
     }
-    // case 3: existing branch, less annotations than items
-    //         => lookup and remove the annotations
-    if ( annItem->children.count() > annots.count() )
+    // case 3: existing branch
+    //         => remove the items of the annotations that are gone, in runs of
+    //            adjacent rows, and append the new annotations
+    const QModelIndex parentIndex = q->createIndex( annItemIndex, 0, annItem );
+    QSet< Okular::Annotation* > annotations;
+    annotations.reserve( annots.count() );
+    foreach ( Okular::Annotation *annotation, annots )
+        annotations.insert( annotation );
+
+    int last = annItem->children.count() - 1;
+    while ( last >= 0 )
     {
-        for ( int i = annItem->children.count(); i > 0; --i )
+        if ( annotations.contains( annItem->children.at( last )->annotation ) )
         {
-            Okular::Annotation *ref = annItem->children.at( i - 1 )->annotation;
-            bool found = false;
-            QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-            for ( ; !found && it != itEnd; ++it )
-            {
-                if ( ( *it ) == ref )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginRemoveRows( indexForItem( annItem ), i - 1, i - 1 );
-                delete annItem->children.at( i - 1 );
-                annItem->children.removeAt( i - 1 );
-                q->endRemoveRows();
-            }
+            --last;
+            continue;
         }
-        return;
+        int first = last;
+        while ( first > 0 && !annotations.contains( annItem->children.at( first - 1 )->annotation ) )
+            --first;
+
+        q->beginRemoveRows( parentIndex, first, last );
+        for ( int i = last; i >= first; --i )
+            delete annItem->children.takeAt( i );
+        q->endRemoveRows();
+        last = first - 1;
     }
-    // case 4: existing branch, less items than annotations
-    //         => lookup and add annotations if not in the branch
-    if ( annots.count() > annItem->children.count() )
+
+    const int kept = annItem->children.count();
+    QSet< Okular::Annotation* > present;
+    present.reserve( kept );
+    for ( int i = 0; i < kept; ++i )
+        present.insert( annItem->children.at( i )->annotation );
+
+    QList< Okular::Annotation* > added;
+    foreach ( Okular::Annotation *annotation, annots )
     {
-        QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        for ( ; it != itEnd; ++it )
-        {
-            Okular::Annotation *ref = *it;
-            bool found = false;
-            int count = annItem->children.count();
-            for ( int i = 0; !found && i < count; ++i )
-            {
-                if ( ref == annItem->children.at( i )->annotation )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginInsertRows( indexForItem( annItem ), count, count );
-                new AnnItem( annItem, ref );
-                q->endInsertRows();
-            }
-        }
-        return;
+        if ( !present.contains( annotation ) )
+            added.append( annotation );
     }
-    // case 5: the data of some annotation changed
-    // TODO: what do we do in this case?
-    // FIXME: for now, update ALL the annotations for that page
-    for ( int i = 0; i < annItem->children.count(); ++i )
+    if ( !added.isEmpty() )
     {
-        QModelIndex index = indexForItem( annItem->children.at( i ) );
-        emit q->dataChanged( index, index );
+        q->beginInsertRows( parentIndex, kept, kept + added.count() - 1 );
+        foreach ( Okular::Annotation *annotation, added )
+            new AnnItem( annItem, annotation );
+        q->endInsertRows();
     }
+
+    // the annotations that stayed may have been modified as well, as one
+    // notification covers all the changes to the page
+    if ( kept > 0 )
+        emit q->dataChanged( q->index( 0, 0, parentIndex ), q->index( kept - 1, 0, parentIndex ) );
 }
 
 QModelIndex AnnotationModelPrivate::indexForItem( AnnItem *item ) const
 {
-    if ( item->parent )
+    if ( item->parent == root )
+    {
+        int id = -1;
+        if ( findItem( item->page, &id ) == item )
+            return q->createIndex( id, 0, item );
+    }
+    else if ( item->parent )
     {
         int id = item->parent->children.indexOf( item );
         if ( id >= 0 && id < item->parent->children.count() )
@@ -237,7 +249,6 @@ void AnnotationModelPrivate::rebuildTree( const QVector< Okular::Page * > &pages
     if ( pages.isEmpty() )
         return;
 
-    emit q->layoutAboutToBeChanged();
     for ( int i = 0; i < pages.count(); ++i )
     {
         const QLinkedList< Okular::Annotation* > annots = filterOutWidgetAnnotations( pages.at( i )->annotations() );
@@ -251,23 +262,26 @@ void AnnotationModelPrivate::rebuildTree( const QVector< Okular::Page * > &pages
             new AnnItem( annItem, *it );
         }
     }
-    emit q->layoutChanged();
 }
 
 AnnItem* AnnotationModelPrivate::findItem( int page, int *index ) const
 {
-    for ( int i = 0; i < root->children.count(); ++i )
+    // the branches are sorted by page; when there is no branch for the
+    // page, index is set to the row it would be inserted at
+    int low = 0;
+    int high = root->children.count();
+    while ( low < high )
     {
-        AnnItem *tmp = root->children.at( i );
-        if ( tmp->page == page )
-        {
-            if ( index )
-                *index = i;
-            return tmp;
-        }
+        const int mid = ( low + high ) / 2;
+        if ( root->children.at( mid )->page < page )
+            low = mid + 1;
+        else
+            high = mid;
     }
     if ( index )
-        *index = -1;
+        *index = low;
+    if ( low < root->children.count() && root->children.at( low )->page == page )
+        return root->children.at( low );
     return 0;
 }
 
@@ -170,11 +170,13 @@ void AnnotationPopup::exec( const QPoint &point )
             if ( pair.pageNumber != -1 )
                 mDocument->removePageAnnotation( pair.pageNumber, pair.annotation );
         } else if( actionType == deleteAllId ) {
+            mDocument->beginAnnotationBatch( i18nc( "remove a collection of annotations from the page", "remove annotations" ) );
             Q_FOREACH ( const AnnotPagePair& pair, mAnnotations )
             {
                 if ( pair.pageNumber != -1 )
                     mDocument->removePageAnnotation( pair.pageNumber, pair.annotation );
             }
+            mDocument->endAnnotationBatch();
         } else if( actionType == propertiesId ) {
             if ( pair.pageNumber != -1 ) {
                 AnnotsPropertiesDialog propdialog( mParent, mDocument, pair.pageNumber, pair.annotation );
@@ -9,6 +9,7 @@
 
 #include "annotationproxymodels.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QItemSelection>
 
@@ -17,11 +18,6 @@
 #include "annotationmodel.h"
 #include "debug_ui.h"
 
-static quint32 mixIndex( int row, int column )
-{
-    return ( row << 4 ) | column;
-}
-
 PageFilterProxyModel::PageFilterProxyModel( QObject *parent )
   : QSortFilterProxyModel( parent ),
     mGroupByCurrentPage( false ),
@@ -59,6 +55,10 @@ bool PageFilterProxyModel::filterAcceptsRow( int row, const QModelIndex &sourceP
   if ( !mGroupByCurrentPage )
     return true;
 
+  // the annotations of a shown page are shown as well
+  if ( sourceParent.isValid() )
+    return true;
+
   const QModelIndex pageIndex = sourceModel()->index( row, 0, sourceParent );
   int page = sourceModel()->data( pageIndex, AnnotationModel::PageRole ).toInt();
 
@@ -66,10 +66,30 @@ bool PageFilterProxyModel::filterAcceptsRow( int row, const QModelIndex &sourceP
 }
 
 
+/**
+ * A page of the source model, with the number of its annotations and the
+ * row of its first annotation when they are not grouped by page. The
+ * indexes of the annotations point to the node of their page, so that they
+ * stay valid when pages before it come and go.
+ */
+struct PageGroupProxyModel::PageNode
+{
+  int row;
+  int count;
+  int offset;
+};
+
 PageGroupProxyModel::PageGroupProxyModel( QObject *parent )
   : QAbstractProxyModel( parent ),
-    mGroupByPage( false )
+    mGroupByPage( false ),
+    mRemoving( false ),
+    mAnnotationCount( 0 )
+{
+}
+
+PageGroupProxyModel::~PageGroupProxyModel()
 {
+  qDeleteAll( mPageNodes );
 }
 
 int PageGroupProxyModel::columnCount( const QModelIndex &parentIndex ) const
@@ -98,17 +118,17 @@ int PageGroupProxyModel::rowCount( const QModelIndex &parentIndex ) const
 {
   if ( mGroupByPage ) {
     if ( parentIndex.isValid() ) {
-      if ( parentIndex.parent().isValid() )
+      if ( parentIndex.parent().isValid() || parentIndex.row() >= mPageNodes.count() )
         return 0;
       else {
-        return mTreeIndexes[ parentIndex.row() ].second.count(); // second-level
+        return mPageNodes[ parentIndex.row() ]->count; // second-level
       }
     } else {
-      return mTreeIndexes.count(); // top-level
+      return mPageNodes.count(); // top-level
     }
   } else {
     if ( !parentIndex.isValid() ) // top-level
-      return mIndexes.count();
+      return mAnnotationCount;
     else
       return 0;
   }
@@ -121,20 +141,20 @@ QModelIndex PageGroupProxyModel::index( int row, int column, const QModelIndex &
 
   if ( mGroupByPage ) {
     if ( parentIndex.isValid() ) {
-      if ( parentIndex.row() >= 0 && parentIndex.row() < mTreeIndexes.count()
-           && row < mTreeIndexes[ parentIndex.row() ].second.count() )
-        return createIndex( row, column, qint32( parentIndex.row() + 1 ) );
+      if ( !parentIndex.internalPointer() && parentIndex.row() >= 0 && parentIndex.row() < mPageNodes.count()
+           && row < mPageNodes[ parentIndex.row() ]->count )
+        return createIndex( row, column, mPageNodes[ parentIndex.row() ] );
       else
         return QModelIndex();
     } else {
-      if ( row < mTreeIndexes.count() )
+      if ( row < mPageNodes.count() )
         return createIndex( row, column );
       else
         return QModelIndex();
     }
   } else {
-    if ( row < mIndexes.count() )
-      return createIndex( row, column, mixIndex( parentIndex.row(), parentIndex.column() ) );
+    if ( !parentIndex.isValid() && row < mAnnotationCount )
+      return createIndex( row, column );
     else
       return QModelIndex();
   }
@@ -143,10 +163,11 @@ QModelIndex PageGroupProxyModel::index( int row, int column, const QModelIndex &
 QModelIndex PageGroupProxyModel::parent( const QModelIndex &idx ) const
 {
   if ( mGroupByPage ) {
-    if ( idx.internalId() == 0 ) // top-level
+    const PageNode *node = static_cast<PageNode*>( idx.internalPointer() );
+    if ( !node ) // top-level
       return QModelIndex();
     else
-      return index( idx.internalId() - 1, idx.column() );
+      return createIndex( node->row, 0 );
   } else {
     // We have only top-level items
     return QModelIndex();
@@ -155,19 +176,22 @@ QModelIndex PageGroupProxyModel::parent( const QModelIndex &idx ) const
 
 QModelIndex PageGroupProxyModel::mapFromSource( const QModelIndex &sourceIndex ) const
 {
+  if ( !sourceIndex.isValid() )
+    return QModelIndex();
+
+  const QModelIndex sourceParent = sourceIndex.parent();
   if ( mGroupByPage ) {
-    if ( sourceIndex.parent().isValid() ) {
-      return index( sourceIndex.row(), sourceIndex.column(), sourceIndex.parent() );
+    if ( sourceParent.isValid() ) {
+      return index( sourceIndex.row(), sourceIndex.column(), index( sourceParent.row(), 0 ) );
     } else {
       return index( sourceIndex.row(), sourceIndex.column() );
     }
   } else {
-    for ( int i = 0; i < mIndexes.count(); ++i ) {
-      if ( mIndexes[ i ] == sourceIndex )
-        return index( i, 0 );
-    }
+    // the pages themselves are not shown
+    if ( !sourceParent.isValid() || sourceParent.row() >= mPageNodes.count() )
+      return QModelIndex();
 
-    return QModelIndex();
+    return index( mPageNodes[ sourceParent.row() ]->offset + sourceIndex.row(), sourceIndex.column() );
   }
 }
 
@@ -177,24 +201,25 @@ QModelIndex PageGroupProxyModel::mapToSource( const QModelIndex &proxyIndex ) co
     return QModelIndex();
 
   if ( mGroupByPage ) {
-    if ( proxyIndex.internalId() == 0 ) {
+    const PageNode *node = static_cast<PageNode*>( proxyIndex.internalPointer() );
+    if ( !node ) {
 
-      if ( proxyIndex.row() >= mTreeIndexes.count() || proxyIndex.row() < 0 )
+      if ( proxyIndex.row() >= mPageNodes.count() || proxyIndex.row() < 0 )
         return QModelIndex();
 
-      return mTreeIndexes[ proxyIndex.row() ].first;
+      return sourceModel()->index( proxyIndex.row(), 0 );
     } else {
-      if ( proxyIndex.internalId() - 1 >= mTreeIndexes.count() ||
-           proxyIndex.row() >= mTreeIndexes[ proxyIndex.internalId() - 1 ].second.count() )
+      if ( proxyIndex.row() >= node->count )
         return QModelIndex();
 
-      return mTreeIndexes[ proxyIndex.internalId() - 1 ].second[ proxyIndex.row() ];
+      return sourceModel()->index( proxyIndex.row(), 0, sourceModel()->index( node->row, 0 ) );
     }
   } else {
-    if ( proxyIndex.column() > 0 || proxyIndex.row() >= mIndexes.count() )
+    if ( proxyIndex.column() > 0 || proxyIndex.row() >= mAnnotationCount )
       return QModelIndex();
     else {
-      return mIndexes[ proxyIndex.row() ];
+      const PageNode *node = pageNodeAt( proxyIndex.row() );
+      return sourceModel()->index( proxyIndex.row() - node->offset, 0, sourceModel()->index( node->row, 0 ) );
     }
   }
 }
@@ -204,16 +229,20 @@ void PageGroupProxyModel::setSourceModel( QAbstractItemModel *model )
   if ( sourceModel() ) {
     disconnect( sourceModel(), &QAbstractItemModel::layoutChanged, this, &PageGroupProxyModel::rebuildIndexes );
     disconnect( sourceModel(), &QAbstractItemModel::modelReset, this, &PageGroupProxyModel::rebuildIndexes );
-    disconnect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::rebuildIndexes );
-    disconnect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::rebuildIndexes );
+    disconnect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::sourceRowsInserted );
+    disconnect( sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &PageGroupProxyModel::sourceRowsAboutToBeRemoved );
+    disconnect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::sourceRowsRemoved );
+    disconnect( sourceModel(), &QAbstractItemModel::dataChanged, this, &PageGroupProxyModel::sourceDataChanged );
   }
 
   QAbstractProxyModel::setSourceModel( model );
 
   connect( sourceModel(), &QAbstractItemModel::layoutChanged, this, &PageGroupProxyModel::rebuildIndexes );
   connect( sourceModel(), &QAbstractItemModel::modelReset, this, &PageGroupProxyModel::rebuildIndexes );
-  connect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::rebuildIndexes );
-  connect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::rebuildIndexes );
+  connect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::sourceRowsInserted );
+  connect( sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &PageGroupProxyModel::sourceRowsAboutToBeRemoved );
+  connect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::sourceRowsRemoved );
+  connect( sourceModel(), &QAbstractItemModel::dataChanged, this, &PageGroupProxyModel::sourceDataChanged );
 
   rebuildIndexes();
 }
@@ -222,31 +251,152 @@ void PageGroupProxyModel::rebuildIndexes()
 {
   beginResetModel();
 
-  if ( mGroupByPage ) {
-    mTreeIndexes.clear();
+  qDeleteAll( mPageNodes );
+  mPageNodes.clear();
 
-    for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
-      const QModelIndex pageIndex = sourceModel()->index( row, 0 );
+  // only the annotations of each page are counted, both groupings are
+  // mapped from that
+  for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
+    PageNode *node = new PageNode;
+    node->count = sourceModel()->rowCount( sourceModel()->index( row, 0 ) );
+    mPageNodes.append( node );
+  }
+  updatePageNodes( 0 );
 
-      QList<QModelIndex> itemIndexes;
-      for ( int subRow = 0; subRow < sourceModel()->rowCount( pageIndex ); ++subRow ) {
-        itemIndexes.append( sourceModel()->index( subRow, 0, pageIndex ) );
-      }
+  endResetModel();
+}
 
-      mTreeIndexes.append( QPair<QModelIndex, QList<QModelIndex> >( pageIndex, itemIndexes ) );
+void PageGroupProxyModel::sourceRowsInserted( const QModelIndex &parent, int first, int last )
+{
+  if ( !parent.isValid() ) {
+    // new pages, with all their annotations
+    QList<PageNode*> nodes;
+    int count = 0;
+    for ( int row = first; row <= last; ++row ) {
+      PageNode *node = new PageNode;
+      node->count = sourceModel()->rowCount( sourceModel()->index( row, 0 ) );
+      count += node->count;
+      nodes.append( node );
     }
-  } else {
-    mIndexes.clear();
 
-    for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
-      const QModelIndex pageIndex = sourceModel()->index( row, 0 );
-      for ( int subRow = 0; subRow < sourceModel()->rowCount( pageIndex ); ++subRow ) {
-        mIndexes.append( sourceModel()->index( subRow, 0, pageIndex ) );
+    const int offset = first < mPageNodes.count() ? mPageNodes[ first ]->offset : mAnnotationCount;
+    const bool notify = mGroupByPage || count > 0;
+    if ( mGroupByPage )
+      beginInsertRows( QModelIndex(), first, last );
+    else if ( count > 0 )
+      beginInsertRows( QModelIndex(), offset, offset + count - 1 );
+
+    for ( int i = 0; i < nodes.count(); ++i )
+      mPageNodes.insert( first + i, nodes[ i ] );
+    updatePageNodes( first );
+
+    if ( notify )
+      endInsertRows();
+  } else if ( !parent.parent().isValid() ) {
+    // new annotations of a page
+    PageNode *node = mPageNodes.value( parent.row() );
+    if ( !node )
+      return;
+
+    if ( mGroupByPage )
+      beginInsertRows( createIndex( node->row, 0 ), first, last );
+    else
+      beginInsertRows( QModelIndex(), node->offset + first, node->offset + last );
+
+    node->count += last - first + 1;
+    updatePageNodes( node->row + 1 );
+
+    endInsertRows();
+  }
+}
+
+void PageGroupProxyModel::sourceRowsAboutToBeRemoved( const QModelIndex &parent, int first, int last )
+{
+  mRemoving = false;
+
+  if ( !parent.isValid() ) {
+    if ( last >= mPageNodes.count() )
+      return;
+
+    if ( mGroupByPage ) {
+      beginRemoveRows( QModelIndex(), first, last );
+      mRemoving = true;
+    } else {
+      const int from = mPageNodes[ first ]->offset;
+      const int to = mPageNodes[ last ]->offset + mPageNodes[ last ]->count - 1;
+      if ( to >= from ) {
+        beginRemoveRows( QModelIndex(), from, to );
+        mRemoving = true;
       }
     }
+  } else if ( !parent.parent().isValid() ) {
+    const PageNode *node = mPageNodes.value( parent.row() );
+    if ( !node || last >= node->count )
+      return;
+
+    if ( mGroupByPage )
+      beginRemoveRows( createIndex( node->row, 0 ), first, last );
+    else
+      beginRemoveRows( QModelIndex(), node->offset + first, node->offset + last );
+    mRemoving = true;
   }
+}
 
-  endResetModel();
+void PageGroupProxyModel::sourceRowsRemoved( const QModelIndex &parent, int first, int last )
+{
+  if ( !parent.isValid() ) {
+    for ( int row = qMin( last, mPageNodes.count() - 1 ); row >= first; --row )
+      delete mPageNodes.takeAt( row );
+    updatePageNodes( first );
+  } else if ( !parent.parent().isValid() ) {
+    PageNode *node = mPageNodes.value( parent.row() );
+    if ( node ) {
+      node->count = qMax( 0, node->count - ( last - first + 1 ) );
+      updatePageNodes( node->row + 1 );
+    }
+  }
+
+  if ( mRemoving ) {
+    mRemoving = false;
+    endRemoveRows();
+  }
+}
+
+void PageGroupProxyModel::sourceDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles )
+{
+  const QModelIndex proxyTopLeft = mapFromSource( topLeft );
+  const QModelIndex proxyBottomRight = mapFromSource( bottomRight );
+
+  // the annotations of a page are adjacent in both groupings
+  if ( proxyTopLeft.isValid() && proxyBottomRight.isValid() )
+    emit dataChanged( proxyTopLeft, proxyBottomRight, roles );
+}
+
+void PageGroupProxyModel::updatePageNodes( int from )
+{
+  int offset = from > 0 ? mPageNodes[ from - 1 ]->offset + mPageNodes[ from - 1 ]->count : 0;
+  for ( int i = from; i < mPageNodes.count(); ++i ) {
+    mPageNodes[ i ]->row = i;
+    mPageNodes[ i ]->offset = offset;
+    offset += mPageNodes[ i ]->count;
+  }
+  mAnnotationCount = offset;
+}
+
+PageGroupProxyModel::PageNode *PageGroupProxyModel::pageNodeAt( int row ) const
+{
+  // the last page starting at or before the row; the pages without
+  // annotations before it start at the same row
+  int low = 0;
+  int high = mPageNodes.count();
+  while ( low < high ) {
+    const int mid = ( low + high ) / 2;
+    if ( mPageNodes[ mid ]->offset <= row )
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low > 0 ? mPageNodes[ low - 1 ] : 0;
 }
 
 void PageGroupProxyModel::groupByPage( bool value )
@@ -280,7 +430,9 @@ class AuthorGroupItem
             qDeleteAll( mChilds );
         }
 
-        void appendChild( AuthorGroupItem *child ) { mChilds.append( child ); }
+        void insertChild( int row, AuthorGroupItem *child ) { child->mParent = this; mChilds.insert( row, child ); }
+        AuthorGroupItem* takeChild( int row ) { AuthorGroupItem *child = mChilds.takeAt( row ); child->mParent = 0; return child; }
+        void moveChild( int from, int to ) { mChilds.move( from, to ); }
         AuthorGroupItem* parent() const { return mParent; }
         AuthorGroupItem* child( int row ) const { return mChilds.value( row ); }
         int childCount() const { return mChilds.count(); }
@@ -296,24 +448,34 @@ class AuthorGroupItem
                 mChilds[ i ]->dump( level + 2 );
         }
 
-        const AuthorGroupItem* findIndex( const QModelIndex &index ) const
+        int row() const
         {
-            if ( index == mIndex )
-                return this;
+            return ( mParent ? mParent->mChilds.indexOf( const_cast<AuthorGroupItem*>( this ) ) : 0 );
+        }   
 
-            for ( int i = 0; i < mChilds.count(); ++i ) {
-                const AuthorGroupItem *item = mChilds[ i ]->findIndex( index );
-                if ( item )
-                    return item;
-            }
+        // An author is sorted where its first annotation is
+        int sourceRow() const
+        {
+            if ( mType == Author )
+                return ( mChilds.isEmpty() ? -1 : mChilds.first()->sourceRow() );
 
-            return 0;
+            return mIndex.row();
         }
 
-        int row() const
+        // The children are kept in the order of their source rows
+        int insertionRow( int sourceRow ) const
         {
-            return ( mParent ? mParent->mChilds.indexOf( const_cast<AuthorGroupItem*>( this ) ) : 0 );
-        }   
+            int low = 0;
+            int high = mChilds.count();
+            while ( low < high ) {
+                const int mid = ( low + high ) / 2;
+                if ( mChilds[ mid ]->sourceRow() < sourceRow )
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            return low;
+        }
 
         Type type() const { return mType; }
         QModelIndex index() const { return mIndex; }
@@ -321,11 +483,19 @@ class AuthorGroupItem
         void setAuthor( const QString &author ) { mAuthor = author; }
         QString author() const { return mAuthor; }
 
+        // The items of the source rows below this one, in the source order
+        QList<AuthorGroupItem*>& sourceChilds() { return mSourceChilds; }
+
+        // The author children, when grouping by author
+        QHash<QString, AuthorGroupItem*>& authorChilds() { return mAuthorChilds; }
+
     private:
         AuthorGroupItem *mParent;
         Type mType;
-        QModelIndex mIndex;
+        QPersistentModelIndex mIndex;
         QList<AuthorGroupItem*> mChilds;
+        QList<AuthorGroupItem*> mSourceChilds;
+        QHash<QString, AuthorGroupItem*> mAuthorChilds;
         QString mAuthor;
 };
 
@@ -342,11 +512,146 @@ class AuthorGroupProxyModel::Private
             delete mRoot;
         }
 
+        QModelIndex indexForItem( AuthorGroupItem *item ) const;
+        AuthorGroupItem* sourceParentItem( const QModelIndex &sourceParent ) const;
+        AuthorGroupItem* createItem( const QModelIndex &sourceIndex, AuthorGroupItem *sourceParent );
+        void addItem( AuthorGroupItem *sourceParent, AuthorGroupItem *item, bool notify );
+        void insertItem( AuthorGroupItem *parentItem, AuthorGroupItem *item, bool notify );
+        AuthorGroupItem* takeItem( AuthorGroupItem *item );
+        void sortItem( AuthorGroupItem *item, bool notify );
+
         AuthorGroupProxyModel *mParent;
         AuthorGroupItem *mRoot;
         bool mGroupByAuthor;
 };
 
+QModelIndex AuthorGroupProxyModel::Private::indexForItem( AuthorGroupItem *item ) const
+{
+    if ( item == mRoot )
+        return QModelIndex();
+
+    return mParent->createIndex( item->row(), 0, item );
+}
+
+AuthorGroupItem* AuthorGroupProxyModel::Private::sourceParentItem( const QModelIndex &sourceParent ) const
+{
+    if ( !sourceParent.isValid() )
+        return mRoot;
+
+    // only the pages have annotations below them
+    if ( !mRoot || sourceParent.parent().isValid() )
+        return 0;
+
+    AuthorGroupItem *item = mRoot->sourceChilds().value( sourceParent.row() );
+    return ( item && item->type() == AuthorGroupItem::Page ) ? item : 0;
+}
+
+AuthorGroupItem* AuthorGroupProxyModel::Private::createItem( const QModelIndex &sourceIndex, AuthorGroupItem *sourceParent )
+{
+    QAbstractItemModel *model = mParent->sourceModel();
+    const QString author = model->data( sourceIndex, AnnotationModel::AuthorRole ).toString();
+
+    // We have the annotations either as top-level, or below the pages
+    if ( sourceParent != mRoot || !author.isEmpty() ) {
+        AuthorGroupItem *item = new AuthorGroupItem( 0, AuthorGroupItem::Annotation, sourceIndex );
+        item->setAuthor( author );
+        return item;
+    }
+
+    AuthorGroupItem *pageItem = new AuthorGroupItem( 0, AuthorGroupItem::Page, sourceIndex );
+    for ( int subRow = 0; subRow < model->rowCount( sourceIndex ); ++subRow ) {
+        AuthorGroupItem *item = createItem( model->index( subRow, 0, sourceIndex ), pageItem );
+        pageItem->sourceChilds().append( item );
+        addItem( pageItem, item, false );
+    }
+
+    return pageItem;
+}
+
+void AuthorGroupProxyModel::Private::addItem( AuthorGroupItem *sourceParent, AuthorGroupItem *item, bool notify )
+{
+    if ( item->type() == AuthorGroupItem::Page || !mGroupByAuthor ) {
+        insertItem( sourceParent, item, notify );
+        return;
+    }
+
+    // Introduce the author when it has no annotation there yet
+    AuthorGroupItem *authorItem = sourceParent->authorChilds().value( item->author(), 0 );
+    if ( authorItem ) {
+        insertItem( authorItem, item, notify );
+        return;
+    }
+
+    authorItem = new AuthorGroupItem( 0, AuthorGroupItem::Author );
+    authorItem->setAuthor( item->author() );
+    sourceParent->authorChilds().insert( item->author(), authorItem );
+
+    insertItem( authorItem, item, false );
+    insertItem( sourceParent, authorItem, notify );
+}
+
+void AuthorGroupProxyModel::Private::insertItem( AuthorGroupItem *parentItem, AuthorGroupItem *item, bool notify )
+{
+    const int row = parentItem->insertionRow( item->sourceRow() );
+
+    if ( notify )
+        mParent->beginInsertRows( indexForItem( parentItem ), row, row );
+    parentItem->insertChild( row, item );
+    if ( notify )
+        mParent->endInsertRows();
+
+    // The author moves up with a new first annotation
+    if ( row == 0 && parentItem->type() == AuthorGroupItem::Author )
+        sortItem( parentItem, notify );
+}
+
+AuthorGroupItem* AuthorGroupProxyModel::Private::takeItem( AuthorGroupItem *item )
+{
+    AuthorGroupItem *parentItem = item->parent();
+
+    // The author goes away with its last annotation
+    if ( parentItem->type() == AuthorGroupItem::Author && parentItem->childCount() == 1 ) {
+        parentItem->parent()->authorChilds().remove( parentItem->author() );
+        takeItem( parentItem );
+        parentItem->takeChild( 0 );
+        delete parentItem;
+        return item;
+    }
+
+    const int row = item->row();
+    mParent->beginRemoveRows( indexForItem( parentItem ), row, row );
+    parentItem->takeChild( row );
+    mParent->endRemoveRows();
+
+    // The author moves down without its first annotation
+    if ( row == 0 && parentItem->type() == AuthorGroupItem::Author )
+        sortItem( parentItem, true );
+
+    return item;
+}
+
+void AuthorGroupProxyModel::Private::sortItem( AuthorGroupItem *item, bool notify )
+{
+    AuthorGroupItem *parentItem = item->parent();
+    if ( !parentItem )
+        return;
+
+    // Look for the row of the item among its siblings only
+    const int row = item->row();
+    parentItem->takeChild( row );
+    const int newRow = parentItem->insertionRow( item->sourceRow() );
+    parentItem->insertChild( row, item );
+    if ( newRow == row )
+        return;
+
+    const QModelIndex parentIndex = indexForItem( parentItem );
+    if ( notify )
+        mParent->beginMoveRows( parentIndex, row, row, parentIndex, newRow > row ? newRow + 1 : newRow );
+    parentItem->moveChild( row, newRow );
+    if ( notify )
+        mParent->endMoveRows();
+}
+
 AuthorGroupProxyModel::AuthorGroupProxyModel( QObject *parent )
     : QAbstractProxyModel( parent ),
       d( new Private( this ) )
@@ -411,11 +716,12 @@ QModelIndex AuthorGroupProxyModel::mapFromSource( const QModelIndex &sourceIndex
     if ( !sourceIndex.isValid() )
         return QModelIndex();
 
-    const AuthorGroupItem *item = d->mRoot->findIndex( sourceIndex );
+    AuthorGroupItem *sourceParent = d->sourceParentItem( sourceIndex.parent() );
+    AuthorGroupItem *item = sourceParent ? sourceParent->sourceChilds().value( sourceIndex.row() ) : 0;
     if ( !item )
         return QModelIndex();
 
-    return createIndex( item->row(), 0, const_cast<AuthorGroupItem*>( item ) );
+    return createIndex( item->row(), 0, item );
 }
 
 QModelIndex AuthorGroupProxyModel::mapToSource( const QModelIndex &proxyIndex ) const
@@ -433,16 +739,18 @@ void AuthorGroupProxyModel::setSourceModel( QAbstractItemModel *model )
     if ( sourceModel() ) {
         disconnect( sourceModel(), &QAbstractItemModel::layoutChanged, this, &AuthorGroupProxyModel::rebuildIndexes );
         disconnect( sourceModel(), &QAbstractItemModel::modelReset, this, &AuthorGroupProxyModel::rebuildIndexes );
-        disconnect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::rebuildIndexes );
-        disconnect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &AuthorGroupProxyModel::rebuildIndexes );
+        disconnect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::sourceRowsInserted );
+        disconnect( sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &AuthorGroupProxyModel::sourceRowsAboutToBeRemoved );
+        disconnect( sourceModel(), &QAbstractItemModel::dataChanged, this, &AuthorGroupProxyModel::sourceDataChanged );
     }
 
     QAbstractProxyModel::setSourceModel( model );
 
     connect( sourceModel(), &QAbstractItemModel::layoutChanged, this, &AuthorGroupProxyModel::rebuildIndexes );
     connect( sourceModel(), &QAbstractItemModel::modelReset, this, &AuthorGroupProxyModel::rebuildIndexes );
-    connect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::rebuildIndexes );
-    connect( sourceModel(), &QAbstractItemModel::rowsRemoved, this, &AuthorGroupProxyModel::rebuildIndexes );
+    connect( sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::sourceRowsInserted );
+    connect( sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &AuthorGroupProxyModel::sourceRowsAboutToBeRemoved );
+    connect( sourceModel(), &QAbstractItemModel::dataChanged, this, &AuthorGroupProxyModel::sourceDataChanged );
 
     rebuildIndexes();
 }
@@ -523,82 +831,69 @@ void AuthorGroupProxyModel::rebuildIndexes()
     delete d->mRoot;
     d->mRoot = new AuthorGroupItem( 0 );
 
-    if ( d->mGroupByAuthor ) {
-        QMap<QString, AuthorGroupItem*> authorMap;
-
-        for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
-            const QModelIndex idx = sourceModel()->index( row, 0 );
-            const QString author = sourceModel()->data( idx, AnnotationModel::AuthorRole ).toString();
-            if ( !author.isEmpty() ) {
-                // We have the annotations as top-level, so introduce authors as new
-                // top-levels and append the annotations
-                AuthorGroupItem *authorItem = authorMap.value( author, 0 );
-                if ( !authorItem ) {
-                    authorItem = new AuthorGroupItem( d->mRoot, AuthorGroupItem::Author );
-                    authorItem->setAuthor( author );
-
-                    // Add item to tree
-                    d->mRoot->appendChild( authorItem );
-
-                    // Insert to lookup list
-                    authorMap.insert( author, authorItem );
-                }
-
-                AuthorGroupItem *item = new AuthorGroupItem( authorItem, AuthorGroupItem::Annotation, idx );
-                authorItem->appendChild( item );
-            } else {
-                // We have the pages as top-level, so we use them as top-level, append the
-                // authors for all annotations of the page, and then the annotations themself
-                AuthorGroupItem *pageItem = new AuthorGroupItem( d->mRoot, AuthorGroupItem::Page, idx );
-                d->mRoot->appendChild( pageItem );
-
-                // First collect all authors...
-                QMap<QString, AuthorGroupItem*> pageAuthorMap;
-                for ( int subRow = 0; subRow < sourceModel()->rowCount( idx ); ++subRow ) {
-                    const QModelIndex annIdx = sourceModel()->index( subRow, 0, idx );
-                    const QString author = sourceModel()->data( annIdx, AnnotationModel::AuthorRole ).toString();
-
-                    AuthorGroupItem *authorItem = pageAuthorMap.value( author, 0 );
-                    if ( !authorItem ) {
-                        authorItem = new AuthorGroupItem( pageItem, AuthorGroupItem::Author );
-                        authorItem->setAuthor( author );
-
-                        // Add item to tree
-                        pageItem->appendChild( authorItem );
-
-                        // Insert to lookup list
-                        pageAuthorMap.insert( author, authorItem );
-                    }
-
-                    AuthorGroupItem *item = new AuthorGroupItem( authorItem, AuthorGroupItem::Annotation, annIdx );
-                    authorItem->appendChild( item );
-                }
-            }
-        }
-    } else {
-        for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
-            const QModelIndex idx = sourceModel()->index( row, 0 );
-            const QString author = sourceModel()->data( idx, AnnotationModel::AuthorRole ).toString();
-            if ( !author.isEmpty() ) {
-                // We have the annotations as top-level items
-                AuthorGroupItem *item = new AuthorGroupItem( d->mRoot, AuthorGroupItem::Annotation, idx );
-                d->mRoot->appendChild( item );
-            } else {
-                // We have the pages as top-level items
-                AuthorGroupItem *pageItem = new AuthorGroupItem( d->mRoot, AuthorGroupItem::Page, idx );
-                d->mRoot->appendChild( pageItem );
-
-                // Append all annotations as second-level
-                for ( int subRow = 0; subRow < sourceModel()->rowCount( idx ); ++subRow ) {
-                    const QModelIndex subIdx = sourceModel()->index( subRow, 0, idx );
-                    AuthorGroupItem *item = new AuthorGroupItem( pageItem, AuthorGroupItem::Annotation, subIdx );
-                    pageItem->appendChild( item );
-                }
-            }
-        }
+    for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
+        AuthorGroupItem *item = d->createItem( sourceModel()->index( row, 0 ), d->mRoot );
+        d->mRoot->sourceChilds().append( item );
+        d->addItem( d->mRoot, item, false );
     }
 
     endResetModel();
 }
 
+void AuthorGroupProxyModel::sourceRowsInserted( const QModelIndex &parent, int first, int last )
+{
+    AuthorGroupItem *sourceParent = d->sourceParentItem( parent );
+    if ( !sourceParent )
+        return;
+
+    for ( int row = first; row <= last; ++row ) {
+        AuthorGroupItem *item = d->createItem( sourceModel()->index( row, 0, parent ), sourceParent );
+        sourceParent->sourceChilds().insert( row, item );
+        d->addItem( sourceParent, item, true );
+    }
+}
+
+void AuthorGroupProxyModel::sourceRowsAboutToBeRemoved( const QModelIndex &parent, int first, int last )
+{
+    AuthorGroupItem *sourceParent = d->sourceParentItem( parent );
+    if ( !sourceParent )
+        return;
+
+    for ( int row = qMin( last, sourceParent->sourceChilds().count() - 1 ); row >= first; --row )
+        delete d->takeItem( sourceParent->sourceChilds().takeAt( row ) );
+}
+
+void AuthorGroupProxyModel::sourceDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight )
+{
+    const QModelIndex parent = topLeft.parent();
+    AuthorGroupItem *sourceParent = d->sourceParentItem( parent );
+    if ( !sourceParent )
+        return;
+
+    const int last = qMin( bottomRight.row(), sourceParent->sourceChilds().count() - 1 );
+    for ( int row = topLeft.row(); row <= last; ++row ) {
+        AuthorGroupItem *item = sourceParent->sourceChilds().at( row );
+        const QModelIndex idx = sourceModel()->index( row, 0, parent );
+        const QString author = sourceModel()->data( idx, AnnotationModel::AuthorRole ).toString();
+        const bool isAnnotation = ( sourceParent != d->mRoot || !author.isEmpty() );
+
+        if ( isAnnotation != ( item->type() == AuthorGroupItem::Annotation ) ) {
+            // A top-level annotation lost or got its author
+            delete d->takeItem( item );
+            item = d->createItem( idx, sourceParent );
+            sourceParent->sourceChilds()[ row ] = item;
+            d->addItem( sourceParent, item, true );
+        } else if ( d->mGroupByAuthor && isAnnotation && author != item->author() ) {
+            // Move the annotation to its new author
+            d->takeItem( item );
+            item->setAuthor( author );
+            d->addItem( sourceParent, item, true );
+        } else {
+            item->setAuthor( author );
+            const QModelIndex proxyIndex = d->indexForItem( item );
+            emit dataChanged( proxyIndex, proxyIndex );
+        }
+    }
+}
+
 #include "moc_annotationproxymodels.cpp"
@@ -11,7 +11,8 @@
 #define ANNOTATIONPROXYMODEL_H
 
 #include <QtCore/QSortFilterProxyModel>
-#include <QtCore/QPair>
+#include <QtCore/QList>
+#include <QtCore/QVector>
 
 /**
  * A proxy model, which filters out all pages except the
@@ -66,6 +67,7 @@ class PageGroupProxyModel : public QAbstractProxyModel
      * @param parent The parent object.
      */
     explicit PageGroupProxyModel( QObject *parent = nullptr );
+    ~PageGroupProxyModel();
 
     int columnCount( const QModelIndex &parentIndex ) const override;
     int rowCount( const QModelIndex &parentIndex ) const override;
@@ -87,11 +89,21 @@ class PageGroupProxyModel : public QAbstractProxyModel
 
   private Q_SLOTS:
     void rebuildIndexes();
+    void sourceRowsInserted( const QModelIndex &parent, int first, int last );
+    void sourceRowsAboutToBeRemoved( const QModelIndex &parent, int first, int last );
+    void sourceRowsRemoved( const QModelIndex &parent, int first, int last );
+    void sourceDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles );
 
   private:
+    struct PageNode;
+
+    void updatePageNodes( int from );
+    PageNode *pageNodeAt( int row ) const;
+
     bool mGroupByPage;
-    QList<QModelIndex> mIndexes;
-    QList<QPair< QModelIndex, QList<QModelIndex> > > mTreeIndexes;
+    bool mRemoving;
+    int mAnnotationCount;
+    QList<PageNode*> mPageNodes;
 };
 
 /**
@@ -136,6 +148,9 @@ class AuthorGroupProxyModel : public QAbstractProxyModel
 
     private Q_SLOTS:
         void rebuildIndexes();
+        void sourceRowsInserted( const QModelIndex &parent, int first, int last );
+        void sourceRowsAboutToBeRemoved( const QModelIndex &parent, int first, int last );
+        void sourceDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight );
 
     private:
         class Private;
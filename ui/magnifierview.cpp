@@ -43,6 +43,11 @@ MagnifierView::~MagnifierView()
 
 void MagnifierView::notifySetup(const QVector< Okular::Page* >& pages, int setupFlags)
 {
+  if (setupFlags & Okular::DocumentObserver::PagesAdded) {
+    m_pages = pages;
+    return;
+  }
+
   if (!(setupFlags & Okular::DocumentObserver::DocumentChanged)) {
     return;
   }
@@ -10,6 +10,7 @@
 #include "pagepainter.h"
 
 // qt / kde includes
+#include <qcache.h>
 #include <qrect.h>
 #include <qpainter.h>
 #include <qpalette.h>
@@ -20,6 +21,7 @@
 #include <QApplication>
 
 // system includes
+#include <algorithm>
 #include <math.h>
 
 // local includes
@@ -51,6 +53,132 @@ inline QPen buildPen( const Okular::Annotation *ann, double width, const QColor
     return p;
 }
 
+// bytes of rasterised annotations kept, beyond this the pages painted the
+// longest ago are dropped
+static const int AnnotationsCacheBytes = 64 * 1024 * 1024;
+// the annotations painted straight on the page are looked up in a grid of
+// that many cells per side
+static const int AnnotationsGridSize = 8;
+
+// composited annotations rasterised at the size of a page. Multiplying and
+// drawing over are both associative, so a run of annotations composited
+// the same way can be drawn on its own layer, composited at once later.
+struct AnnotationLayer
+{
+    AnnotationLayer( bool _multiply = false )
+        : multiply( _multiply )
+    {
+    }
+
+    bool multiply;
+    QRect rect;             // in the pixels of the uncropped page
+    QImage image;           // null if the layer did not fit in the cache
+    QVector< Okular::Annotation * > annotations;
+    QVector< QRect > rects;
+};
+
+struct PagePainter::PageAnnotations
+{
+    // the indexes in 'unbuffered' of the annotations in the cells touching
+    // the given normalized rect, in the order of the page
+    QVector< int > unbufferedAt( double left, double top, double right, double bottom ) const;
+
+    QVector< AnnotationLayer > layers;
+    QVector< Okular::Annotation * > unbuffered;
+    QVector< Okular::NormalizedRect > unbufferedRects;
+    QVector< int > grid[ AnnotationsGridSize * AnnotationsGridSize ];
+    QVector< Okular::Annotation * > externallyDrawn;
+};
+
+struct AnnotationsCacheKey
+{
+    const Okular::Page * page;
+    int revision;
+    int scaledWidth;
+    int scaledHeight;
+    int croppedWidth;
+};
+
+inline bool operator==( const AnnotationsCacheKey &k1, const AnnotationsCacheKey &k2 )
+{
+    return k1.page == k2.page && k1.revision == k2.revision && k1.scaledWidth == k2.scaledWidth &&
+           k1.scaledHeight == k2.scaledHeight && k1.croppedWidth == k2.croppedWidth;
+}
+
+inline uint qHash( const AnnotationsCacheKey &key, uint seed = 0 )
+{
+    return qHash( key.page, seed ) ^ qHash( key.revision ) ^
+           qHash( ( key.scaledWidth << 16 ) ^ key.scaledHeight ^ ( key.croppedWidth << 8 ) );
+}
+
+static void gridCells( double left, double top, double right, double bottom, int *x1, int *y1, int *x2, int *y2 )
+{
+    *x1 = qBound( 0, (int)( left * AnnotationsGridSize ), AnnotationsGridSize - 1 );
+    *y1 = qBound( 0, (int)( top * AnnotationsGridSize ), AnnotationsGridSize - 1 );
+    *x2 = qBound( 0, (int)( right * AnnotationsGridSize ), AnnotationsGridSize - 1 );
+    *y2 = qBound( 0, (int)( bottom * AnnotationsGridSize ), AnnotationsGridSize - 1 );
+}
+
+QVector< int > PagePainter::PageAnnotations::unbufferedAt( double left, double top, double right, double bottom ) const
+{
+    int x1, y1, x2, y2;
+    gridCells( left, top, right, bottom, &x1, &y1, &x2, &y2 );
+
+    QVector< int > indexes;
+    for ( int y = y1; y <= y2; ++y )
+        for ( int x = x1; x <= x2; ++x )
+            indexes += grid[ y * AnnotationsGridSize + x ];
+
+    // an annotation spanning several cells is listed by each of them
+    std::sort( indexes.begin(), indexes.end() );
+    indexes.erase( std::unique( indexes.begin(), indexes.end() ), indexes.end() );
+    return indexes;
+}
+
+// the pixels of the uncropped page a composited annotation can paint on,
+// its points count too as the boundary is not always up to date with them
+static QRect annotationPaintRect( const Okular::Annotation * a, const Okular::Page * page,
+    int scaledWidth, int scaledHeight, double pageScale )
+{
+    Okular::NormalizedRect bounds = a->transformedBoundingRectangle();
+    double margin = a->style().width() * pageScale;
+
+    if ( a->subType() == Okular::Annotation::ALine )
+    {
+        const Okular::LineAnnotation * la = (const Okular::LineAnnotation *) a;
+        foreach ( const Okular::NormalizedPoint &point, la->transformedLinePoints() )
+            bounds |= Okular::NormalizedRect( point.x, point.y, point.x, point.y );
+        // the leader lines
+        margin += qMax( fabs( la->lineLeadingForwardPoint() ), fabs( la->lineLeadingBackwardPoint() ) ) * scaledWidth / page->width();
+    }
+    else if ( a->subType() == Okular::Annotation::AHighlight )
+    {
+        Okular::HighlightAnnotation * ha = (Okular::HighlightAnnotation *) a;
+        foreach ( const Okular::HighlightAnnotation::Quad &quad, ha->highlightQuads() )
+        {
+            for ( int i = 0; i < 4; ++i )
+                bounds |= Okular::NormalizedRect( quad.transformedPoint( i ).x, quad.transformedPoint( i ).y,
+                                                  quad.transformedPoint( i ).x, quad.transformedPoint( i ).y );
+        }
+        // underlines and strike outs are 2 points wide
+        margin = qMax( margin, 2 * pageScale );
+    }
+    else if ( a->subType() == Okular::Annotation::AInk )
+    {
+        const Okular::InkAnnotation * ia = (const Okular::InkAnnotation *) a;
+        foreach ( const QLinkedList<Okular::NormalizedPoint> &inkPath, ia->transformedInkPaths() )
+        {
+            foreach ( const Okular::NormalizedPoint &point, inkPath )
+                bounds |= Okular::NormalizedRect( point.x, point.y, point.x, point.y );
+        }
+    }
+
+    // and a pixel more for antialiasing
+    const int pixels = (int)ceil( margin ) + 1;
+    return bounds.geometry( scaledWidth, scaledHeight ).adjusted( -pixels, -pixels, pixels, pixels )
+                 .intersected( QRect( 0, 0, scaledWidth, scaledHeight ) );
+}
+
 void PagePainter::paintPageOnPainter( QPainter * destPainter, const Okular::Page * page,
     Okular::DocumentObserver *observer, int flags, int scaledWidth, int scaledHeight, const QRect &limits )
 {
@@ -128,7 +256,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
     // make this a qcolor, rect map, since we don't need
     // to know s_id here! we are only drawing this right?
     QList< QPair<QColor, Okular::NormalizedRect> > * bufferedHighlights = 0;
-    QList< Okular::Annotation * > * bufferedAnnotations = 0;
+    QList< const AnnotationLayer * > * bufferedLayers = 0;
     QList< Okular::Annotation * > * unbufferedAnnotations = 0;
     Okular::Annotation *boundingRectOnlyAnn = 0; // Paint the bounding rect of this annotation
     // fill up lists with visible annotation/highlight objects/text selections
@@ -179,55 +307,39 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         // append annotations inside limits to the un/buffered list
         if ( canDrawAnnotations )
         {
-            QLinkedList< Okular::Annotation * >::const_iterator aIt = page->m_annotations.constBegin(), aEnd = page->m_annotations.constEnd();
-            for ( ; aIt != aEnd; ++aIt )
-            {
-                Okular::Annotation * ann = *aIt;
-                int flags = ann->flags();
+            const PageAnnotations * annotations = pageAnnotations( page, scaledWidth, scaledHeight, croppedWidth );
 
-                if ( flags & Okular::Annotation::Hidden )
-                    continue;
+            // ExternallyDrawn annots are never rendered by PagePainter.
+            // Just paint the boundingRect if the annot is moved or resized.
+            foreach ( Okular::Annotation * ann, annotations->externallyDrawn )
+            {
+                if ( ann->flags() & (Okular::Annotation::BeingMoved | Okular::Annotation::BeingResized) )
+                    boundingRectOnlyAnn = ann;
+            }
 
-                if ( flags & Okular::Annotation::ExternallyDrawn )
+            // composited annotations are painted by layers
+            const QRect limitsInPage = limits.translated( scaledCrop.topLeft() );
+            QVector< AnnotationLayer >::const_iterator lIt = annotations->layers.constBegin(), lEnd = annotations->layers.constEnd();
+            for ( ; lIt != lEnd; ++lIt )
+            {
+                if ( (*lIt).rect.intersects( limitsInPage ) )
                 {
-                    // ExternallyDrawn annots are never rendered by PagePainter.
-                    // Just paint the boundingRect if the annot is moved or resized.
-                    if ( flags & (Okular::Annotation::BeingMoved | Okular::Annotation::BeingResized) )
-                    {
-                        boundingRectOnlyAnn = ann;
-                    }
-                    continue;
+                    if ( !bufferedLayers )
+                        bufferedLayers = new QList< const AnnotationLayer * >();
+                    bufferedLayers->append( &(*lIt) );
                 }
+            }
 
-                bool intersects = ann->transformedBoundingRectangle().intersects( nXMin, nYMin, nXMax, nYMax );
-                if ( ann->subType() == Okular::Annotation::AText )
-                {
-                    Okular::TextAnnotation * ta = static_cast< Okular::TextAnnotation * >( ann );
-                    if ( ta->textType() == Okular::TextAnnotation::Linked )
-                    {
-                        Okular::NormalizedRect iconrect( ann->transformedBoundingRectangle().left,
-                                                         ann->transformedBoundingRectangle().top,
-                                                         ann->transformedBoundingRectangle().left + TEXTANNOTATION_ICONSIZE / page->width(),
-                                                         ann->transformedBoundingRectangle().top + TEXTANNOTATION_ICONSIZE / page->height() );
-                        intersects = iconrect.intersects( nXMin, nYMin, nXMax, nYMax );
-                    }
-                }
-                if ( intersects )
+            // the other ones are found through the grid
+            const QVector< int > candidates = annotations->unbufferedAt( nXMin, nYMin, nXMax, nYMax );
+            QVector< int >::const_iterator cIt = candidates.constBegin(), cEnd = candidates.constEnd();
+            for ( ; cIt != cEnd; ++cIt )
+            {
+                if ( annotations->unbufferedRects[ *cIt ].intersects( nXMin, nYMin, nXMax, nYMax ) )
                 {
-                    Okular::Annotation::SubType type = ann->subType();
-                    if ( type == Okular::Annotation::ALine || type == Okular::Annotation::AHighlight ||
-                         type == Okular::Annotation::AInk  /*|| (type == Annotation::AGeom && ann->style().opacity() < 0.99)*/ )
-                    {
-                        if ( !bufferedAnnotations )
-                            bufferedAnnotations = new QList< Okular::Annotation * >();
-                        bufferedAnnotations->append( ann );
-                    }
-                    else
-                    {
-                        if ( !unbufferedAnnotations )
-                            unbufferedAnnotations = new QList< Okular::Annotation * >();
-                        unbufferedAnnotations->append( ann );
-                    }
+                    if ( !unbufferedAnnotations )
+                        unbufferedAnnotations = new QList< Okular::Annotation * >();
+                    unbufferedAnnotations->append( annotations->unbuffered[ *cIt ] );
                 }
             }
         }
@@ -236,7 +348,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
     /** 3 - ENABLE BACKBUFFERING IF DIRECT IMAGE MANIPULATION IS NEEDED **/
     bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
-    bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedAnnotations || viewPortPoint;
+    bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedLayers || viewPortPoint;
     QPixmap * backPixmap = 0;
     QPainter * mixedPainter = 0;
     QRect limitsInPixmap = limits.translated( scaledCrop.topLeft() );
@@ -430,7 +542,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
             }
         }
         // 4B.4. paint annotations [COMPOSITED ONES]
-        if ( bufferedAnnotations )
+        if ( bufferedLayers )
         {
             // Albert: This is quite "heavy" but all the backImage that reach here are QImage::Format_ARGB32_Premultiplied
             // and have to be so that the QPainter::CompositionMode_Multiply works
@@ -445,181 +557,32 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
                    yOffset = (double)limits.top() / (double)scaledHeight + crop.top,
                    yScale = (double)scaledHeight / (double)limits.height();
 
-            // paint all buffered annotations in the page
-            QList< Okular::Annotation * >::const_iterator aIt = bufferedAnnotations->constBegin(), aEnd = bufferedAnnotations->constEnd();
-            for ( ; aIt != aEnd; ++aIt )
+            // paint the layers of annotations in the page
+            QList< const AnnotationLayer * >::const_iterator lIt = bufferedLayers->constBegin(), lEnd = bufferedLayers->constEnd();
+            for ( ; lIt != lEnd; ++lIt )
             {
-                Okular::Annotation * a = *aIt;
-                Okular::Annotation::SubType type = a->subType();
-                QColor acolor = a->style().color();
-                if ( !acolor.isValid() )
-                    acolor = Qt::yellow;
-                acolor.setAlphaF( a->style().opacity() );
-
-                // draw LineAnnotation MISSING: all
-                if ( type == Okular::Annotation::ALine )
-                {
-                    // get the annotation
-                    Okular::LineAnnotation * la = (Okular::LineAnnotation *) a;
-
-                    NormalizedPath path;
-                    // normalize page point to image
-                    const QLinkedList<Okular::NormalizedPoint> points = la->transformedLinePoints();
-                    QLinkedList<Okular::NormalizedPoint>::const_iterator it = points.constBegin();
-                    QLinkedList<Okular::NormalizedPoint>::const_iterator itEnd = points.constEnd();
-                    for ( ; it != itEnd; ++it )
-                    {
-                        Okular::NormalizedPoint point;
-                        point.x = ( (*it).x - xOffset) * xScale;
-                        point.y = ( (*it).y - yOffset) * yScale;
-                        path.append( point );
-                    }
-
-                    const QPen linePen = buildPen( a, a->style().width(), a->style().color() );
-                    QBrush fillBrush;
-
-                    if ( la->lineClosed() && la->lineInnerColor().isValid() )
-                        fillBrush = QBrush( la->lineInnerColor() );
-
-                    // draw the line as normalized path into image
-                    drawShapeOnImage( backImage, path, la->lineClosed(),
-                                      linePen,
-                                      fillBrush, pageScale ,Multiply);
-
-                    if ( path.count() == 2 && fabs( la->lineLeadingForwardPoint() ) > 0.1 )
-                    {
-                        Okular::NormalizedPoint delta( la->transformedLinePoints().last().x - la->transformedLinePoints().first().x, la->transformedLinePoints().first().y - la->transformedLinePoints().last().y );
-                        double angle = atan2( delta.y, delta.x );
-                        if ( delta.y < 0 )
-                            angle += 2 * M_PI;
-
-                        int sign = la->lineLeadingForwardPoint() > 0.0 ? 1 : -1;
-                        double LLx = fabs( la->lineLeadingForwardPoint() ) * cos( angle + sign * M_PI_2 + 2 * M_PI ) / page->width();
-                        double LLy = fabs( la->lineLeadingForwardPoint() ) * sin( angle + sign * M_PI_2 + 2 * M_PI ) / page->height();
-
-                        NormalizedPath path2;
-                        NormalizedPath path3;
-
-                        Okular::NormalizedPoint point;
-                        point.x = ( la->transformedLinePoints().first().x + LLx - xOffset ) * xScale;
-                        point.y = ( la->transformedLinePoints().first().y - LLy - yOffset ) * yScale;
-                        path2.append( point );
-                        point.x = ( la->transformedLinePoints().last().x + LLx - xOffset ) * xScale;
-                        point.y = ( la->transformedLinePoints().last().y - LLy - yOffset ) * yScale;
-                        path3.append( point );
-                        // do we have the extension on the "back"?
-                        if ( fabs( la->lineLeadingBackwardPoint() ) > 0.1 )
-                        {
-                            double LLEx = la->lineLeadingBackwardPoint() * cos( angle - sign * M_PI_2 + 2 * M_PI ) / page->width();
-                            double LLEy = la->lineLeadingBackwardPoint() * sin( angle - sign * M_PI_2 + 2 * M_PI ) / page->height();
-                            point.x = ( la->transformedLinePoints().first().x + LLEx - xOffset ) * xScale;
-                            point.y = ( la->transformedLinePoints().first().y - LLEy - yOffset ) * yScale;
-                            path2.append( point );
-                            point.x = ( la->transformedLinePoints().last().x + LLEx - xOffset ) * xScale;
-                            point.y = ( la->transformedLinePoints().last().y - LLEy - yOffset ) * yScale;
-                            path3.append( point );
-                        }
-                        else
-                        {
-                            path2.append( path[0] );
-                            path3.append( path[1] );
-                        }
+                const AnnotationLayer * layer = *lIt;
 
-                        drawShapeOnImage( backImage, path2, false, linePen, QBrush(), pageScale, Multiply );
-                        drawShapeOnImage( backImage, path3, false, linePen, QBrush(), pageScale, Multiply );
-                    }
-                }
-                // draw HighlightAnnotation MISSING: under/strike width, feather, capping
-                else if ( type == Okular::Annotation::AHighlight )
+                // compose the part of the rasterised layer inside limits the
+                // way its annotations would have been drawn one by one
+                if ( !layer->image.isNull() )
                 {
-                    // get the annotation
-                    Okular::HighlightAnnotation * ha = (Okular::HighlightAnnotation *) a;
-                    Okular::HighlightAnnotation::HighlightType type = ha->highlightType();
-
-                    // draw each quad of the annotation
-                    int quads = ha->highlightQuads().size();
-                    for ( int q = 0; q < quads; q++ )
-                    {
-                        NormalizedPath path;
-                        const Okular::HighlightAnnotation::Quad & quad = ha->highlightQuads()[ q ];
-                        // normalize page point to image
-                        for ( int i = 0; i < 4; i++ )
-                        {
-                            Okular::NormalizedPoint point;
-                            point.x = (quad.transformedPoint( i ).x - xOffset) * xScale;
-                            point.y = (quad.transformedPoint( i ).y - yOffset) * yScale;
-                            path.append( point );
-                        }
-                        // draw the normalized path into image
-                        switch ( type )
-                        {
-                            // highlight the whole rect
-                            case Okular::HighlightAnnotation::Highlight:
-                                drawShapeOnImage( backImage, path, true, Qt::NoPen, acolor, pageScale, Multiply );
-                                break;
-                            // highlight the bottom part of the rect
-                            case Okular::HighlightAnnotation::Squiggly:
-                                path[ 3 ].x = ( path[ 0 ].x + path[ 3 ].x ) / 2.0;
-                                path[ 3 ].y = ( path[ 0 ].y + path[ 3 ].y ) / 2.0;
-                                path[ 2 ].x = ( path[ 1 ].x + path[ 2 ].x ) / 2.0;
-                                path[ 2 ].y = ( path[ 1 ].y + path[ 2 ].y ) / 2.0;
-                                drawShapeOnImage( backImage, path, true, Qt::NoPen, acolor, pageScale, Multiply );
-                                break;
-                            // make a line at 3/4 of the height
-                            case Okular::HighlightAnnotation::Underline:
-                                path[ 0 ].x = ( 3 * path[ 0 ].x + path[ 3 ].x ) / 4.0;
-                                path[ 0 ].y = ( 3 * path[ 0 ].y + path[ 3 ].y ) / 4.0;
-                                path[ 1 ].x = ( 3 * path[ 1 ].x + path[ 2 ].x ) / 4.0;
-                                path[ 1 ].y = ( 3 * path[ 1 ].y + path[ 2 ].y ) / 4.0;
-                                path.pop_back();
-                                path.pop_back();
-                                drawShapeOnImage( backImage, path, false, QPen( acolor, 2 ), QBrush(), pageScale );
-                                break;
-                            // make a line at 1/2 of the height
-                            case Okular::HighlightAnnotation::StrikeOut:
-                                path[ 0 ].x = ( path[ 0 ].x + path[ 3 ].x ) / 2.0;
-                                path[ 0 ].y = ( path[ 0 ].y + path[ 3 ].y ) / 2.0;
-                                path[ 1 ].x = ( path[ 1 ].x + path[ 2 ].x ) / 2.0;
-                                path[ 1 ].y = ( path[ 1 ].y + path[ 2 ].y ) / 2.0;
-                                path.pop_back();
-                                path.pop_back();
-                                drawShapeOnImage( backImage, path, false, QPen( acolor, 2 ), QBrush(), pageScale );
-                                break;
-                        }
-                    }
+                    const QRect layerRect = layer->rect.intersected( limitsInPixmap );
+                    QPainter painter( &backImage );
+                    if ( layer->multiply )
+                        painter.setCompositionMode( QPainter::CompositionMode_Multiply );
+                    painter.drawImage( layerRect.topLeft() - limitsInPixmap.topLeft(), layer->image,
+                                       layerRect.translated( -layer->rect.topLeft() ) );
+                    continue;
                 }
-                // draw InkAnnotation MISSING:invar width, PENTRACER
-                else if ( type == Okular::Annotation::AInk )
-                {
-                    // get the annotation
-                    Okular::InkAnnotation * ia = (Okular::InkAnnotation *) a;
-
-                    // draw each ink path
-                    const QList< QLinkedList<Okular::NormalizedPoint> > transformedInkPaths = ia->transformedInkPaths();
-
-                    const QPen inkPen = buildPen( a, a->style().width(), acolor );
-
-                    int paths = transformedInkPaths.size();
-                    for ( int p = 0; p < paths; p++ )
-                    {
-                        NormalizedPath path;
-                        const QLinkedList<Okular::NormalizedPoint> & inkPath = transformedInkPaths[ p ];
 
-                        // normalize page point to image
-                        QLinkedList<Okular::NormalizedPoint>::const_iterator pIt = inkPath.constBegin(), pEnd = inkPath.constEnd();
-                        for ( ; pIt != pEnd; ++pIt )
-                        {
-                            const Okular::NormalizedPoint & inkPoint = *pIt;
-                            Okular::NormalizedPoint point;
-                            point.x = (inkPoint.x - xOffset) * xScale;
-                            point.y = (inkPoint.y - yOffset) * yScale;
-                            path.append( point );
-                        }
-                        // draw the normalized path into image
-                        drawShapeOnImage( backImage, path, false, inkPen, QBrush(), pageScale );
-                    }
+                // else the layer was too big to be kept, draw its annotations
+                for ( int i = 0; i < layer->annotations.count(); ++i )
+                {
+                    if ( layer->rects[ i ].intersects( limitsInPixmap ) )
+                        drawAnnotationOnImage( backImage, layer->annotations[ i ], page, xOffset, xScale, yOffset, yScale, pageScale );
                 }
-            } // end current annotation drawing
+            }
         }
 
         if(viewPortPoint)
@@ -857,11 +820,288 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
     // delete object containers
     delete bufferedHighlights;
-    delete bufferedAnnotations;
+    delete bufferedLayers;
     delete unbufferedAnnotations;
 }
 
 
+/** Private Helpers :: Annotations **/
+void PagePainter::drawAnnotationOnImage( QImage & image, const Okular::Annotation * a, const Okular::Page * page,
+    double xOffset, double xScale, double yOffset, double yScale, double pageScale )
+{
+    Okular::Annotation::SubType type = a->subType();
+    QColor acolor = a->style().color();
+    if ( !acolor.isValid() )
+        acolor = Qt::yellow;
+    acolor.setAlphaF( a->style().opacity() );
+
+    // draw LineAnnotation MISSING: all
+    if ( type == Okular::Annotation::ALine )
+    {
+        // get the annotation
+        const Okular::LineAnnotation * la = (const Okular::LineAnnotation *) a;
+
+        NormalizedPath path;
+        // normalize page point to image
+        const QLinkedList<Okular::NormalizedPoint> points = la->transformedLinePoints();
+        QLinkedList<Okular::NormalizedPoint>::const_iterator it = points.constBegin();
+        QLinkedList<Okular::NormalizedPoint>::const_iterator itEnd = points.constEnd();
+        for ( ; it != itEnd; ++it )
+        {
+            Okular::NormalizedPoint point;
+            point.x = ( (*it).x - xOffset) * xScale;
+            point.y = ( (*it).y - yOffset) * yScale;
+            path.append( point );
+        }
+
+        const QPen linePen = buildPen( a, a->style().width(), a->style().color() );
+        QBrush fillBrush;
+
+        if ( la->lineClosed() && la->lineInnerColor().isValid() )
+            fillBrush = QBrush( la->lineInnerColor() );
+
+        // draw the line as normalized path into image
+        drawShapeOnImage( image, path, la->lineClosed(),
+                          linePen,
+                          fillBrush, pageScale ,Multiply);
+
+        if ( path.count() == 2 && fabs( la->lineLeadingForwardPoint() ) > 0.1 )
+        {
+            Okular::NormalizedPoint delta( la->transformedLinePoints().last().x - la->transformedLinePoints().first().x, la->transformedLinePoints().first().y - la->transformedLinePoints().last().y );
+            double angle = atan2( delta.y, delta.x );
+            if ( delta.y < 0 )
+                angle += 2 * M_PI;
+
+            int sign = la->lineLeadingForwardPoint() > 0.0 ? 1 : -1;
+            double LLx = fabs( la->lineLeadingForwardPoint() ) * cos( angle + sign * M_PI_2 + 2 * M_PI ) / page->width();
+            double LLy = fabs( la->lineLeadingForwardPoint() ) * sin( angle + sign * M_PI_2 + 2 * M_PI ) / page->height();
+
+            NormalizedPath path2;
+            NormalizedPath path3;
+
+            Okular::NormalizedPoint point;
+            point.x = ( la->transformedLinePoints().first().x + LLx - xOffset ) * xScale;
+            point.y = ( la->transformedLinePoints().first().y - LLy - yOffset ) * yScale;
+            path2.append( point );
+            point.x = ( la->transformedLinePoints().last().x + LLx - xOffset ) * xScale;
+            point.y = ( la->transformedLinePoints().last().y - LLy - yOffset ) * yScale;
+            path3.append( point );
+            // do we have the extension on the "back"?
+            if ( fabs( la->lineLeadingBackwardPoint() ) > 0.1 )
+            {
+                double LLEx = la->lineLeadingBackwardPoint() * cos( angle - sign * M_PI_2 + 2 * M_PI ) / page->width();
+                double LLEy = la->lineLeadingBackwardPoint() * sin( angle - sign * M_PI_2 + 2 * M_PI ) / page->height();
+                point.x = ( la->transformedLinePoints().first().x + LLEx - xOffset ) * xScale;
+                point.y = ( la->transformedLinePoints().first().y - LLEy - yOffset ) * yScale;
+                path2.append( point );
+                point.x = ( la->transformedLinePoints().last().x + LLEx - xOffset ) * xScale;
+                point.y = ( la->transformedLinePoints().last().y - LLEy - yOffset ) * yScale;
+                path3.append( point );
+            }
+            else
+            {
+                path2.append( path[0] );
+                path3.append( path[1] );
+            }
+
+            drawShapeOnImage( image, path2, false, linePen, QBrush(), pageScale, Multiply );
+            drawShapeOnImage( image, path3, false, linePen, QBrush(), pageScale, Multiply );
+        }
+    }
+    // draw HighlightAnnotation MISSING: under/strike width, feather, capping
+    else if ( type == Okular::Annotation::AHighlight )
+    {
+        // get the annotation
+        Okular::HighlightAnnotation * ha = (Okular::HighlightAnnotation *) a;
+        Okular::HighlightAnnotation::HighlightType type = ha->highlightType();
+
+        // draw each quad of the annotation
+        int quads = ha->highlightQuads().size();
+        for ( int q = 0; q < quads; q++ )
+        {
+            NormalizedPath path;
+            const Okular::HighlightAnnotation::Quad & quad = ha->highlightQuads()[ q ];
+            // normalize page point to image
+            for ( int i = 0; i < 4; i++ )
+            {
+                Okular::NormalizedPoint point;
+                point.x = (quad.transformedPoint( i ).x - xOffset) * xScale;
+                point.y = (quad.transformedPoint( i ).y - yOffset) * yScale;
+                path.append( point );
+            }
+            // draw the normalized path into image
+            switch ( type )
+            {
+                // highlight the whole rect
+                case Okular::HighlightAnnotation::Highlight:
+                    drawShapeOnImage( image, path, true, Qt::NoPen, acolor, pageScale, Multiply );
+                    break;
+                // highlight the bottom part of the rect
+                case Okular::HighlightAnnotation::Squiggly:
+                    path[ 3 ].x = ( path[ 0 ].x + path[ 3 ].x ) / 2.0;
+                    path[ 3 ].y = ( path[ 0 ].y + path[ 3 ].y ) / 2.0;
+                    path[ 2 ].x = ( path[ 1 ].x + path[ 2 ].x ) / 2.0;
+                    path[ 2 ].y = ( path[ 1 ].y + path[ 2 ].y ) / 2.0;
+                    drawShapeOnImage( image, path, true, Qt::NoPen, acolor, pageScale, Multiply );
+                    break;
+                // make a line at 3/4 of the height
+                case Okular::HighlightAnnotation::Underline:
+                    path[ 0 ].x = ( 3 * path[ 0 ].x + path[ 3 ].x ) / 4.0;
+                    path[ 0 ].y = ( 3 * path[ 0 ].y + path[ 3 ].y ) / 4.0;
+                    path[ 1 ].x = ( 3 * path[ 1 ].x + path[ 2 ].x ) / 4.0;
+                    path[ 1 ].y = ( 3 * path[ 1 ].y + path[ 2 ].y ) / 4.0;
+                    path.pop_back();
+                    path.pop_back();
+                    drawShapeOnImage( image, path, false, QPen( acolor, 2 ), QBrush(), pageScale );
+                    break;
+                // make a line at 1/2 of the height
+                case Okular::HighlightAnnotation::StrikeOut:
+                    path[ 0 ].x = ( path[ 0 ].x + path[ 3 ].x ) / 2.0;
+                    path[ 0 ].y = ( path[ 0 ].y + path[ 3 ].y ) / 2.0;
+                    path[ 1 ].x = ( path[ 1 ].x + path[ 2 ].x ) / 2.0;
+                    path[ 1 ].y = ( path[ 1 ].y + path[ 2 ].y ) / 2.0;
+                    path.pop_back();
+                    path.pop_back();
+                    drawShapeOnImage( image, path, false, QPen( acolor, 2 ), QBrush(), pageScale );
+                    break;
+            }
+        }
+    }
+    // draw InkAnnotation MISSING:invar width, PENTRACER
+    else if ( type == Okular::Annotation::AInk )
+    {
+        // get the annotation
+        const Okular::InkAnnotation * ia = (const Okular::InkAnnotation *) a;
+
+        // draw each ink path
+        const QList< QLinkedList<Okular::NormalizedPoint> > transformedInkPaths = ia->transformedInkPaths();
+
+        const QPen inkPen = buildPen( a, a->style().width(), acolor );
+
+        int paths = transformedInkPaths.size();
+        for ( int p = 0; p < paths; p++ )
+        {
+            NormalizedPath path;
+            const QLinkedList<Okular::NormalizedPoint> & inkPath = transformedInkPaths[ p ];
+
+            // normalize page point to image
+            QLinkedList<Okular::NormalizedPoint>::const_iterator pIt = inkPath.constBegin(), pEnd = inkPath.constEnd();
+            for ( ; pIt != pEnd; ++pIt )
+            {
+                const Okular::NormalizedPoint & inkPoint = *pIt;
+                Okular::NormalizedPoint point;
+                point.x = (inkPoint.x - xOffset) * xScale;
+                point.y = (inkPoint.y - yOffset) * yScale;
+                path.append( point );
+            }
+            // draw the normalized path into image
+            drawShapeOnImage( image, path, false, inkPen, QBrush(), pageScale );
+        }
+    }
+}
+
+
+const PagePainter::PageAnnotations * PagePainter::pageAnnotations( const Okular::Page * page,
+    int scaledWidth, int scaledHeight, int croppedWidth )
+{
+    static QCache< AnnotationsCacheKey, PageAnnotations > cache( AnnotationsCacheBytes / 1024 );
+
+    // the revision changes with the annotations, and with the page geometry
+    const AnnotationsCacheKey key = { page, page->d->m_annotationsRevision, scaledWidth, scaledHeight, croppedWidth };
+    if ( const PageAnnotations * annotations = cache.object( key ) )
+        return annotations;
+
+    PageAnnotations * annotations = new PageAnnotations;
+    const double pageScale = (double)croppedWidth / page->width();
+
+    QLinkedList< Okular::Annotation * >::const_iterator aIt = page->m_annotations.constBegin(), aEnd = page->m_annotations.constEnd();
+    for ( ; aIt != aEnd; ++aIt )
+    {
+        Okular::Annotation * ann = *aIt;
+        int flags = ann->flags();
+
+        if ( flags & Okular::Annotation::Hidden )
+            continue;
+
+        if ( flags & Okular::Annotation::ExternallyDrawn )
+        {
+            annotations->externallyDrawn.append( ann );
+            continue;
+        }
+
+        Okular::Annotation::SubType type = ann->subType();
+        if ( type == Okular::Annotation::ALine || type == Okular::Annotation::AHighlight ||
+             type == Okular::Annotation::AInk  /*|| (type == Annotation::AGeom && ann->style().opacity() < 0.99)*/ )
+        {
+            // see drawAnnotationOnImage() for which ones are multiplied
+            bool multiply = type == Okular::Annotation::ALine;
+            if ( type == Okular::Annotation::AHighlight )
+            {
+                const Okular::HighlightAnnotation::HighlightType highlightType = ( (const Okular::HighlightAnnotation *) ann )->highlightType();
+                multiply = highlightType == Okular::HighlightAnnotation::Highlight || highlightType == Okular::HighlightAnnotation::Squiggly;
+            }
+            if ( annotations->layers.isEmpty() || annotations->layers.last().multiply != multiply )
+                annotations->layers.append( AnnotationLayer( multiply ) );
+
+            AnnotationLayer &layer = annotations->layers.last();
+            const QRect rect = annotationPaintRect( ann, page, scaledWidth, scaledHeight, pageScale );
+            layer.annotations.append( ann );
+            layer.rects.append( rect );
+            layer.rect |= rect;
+        }
+        else
+        {
+            Okular::NormalizedRect rect = ann->transformedBoundingRectangle();
+            if ( type == Okular::Annotation::AText )
+            {
+                Okular::TextAnnotation * ta = static_cast< Okular::TextAnnotation * >( ann );
+                if ( ta->textType() == Okular::TextAnnotation::Linked )
+                {
+                    rect = Okular::NormalizedRect( rect.left, rect.top,
+                                                   rect.left + TEXTANNOTATION_ICONSIZE / page->width(),
+                                                   rect.top + TEXTANNOTATION_ICONSIZE / page->height() );
+                }
+            }
+
+            const int index = annotations->unbuffered.count();
+            annotations->unbuffered.append( ann );
+            annotations->unbufferedRects.append( rect );
+
+            int x1, y1, x2, y2;
+            gridCells( rect.left, rect.top, rect.right, rect.bottom, &x1, &y1, &x2, &y2 );
+            for ( int y = y1; y <= y2; ++y )
+                for ( int x = x1; x <= x2; ++x )
+                    annotations->grid[ y * AnnotationsGridSize + x ].append( index );
+        }
+    }
+
+    // rasterise the layers as long as a few pages fit in the cache, the
+    // other ones are drawn at every paint
+    qint64 bytes = 0;
+    QVector< AnnotationLayer >::iterator lIt = annotations->layers.begin(), lEnd = annotations->layers.end();
+    for ( ; lIt != lEnd; ++lIt )
+    {
+        AnnotationLayer &layer = *lIt;
+        const qint64 layerBytes = (qint64)layer.rect.width() * layer.rect.height() * 4;
+        if ( layer.rect.isEmpty() || bytes + layerBytes > AnnotationsCacheBytes / 4 )
+            continue;
+        bytes += layerBytes;
+
+        layer.image = QImage( layer.rect.size(), QImage::Format_ARGB32_Premultiplied );
+        layer.image.fill( Qt::transparent );
+        const double xOffset = (double)layer.rect.left() / (double)scaledWidth,
+                     xScale = (double)scaledWidth / (double)layer.rect.width(),
+                     yOffset = (double)layer.rect.top() / (double)scaledHeight,
+                     yScale = (double)scaledHeight / (double)layer.rect.height();
+        for ( int i = 0; i < layer.annotations.count(); ++i )
+            drawAnnotationOnImage( layer.image, layer.annotations[ i ], page, xOffset, xScale, yOffset, yScale, pageScale );
+    }
+
+    cache.insert( key, annotations, qMax( 1, (int)( bytes / 1024 ) ) );
+    return annotations;
+}
+
+
 /** Private Helpers :: Pixmap conversion **/
 void PagePainter::cropPixmapOnImage( QImage & dest, const QPixmap * src, const QRect & r )
 {
@@ -19,6 +19,7 @@
 class QPainter;
 class QRect;
 namespace Okular {
+    class Annotation;
     class DocumentObserver;
     class Page;
 }
@@ -78,6 +79,18 @@ class Q_DECL_EXPORT PagePainter
             RasterOperation op = Normal
             //float antiAliasRadius = 1.0
         );
+
+        // draw a line, highlight or ink annotation on 'image', mapping the
+        // normalized page coordinates to the normalized image coordinates
+        // with '(x - xOffset) * xScale' and '(y - yOffset) * yScale'
+        static void drawAnnotationOnImage( QImage & image, const Okular::Annotation * a, const Okular::Page * page,
+            double xOffset, double xScale, double yOffset, double yScale, double pageScale );
+
+        // the annotations of 'page' sorted for painting at the given size,
+        // with the composited ones rasterised in layers, cached until they change
+        struct PageAnnotations;
+        static const PageAnnotations * pageAnnotations( const Okular::Page * page,
+            int scaledWidth, int scaledHeight, int croppedWidth );
 };
 
 #endif
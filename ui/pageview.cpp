@@ -82,6 +82,7 @@
 #include "core/form.h"
 #include "core/page.h"
 #include "core/misc.h"
+#include "core/rendertrace_p.h"
 #include "core/generator.h"
 #include "core/movie.h"
 #include "core/audioplayer.h"
@@ -186,6 +187,7 @@ public:
 #endif
     QTimer * refreshTimer;
     QSet<int> refreshPages;
+    QTimer * renderStatisticsTimer;
 
     // bbox state for Trim to Selection mode
     Okular::NormalizedRect trimBoundingBox;
@@ -326,6 +328,7 @@ PageView::PageView( QWidget *parent, Okular::Document *document )
     d->m_tts = 0;
 #endif
     d->refreshTimer = 0;
+    d->renderStatisticsTimer = 0;
     d->aRotateClockwise = 0;
     d->aRotateCounterClockwise = 0;
     d->aRotateOriginal = 0;
@@ -842,6 +845,12 @@ void PageView::reparseConfig()
 
     updatePageStep();
 
+    if ( !Okular::Settings::debugDrawRenderStatistics() )
+    {
+        delete d->renderStatisticsTimer;
+        d->renderStatisticsTimer = 0;
+    }
+
     if ( d->annotator )
     {
         d->annotator->setEnabled( false );
@@ -1769,6 +1778,35 @@ void PageView::paintEvent(QPaintEvent *pe)
                 }
             }
         }
+
+        // 5) Layer 3: statistics of the pixmap requests
+        if ( Okular::Settings::debugDrawRenderStatistics() )
+            drawRenderStatistics( &screenPainter );
+}
+
+void PageView::drawRenderStatistics( QPainter * screenPainter )
+{
+    // the statistics change without the view being repainted, refresh them
+    // while they are shown
+    if ( !d->renderStatisticsTimer )
+    {
+        d->renderStatisticsTimer = new QTimer( this );
+        connect( d->renderStatisticsTimer, &QTimer::timeout,
+                 viewport(), static_cast<void (QWidget::*)()>( &QWidget::update ) );
+        d->renderStatisticsTimer->start( 1000 );
+    }
+
+    const QStringList lines = Okular::RenderTrace::instance()->report( this );
+    const QFontMetrics metrics = screenPainter->fontMetrics();
+    int textWidth = 0;
+    foreach ( const QString &line, lines )
+        textWidth = qMax( textWidth, metrics.width( line ) );
+
+    const QRect box( contentAreaPosition() + QPoint( 4, 4 ),
+                     QSize( textWidth + 8, lines.count() * metrics.lineSpacing() + 8 ) );
+    screenPainter->fillRect( box, QColor( 0, 0, 0, 180 ) );
+    screenPainter->setPen( Qt::white );
+    screenPainter->drawText( box.adjusted( 4, 4, -4, -4 ), Qt::AlignLeft | Qt::AlignTop, lines.join( QLatin1Char( '\n' ) ) );
 }
 
 void PageView::drawTableDividers(QPainter * screenPainter)
@@ -3481,9 +3519,12 @@ void PageView::drawDocumentOnPainter( const QRect & contentsRect, QPainter * p )
             }
             QRect pixmapRect = contentsRect.intersected( itemGeometry );
             pixmapRect.translate( -item->croppedGeometry().topLeft() );
+            const qint64 paintStart = Okular::RenderTrace::now();
             PagePainter::paintCroppedPageOnPainter( p, item->page(), this, pageflags,
                 item->uncroppedWidth(), item->uncroppedHeight(), pixmapRect,
                 item->crop(), viewPortPoint );
+            Okular::RenderTrace::instance()->paintDone( this, item->pageNumber(), paintStart,
+                item->page()->hasPixmap( this, item->uncroppedWidth(), item->uncroppedHeight() ) );
         }
 
         // remove painted area from 'remainingArea' and restore painter
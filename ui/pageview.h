@@ -161,6 +161,7 @@ Q_OBJECT
         void selectionStart( const QPoint & pos, const QColor & color, bool aboveAll = false );
         void selectionClear( const ClearMode mode = ClearAllSelection );
         void drawTableDividers(QPainter * screenPainter);
+        void drawRenderStatistics( QPainter * screenPainter );
         void guessTableDividers();
         // update either text or rectangle selection
         void updateSelection( const QPoint & pos );
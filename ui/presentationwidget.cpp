@@ -142,6 +142,7 @@ PresentationWidget::PresentationWidget( QWidget * parent, Okular::Document * doc
     : QWidget( 0 /* must be null, to have an independent widget */, Qt::FramelessWindowHint ),
     m_pressedLink( 0 ), m_handCursor( false ), m_drawingEngine( 0 ),
     m_screenInhibitCookie(0), m_sleepInhibitCookie(0),
+    m_transitionLastFrameTime( 0 ), m_transitionMaxFrameTime( 0 ), m_transitionFrames( 0 ),
     m_parentWidget( parent ),
     m_document( doc ), m_frameIndex( -1 ), m_topBar( 0 ), m_pagesEdit( 0 ), m_searchBar( 0 ),
     m_ac( collection ), m_screenSelect( 0 ), m_isSetup( false ), m_blockNotifications( false ), m_inBlackScreenMode( false ),
@@ -313,19 +314,33 @@ void PresentationWidget::notifySetup( const QVector< Okular::Page * > & pageSet,
 {
     // same document, nothing to change - here we assume the document sets up
     // us with the whole document set as first notifySetup()
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    const bool documentChanged = setupFlags & Okular::DocumentObserver::DocumentChanged;
+    if ( !documentChanged && !( setupFlags & Okular::DocumentObserver::PagesAdded ) )
         return;
 
-    // delete previous frames (if any (shouldn't be))
-    QVector< PresentationFrame * >::iterator fIt = m_frames.begin(), fEnd = m_frames.end();
-    for ( ; fIt != fEnd; ++fIt )
-        delete *fIt;
-    if ( !m_frames.isEmpty() )
-        qCWarning(OkularUiDebug) << "Frames setup changed while a Presentation is in progress.";
-    m_frames.clear();
+    // only add frames for the appended pages if the document is the same
+    if ( documentChanged )
+    {
+        // delete previous frames (if any (shouldn't be))
+        QVector< PresentationFrame * >::iterator fIt = m_frames.begin(), fEnd = m_frames.end();
+        for ( ; fIt != fEnd; ++fIt )
+            delete *fIt;
+        if ( !m_frames.isEmpty() )
+            qCWarning(OkularUiDebug) << "Frames setup changed while a Presentation is in progress.";
+        m_frames.clear();
+        m_frameCache.clear();
+        m_overlayCache.clear();
+        m_drawingsLayer = QPixmap();
+    }
+    else
+    {
+        // the overlays show the number of pages; the composed frames only
+        // have the contents of the pages, so they stay
+        m_overlayCache.clear();
+    }
 
     // create the new frames
-    QVector< Okular::Page * >::const_iterator setIt = pageSet.begin(), setEnd = pageSet.end();
+    QVector< Okular::Page * >::const_iterator setIt = pageSet.begin() + qMin( m_frames.count(), pageSet.count() ), setEnd = pageSet.end();
     float screenRatio = (float)m_height / (float)m_width;
     for ( ; setIt != setEnd; ++setIt )
     {
@@ -369,6 +384,12 @@ void PresentationWidget::notifySetup( const QVector< Okular::Page * > & pageSet,
         m_frames.push_back( frame );
     }
 
+#ifdef ENABLE_PROGRESS_OVERLAY
+    // the overlay on screen shows the old number of pages
+    if ( !documentChanged && m_frameIndex != -1 && m_overlayHideTimer->isActive() )
+        generateOverlay();
+#endif
+
     // get metadata from the document
     m_metaStrings.clear();
     const Okular::DocumentInfo info = m_document->documentInfo( QSet<Okular::DocumentInfo::Key>() << Okular::DocumentInfo::Title << Okular::DocumentInfo::Author );
@@ -397,9 +418,18 @@ void PresentationWidget::notifyPageChanged( int pageNumber, int changedFlags )
     if ( m_blockNotifications )
         return;
 
+    if ( !( changedFlags & ( DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights ) ) )
+        return;
+
+    // the composited frame of the page is outdated now
+    m_frameCache.remove( pageNumber );
+
     // check if it's the last requested pixmap. if so update the widget.
-    if ( (changedFlags & ( DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights ) ) && pageNumber == m_frameIndex )
+    if ( pageNumber == m_frameIndex )
         generatePage( changedFlags & ( DocumentObserver::Annotations | DocumentObserver::Highlights ) );
+    // otherwise get the frame ready for when we get there
+    else
+        precomposeFrame( pageNumber );
 }
 
 void PresentationWidget::notifyCurrentPageChanged( int previousPage, int currentPage )
@@ -459,6 +489,8 @@ void PresentationWidget::notifyCurrentPageChanged( int previousPage, int current
         {
             // make the background pixmap
             generatePage();
+            // and keep the look-ahead window filled
+            requestPixmaps();
         }
 
         // perform the page opening action, if any
@@ -849,19 +881,36 @@ void PresentationWidget::paintEvent( QPaintEvent * pe )
 
         const QRect & geom = m_frames[ m_frameIndex ]->geometry;
 
-        QPixmap pm( geom.size() );
-        pm.fill( Qt::transparent );
-        QPainter pmPainter( &pm );
-
-        pmPainter.setRenderHints( QPainter::Antialiasing );
-        foreach ( const SmoothPath &drawing, m_frames[ m_frameIndex ]->drawings )
-            drawing.paint( &pmPainter, geom.width(), geom.height() );
+        // the finished drawings are kept in their own layer (erasing them
+        // must not erase the page), which is only rebuilt when they change
+        if ( m_drawingsLayer.isNull() && !m_frames[ m_frameIndex ]->drawings.isEmpty() )
+        {
+            m_drawingsLayer = QPixmap( geom.size() );
+            m_drawingsLayer.fill( Qt::transparent );
+            QPainter layerPainter( &m_drawingsLayer );
+            layerPainter.setRenderHints( QPainter::Antialiasing );
+            foreach ( const SmoothPath &drawing, m_frames[ m_frameIndex ]->drawings )
+                drawing.paint( &layerPainter, geom.width(), geom.height() );
+        }
 
+        painter.setRenderHints( QPainter::Antialiasing );
         if ( m_drawingEngine && m_drawingRect.intersects( pe->rect() ) )
+        {
+            QPixmap pm( geom.size() );
+            pm.fill( Qt::transparent );
+            QPainter pmPainter( &pm );
+            pmPainter.drawPixmap( 0, 0, m_drawingsLayer );
+
+            pmPainter.setRenderHints( QPainter::Antialiasing );
             m_drawingEngine->paint( &pmPainter, geom.width(), geom.height(), m_drawingRect.intersected( pe->rect() ) );
+            pmPainter.end();
 
-        painter.setRenderHints( QPainter::Antialiasing );
-        painter.drawPixmap( geom.topLeft() , pm );
+            painter.drawPixmap( geom.topLeft() , pm );
+        }
+        else if ( !m_drawingsLayer.isNull() )
+        {
+            painter.drawPixmap( geom.topLeft() , m_drawingsLayer );
+        }
 
         painter.restore();
     }
@@ -993,26 +1042,34 @@ void PresentationWidget::changePage( int newPage )
 
 void PresentationWidget::generatePage( bool disableTransition )
 {
-    if ( m_lastRenderedPixmap.isNull() )
-    {
-        m_lastRenderedPixmap = QPixmap( m_width, m_height );
-        m_previousPagePixmap = QPixmap();
-    }
-    else
-    {
-        m_previousPagePixmap = m_lastRenderedPixmap;
-    }
+    m_previousPagePixmap = m_lastRenderedPixmap;
+    m_drawingsLayer = QPixmap();
 
-    // opens the painter over the pixmap
-    QPainter pixmapPainter;
-    pixmapPainter.begin( &m_lastRenderedPixmap );
     // generate welcome page
     if ( m_frameIndex == -1 )
+    {
+        QPixmap introPixmap( m_width, m_height );
+        QPainter pixmapPainter( &introPixmap );
         generateIntroPage( pixmapPainter );
-    // generate a normal pixmap with extended margin filling
-    if ( m_frameIndex >= 0 && m_frameIndex < (int)m_document->pages() )
-        generateContentsPage( m_frameIndex, pixmapPainter );
-    pixmapPainter.end();
+        pixmapPainter.end();
+        m_lastRenderedPixmap = introPixmap;
+    }
+    // use the composited frame of the page (a normal pixmap with extended
+    // margin filling), generating it if it was not prepared in advance
+    else if ( m_frameIndex < (int)m_document->pages() )
+    {
+        QHash< int, QPixmap >::const_iterator it = m_frameCache.constFind( m_frameIndex );
+        if ( it != m_frameCache.constEnd() )
+        {
+            m_lastRenderedPixmap = *it;
+        }
+        else
+        {
+            m_lastRenderedPixmap = composeFrame( m_frameIndex );
+            if ( isFrameCacheable( m_frameIndex ) )
+                m_frameCache.insert( m_frameIndex, m_lastRenderedPixmap );
+        }
+    }
 
     // generate the top-right corner overlay
 #ifdef ENABLE_PROGRESS_OVERLAY
@@ -1135,6 +1192,26 @@ void PresentationWidget::generateOverlay()
     int side = m_width / 16;
     m_overlayGeometry.setRect( m_width - side - 4, 4, side, side );
 
+    QHash< int, QPixmap >::const_iterator it = m_overlayCache.constFind( m_frameIndex );
+    if ( it != m_overlayCache.constEnd() )
+    {
+        m_lastRenderedOverlay = *it;
+    }
+    else
+    {
+        m_lastRenderedOverlay = renderOverlay( m_frameIndex, side );
+        m_overlayCache.insert( m_frameIndex, m_lastRenderedOverlay );
+    }
+
+    // start the autohide timer
+    //repaint( m_overlayGeometry ); // toggle with next line
+    update( m_overlayGeometry );
+    m_overlayHideTimer->start( 2500 );
+#endif
+}
+
+QPixmap PresentationWidget::renderOverlay( int frameIndex, int side ) const
+{
     // note: to get a sort of antialiasing, we render the pixmap double sized
     // and the resulting image is smoothly scaled down. So here we open a
     // painter on the double sized pixmap.
@@ -1148,7 +1225,7 @@ void PresentationWidget::generateOverlay()
     int pages = m_document->pages();
     if ( pages > 28 )
     {   // draw continuous slices
-        int degrees = (int)( 360 * (float)(m_frameIndex + 1) / (float)pages );
+        int degrees = (int)( 360 * (float)(frameIndex + 1) / (float)pages );
         pixmapPainter.setPen( 0x05 );
         pixmapPainter.setBrush( QColor( 0x40 ) );
         pixmapPainter.drawPie( 2, 2, side - 4, side - 4, 90*16, (360-degrees)*16 );
@@ -1162,8 +1239,8 @@ void PresentationWidget::generateOverlay()
         for ( int i = 0; i < pages; i++ )
         {
             float newCoord = -90 + 360 * (float)(i + 1) / (float)pages;
-            pixmapPainter.setPen( i <= m_frameIndex ? 0x40 : 0x05 );
-            pixmapPainter.setBrush( QColor( i <= m_frameIndex ? 0xF0 : 0x40 ) );
+            pixmapPainter.setPen( i <= frameIndex ? 0x40 : 0x05 );
+            pixmapPainter.setBrush( QColor( i <= frameIndex ? 0xF0 : 0x40 ) );
             pixmapPainter.drawPie( 2, 2, side - 4, side - 4,
                                    (int)( -16*(oldCoord + 1) ), (int)( -16*(newCoord - (oldCoord + 2)) ) );
             oldCoord = newCoord;
@@ -1180,7 +1257,7 @@ void PresentationWidget::generateOverlay()
     pixmapPainter.setFont( f );
     pixmapPainter.setPen( 0xFF );
     // use a little offset to prettify output
-    pixmapPainter.drawText( 2, 2, side, side, Qt::AlignCenter, QString::number( m_frameIndex + 1 ) );
+    pixmapPainter.drawText( 2, 2, side, side, Qt::AlignCenter, QString::number( frameIndex + 1 ) );
 
     // end drawing pixmap and halve image
     pixmapPainter.end();
@@ -1231,15 +1308,70 @@ void PresentationWidget::generateOverlay()
         else
             data[i] = qRgba( cR, cG, cB, cA );
     }
-    m_lastRenderedOverlay = QPixmap::fromImage( image );
+    return QPixmap::fromImage( image );
+}
 
-    // start the autohide timer
-    //repaint( m_overlayGeometry ); // toggle with next line
-    update( m_overlayGeometry );
-    m_overlayHideTimer->start( 2500 );
+QPixmap PresentationWidget::composeFrame( int frameIndex )
+{
+    QPixmap pixmap( m_width, m_height );
+    QPainter pixmapPainter( &pixmap );
+    generateContentsPage( frameIndex, pixmapPainter );
+    pixmapPainter.end();
+    return pixmap;
+}
+
+bool PresentationWidget::isFrameCacheable( int frameIndex ) const
+{
+    // frames composed before the page pixmap arrived must not be kept around
+    const PresentationFrame * frame = m_frames[ frameIndex ];
+    return frame->page->hasPixmap( this, frame->geometry.width(), frame->geometry.height() );
+}
+
+void PresentationWidget::precomposeFrame( int frameIndex )
+{
+    if ( m_frameIndex == -1 || frameIndex < 0 || frameIndex >= m_frames.count() )
+        return;
+    if ( qAbs( frameIndex - m_frameIndex ) > framesToPrepare() )
+        return;
+
+    if ( !m_frameCache.contains( frameIndex ) && isFrameCacheable( frameIndex ) )
+        m_frameCache.insert( frameIndex, composeFrame( frameIndex ) );
+
+#ifdef ENABLE_PROGRESS_OVERLAY
+    if ( Okular::Settings::slidesShowProgress() && !m_overlayCache.contains( frameIndex ) )
+        m_overlayCache.insert( frameIndex, renderOverlay( frameIndex, m_width / 16 ) );
 #endif
 }
 
+void PresentationWidget::pruneFrameCache()
+{
+    const int window = framesToPrepare();
+    QHash< int, QPixmap >::iterator it = m_frameCache.begin();
+    while ( it != m_frameCache.end() )
+    {
+        if ( qAbs( it.key() - m_frameIndex ) > window )
+            it = m_frameCache.erase( it );
+        else
+            ++it;
+    }
+    it = m_overlayCache.begin();
+    while ( it != m_overlayCache.end() )
+    {
+        if ( qAbs( it.key() - m_frameIndex ) > window )
+            it = m_overlayCache.erase( it );
+        else
+            ++it;
+    }
+}
+
+int PresentationWidget::framesToPrepare() const
+{
+    if ( Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Low )
+        return 0;
+    // the neighbours of the current slide were always preloaded
+    return qMax( Okular::Settings::slidesPreloadPages(), 1 );
+}
+
 
 QRect PresentationWidget::routeMouseDrawingEvent( QMouseEvent * e )
 {
@@ -1303,6 +1435,7 @@ QRect PresentationWidget::routeMouseDrawingEvent( QMouseEvent * e )
     {
         // add drawing to current page
         m_frames[ m_frameIndex ]->drawings << m_drawingEngine->endSmoothPath();
+        m_drawingsLayer = QPixmap();
 
         // manually disable and re-enable the pencil mode, so we can do
         // cleaning of the actual drawer and create a new one just after
@@ -1384,13 +1517,14 @@ void PresentationWidget::requestPixmaps()
     QApplication::setOverrideCursor( QCursor( Qt::BusyCursor ) );
     // request the pixmap
     QLinkedList< Okular::PixmapRequest * > requests;
-    requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, pixW, pixH, PRESENTATION_PRIO, Okular::PixmapRequest::NoFeature ) );
+    if ( !frame->page->hasPixmap( this, pixW, pixH ) )
+        requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, pixW, pixH, PRESENTATION_PRIO, Okular::PixmapRequest::NoFeature ) );
     // restore cursor
     QApplication::restoreOverrideCursor();
-    // ask for next and previous page if not in low memory usage setting
+    // ask for next and previous pages if not in low memory usage setting
     if ( Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low )
     {
-        int pagesToPreload = 1;
+        int pagesToPreload = framesToPrepare();
 
         // If greedy, preload everything
         if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy)
@@ -1427,6 +1561,11 @@ void PresentationWidget::requestPixmaps()
         }
     }
     m_document->requestPixmaps( requests );
+
+    // drop the frames we moved away from, and compose the ones whose page
+    // pixmaps are already there once the current page has been shown
+    pruneFrameCache();
+    QMetaObject::invokeMethod( this, "slotPrecomposeFrames", Qt::QueuedConnection );
 }
 
 
@@ -1506,23 +1645,22 @@ void PresentationWidget::slotHideOverlay()
 
 void PresentationWidget::slotTransitionStep()
 {
+    recordTransitionFrame();
+
     switch( m_currentTransition.type() )
     {
         case Okular::PageTransition::Fade:
         {
-            QPainter pixmapPainter;
             m_currentPixmapOpacity += 1.0 / m_transitionSteps;
-            m_lastRenderedPixmap = QPixmap( m_lastRenderedPixmap.size() );
-            m_lastRenderedPixmap.fill( Qt::transparent );
-            pixmapPainter.begin( &m_lastRenderedPixmap );
-            pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
-            pixmapPainter.setOpacity( 1 - m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
-            pixmapPainter.setOpacity( m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
-            update();
             if( m_currentPixmapOpacity >= 1 )
+            {
+                m_lastRenderedPixmap = m_currentPagePixmap;
+                update();
+                finishTransitionStatistics();
                 return;
+            }
+            blendTransitionFrame();
+            update();
         } break;
         default:
         {
@@ -1531,6 +1669,7 @@ void PresentationWidget::slotTransitionStep()
                 // it's better to fix the transition to cover the whole screen than
                 // enabling the following line that wastes cpu for nothing
                 //update();
+                finishTransitionStatistics();
                 return;
             }
 
@@ -1544,6 +1683,65 @@ void PresentationWidget::slotTransitionStep()
     m_transitionTimer->start( m_transitionDelay );
 }
 
+void PresentationWidget::slotPrecomposeFrames()
+{
+    // nearest frames first, so the likely next slide is ready soonest
+    const int window = framesToPrepare();
+    for ( int i = 1; i <= window; ++i )
+    {
+        precomposeFrame( m_frameIndex + i );
+        precomposeFrame( m_frameIndex - i );
+    }
+}
+
+void PresentationWidget::blendTransitionFrame()
+{
+    // drop our reference to the transition buffer first, so that painting
+    // on it reuses the same pixmap instead of detaching a new one
+    m_lastRenderedPixmap = QPixmap();
+    if ( m_transitionPixmap.size() != m_currentPagePixmap.size() )
+        m_transitionPixmap = QPixmap( m_currentPagePixmap.size() );
+
+    QPainter pixmapPainter( &m_transitionPixmap );
+    pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
+    if ( m_previousPagePixmap.isNull() )
+        pixmapPainter.fillRect( m_transitionPixmap.rect(), Okular::Settings::slidesBackgroundColor() );
+    else
+        pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
+    pixmapPainter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+    pixmapPainter.setOpacity( m_currentPixmapOpacity );
+    pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
+    pixmapPainter.end();
+
+    m_lastRenderedPixmap = m_transitionPixmap;
+}
+
+void PresentationWidget::startTransitionStatistics()
+{
+    m_transitionFrames = 0;
+    m_transitionLastFrameTime = 0;
+    m_transitionMaxFrameTime = 0;
+    m_transitionClock.start();
+}
+
+void PresentationWidget::recordTransitionFrame()
+{
+    const qint64 now = m_transitionClock.elapsed();
+    m_transitionMaxFrameTime = qMax( m_transitionMaxFrameTime, now - m_transitionLastFrameTime );
+    m_transitionLastFrameTime = now;
+    ++m_transitionFrames;
+}
+
+void PresentationWidget::finishTransitionStatistics()
+{
+    if ( m_transitionFrames < 1 )
+        return;
+
+    qCDebug(OkularUiDebug) << "Transition" << m_currentTransition.type() << "took" << m_transitionLastFrameTime << "ms for"
+                           << m_transitionFrames << "frames, average frame time" << ( m_transitionLastFrameTime / m_transitionFrames )
+                           << "ms, worst" << m_transitionMaxFrameTime << "ms, expected" << m_transitionDelay << "ms";
+}
+
 void PresentationWidget::slotDelayedEvents()
 {
     recalcGeometry();
@@ -1607,6 +1805,7 @@ void PresentationWidget::clearDrawings()
 {
     if ( m_frameIndex != -1 )
         m_frames[ m_frameIndex ]->drawings.clear();
+    m_drawingsLayer = QPixmap();
     update();
 }
 
@@ -1660,6 +1859,12 @@ void PresentationWidget::applyNewScreenSize( const QSize & oldSize )
     m_width = width();
     m_height = height();
 
+    // the composited frames and overlays have the old size
+    m_frameCache.clear();
+    m_overlayCache.clear();
+    m_drawingsLayer = QPixmap();
+    m_transitionPixmap = QPixmap();
+
     // update the frames
     QVector< PresentationFrame * >::const_iterator fIt = m_frames.constBegin(), fEnd = m_frames.constEnd();
     const float screenRatio = (float)m_height / (float)m_width;
@@ -1964,6 +2169,7 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
     m_transitionRects.clear();
     m_currentTransition = *transition;
     m_currentPagePixmap = m_lastRenderedPixmap;
+    startTransitionStatistics();
 
     switch( transition->type() )
     {
@@ -2310,18 +2516,9 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
             enum {FADE_TRANSITION_FPS = 20};
             const int steps = totalTime * FADE_TRANSITION_FPS;
             m_transitionSteps = steps;
-            QPainter pixmapPainter;
             m_currentPixmapOpacity = (double) 1 / steps;
             m_transitionDelay = (int)( totalTime * 1000 ) / steps;
-            m_lastRenderedPixmap = QPixmap( m_lastRenderedPixmap.size() );
-            m_lastRenderedPixmap.fill( Qt::transparent );
-            pixmapPainter.begin( &m_lastRenderedPixmap );
-            pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
-            pixmapPainter.setOpacity( 1 - m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
-            pixmapPainter.setOpacity( m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
-            pixmapPainter.end();
+            blendTransitionFrame();
             update();
         } break;
         // implement missing transitions (a binary raster engine needed here)
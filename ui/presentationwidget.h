@@ -11,6 +11,8 @@
 #define _OKULAR_PRESENTATIONWIDGET_H_
 
 #include <QDomElement>
+#include <QElapsedTimer>
+#include <QHash>
 #include <qlist.h>
 #include <qpixmap.h>
 #include <qstringlist.h>
@@ -85,6 +87,16 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         void generateIntroPage( QPainter & p );
         void generateContentsPage( int page, QPainter & p );
         void generateOverlay();
+        QPixmap renderOverlay( int frameIndex, int side ) const;
+        QPixmap composeFrame( int frameIndex );
+        bool isFrameCacheable( int frameIndex ) const;
+        void precomposeFrame( int frameIndex );
+        void pruneFrameCache();
+        int framesToPrepare() const;
+        void blendTransitionFrame();
+        void startTransitionStatistics();
+        void recordTransitionFrame();
+        void finishTransitionStatistics();
         void initTransition( const Okular::PageTransition *transition );
         const Okular::PageTransition defaultTransition() const;
         const Okular::PageTransition defaultTransition( int ) const;
@@ -107,6 +119,11 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         int m_height;
         QPixmap m_lastRenderedPixmap;
         QPixmap m_lastRenderedOverlay;
+        // fully composited frames and progress overlays of the slides around
+        // the current one, ready to be shown without repainting the page
+        QHash< int, QPixmap > m_frameCache;
+        QHash< int, QPixmap > m_overlayCache;
+        QPixmap m_drawingsLayer;
         QRect m_overlayGeometry;
         const Okular::Action * m_pressedLink;
         bool m_handCursor;
@@ -127,7 +144,12 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         Okular::PageTransition m_currentTransition;
         QPixmap m_currentPagePixmap;
         QPixmap m_previousPagePixmap;
+        QPixmap m_transitionPixmap;
         double m_currentPixmapOpacity;
+        QElapsedTimer m_transitionClock;
+        qint64 m_transitionLastFrameTime;
+        qint64 m_transitionMaxFrameTime;
+        int m_transitionFrames;
 
         // misc stuff
         QWidget * m_parentWidget;
@@ -155,6 +177,7 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         void slotLastPage();
         void slotHideOverlay();
         void slotTransitionStep();
+        void slotPrecomposeFrames();
         void slotDelayedEvents();
         void slotPageChanged();
         void clearDrawings();
@@ -16,6 +16,7 @@
 #include <QIcon>
 #include <QPainter>
 #include <QResizeEvent>
+#include <QScopedPointer>
 #include <QScrollBar>
 #include <QSizePolicy>
 #include <QStyle>
@@ -25,6 +26,8 @@
 #include <KIconLoader>
 #include <KActionCollection>
 
+#include <algorithm>
+
 // local includes
 #include "pagepainter.h"
 #include "core/area.h"
@@ -37,6 +40,11 @@
 
 class ThumbnailWidget;
 
+static bool pageNumberLessThan( const Okular::Page * page, int number )
+{
+    return (int)page->number() < number;
+}
+
 class ThumbnailListPrivate : public QWidget
 {
     public:
@@ -54,17 +62,36 @@ class ThumbnailListPrivate : public QWidget
 
         ThumbnailList *q;
         Okular::Document *m_document;
-        ThumbnailWidget *m_selected;
         QTimer *m_delayTimer;
         QPixmap *m_bookmarkOverlay;
-        QVector<ThumbnailWidget *> m_thumbnails;
-        QList<ThumbnailWidget *> m_visibleThumbnails;
-        int m_vectorIndex;
+        // the pages shown in the list (one per row) and the y offset of each
+        // row; the last offset is the height of all the rows plus a spacing
+        QVector<const Okular::Page *> m_pages;
+        QVector<int> m_rowOffsets;
+        int m_rowsWidth;
+        int m_rowSpacing;
+        int m_labelHeight;
+        // only the rows intersecting the viewport have a ThumbnailWidget
+        QVector<ThumbnailWidget *> m_visibleThumbnails;
+        int m_firstVisibleRow;
+        int m_selectedRow;
         // Grabbing variables
         QPoint m_mouseGrabPos;
-        ThumbnailWidget *m_mouseGrabItem;
+        int m_mouseGrabRow;
         int m_pageCurrentlyGrabbed;
 
+        // compute the geometry of all the rows for the given width, returns the contents height
+        int layoutRows( int width );
+        QRect rowRect( int row ) const;
+        int rowAt( int y ) const;
+        int rowForPage( int pageNumber ) const;
+        bool rowsIn( const QRect & rect, int *first, int *last ) const;
+        // create/destroy the ThumbnailWidgets so that they match the visible rows
+        void updateVisibleThumbnails();
+        void clearVisibleThumbnails();
+        ThumbnailWidget *visibleThumbnail( int row ) const;
+        ThumbnailWidget *createThumbnail( int row ) const;
+
         // resize thumbnails to fit the width
         void viewportResizeEvent( QResizeEvent * );
         // called by ThumbnailWidgets to get the overlay bookmark pixmap
@@ -80,9 +107,8 @@ class ThumbnailListPrivate : public QWidget
         void slotRequestVisiblePixmaps( int newContentsY = -1 );
         // delay timeout: resize overlays and requests pixmaps
         void slotDelayTimeout();
-        ThumbnailWidget* getPageByNumber( int page ) const;
         int getNewPageOffset( int n, ThumbnailListPrivate::ChangePageDirection dir ) const;
-        ThumbnailWidget *getThumbnailbyOffset( int current, int offset ) const;
+        int getRowByOffset( int current, int offset ) const;
 
     protected:
         void mousePressEvent( QMouseEvent * e ) override;
@@ -94,11 +120,11 @@ class ThumbnailListPrivate : public QWidget
 };
 
 
-// ThumbnailWidget represents a single thumbnail in the ThumbnailList
+// ThumbnailWidget represents a single visible thumbnail in the ThumbnailList
 class ThumbnailWidget
 {
     public:
-        ThumbnailWidget( ThumbnailListPrivate * parent, const Okular::Page * page );
+        ThumbnailWidget( ThumbnailListPrivate * parent, const Okular::Page * page, bool selected, const Okular::NormalizedRect & visibleRect );
 
         // set internal parameters to fit the page in the given width
         void resizeFitWidth( int width );
@@ -107,6 +133,9 @@ class ThumbnailWidget
         // set the visible rect of the current page
         void setVisibleRect( const Okular::NormalizedRect & rect );
 
+        // the height a thumbnail of the page takes when fit in the given width
+        static int heightForWidth( const Okular::Page * page, int width, int labelHeight );
+
         // query methods
         int heightHint() const { return m_pixmapHeight + m_labelHeight + m_margin; }
         int pixmapWidth() const { return m_pixmapWidth; }
@@ -143,53 +172,170 @@ class ThumbnailWidget
 
 
 ThumbnailListPrivate::ThumbnailListPrivate( ThumbnailList *qq, Okular::Document *document )
-    : QWidget(), q( qq ), m_document( document ), m_selected( 0 ),
-    m_delayTimer( 0 ), m_bookmarkOverlay( 0 ), m_vectorIndex( 0 )
+    : QWidget(), q( qq ), m_document( document ),
+    m_delayTimer( 0 ), m_bookmarkOverlay( 0 ), m_rowsWidth( 0 ), m_rowSpacing( 0 ),
+    m_labelHeight( 0 ), m_firstVisibleRow( 0 ), m_selectedRow( -1 ), m_mouseGrabRow( -1 ),
+    m_pageCurrentlyGrabbed( -1 )
 {
     setMouseTracking( true );
-    m_mouseGrabItem = 0;
 }
 
+ThumbnailListPrivate::~ThumbnailListPrivate()
+{
+    qDeleteAll( m_visibleThumbnails );
+}
 
-ThumbnailWidget* ThumbnailListPrivate::getPageByNumber( int page ) const
+int ThumbnailListPrivate::layoutRows( int width )
 {
-    QVector< ThumbnailWidget * >::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    m_rowsWidth = width;
+    m_rowSpacing = style()->layoutSpacing( QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical );
+    m_labelHeight = QFontMetrics( font() ).height();
+
+    // only integer offsets are stored, so this stays cheap even for huge documents
+    const int count = m_pages.count();
+    m_rowOffsets.resize( count + 1 );
+    int height = 0;
+    for ( int i = 0; i < count; ++i )
     {
-        if ( (*tIt)->pageNumber() == page )
-            return (*tIt);
+        m_rowOffsets[ i ] = height;
+        height += ThumbnailWidget::heightForWidth( m_pages[ i ], width, m_labelHeight ) + m_rowSpacing;
     }
-    return 0;
+    m_rowOffsets[ count ] = height;
+
+    return count > 0 ? height - m_rowSpacing : 0;
 }
 
-ThumbnailListPrivate::~ThumbnailListPrivate()
+QRect ThumbnailListPrivate::rowRect( int row ) const
 {
+    if ( row < 0 || row >= m_pages.count() )
+        return QRect();
+    return QRect( 0, m_rowOffsets[ row ], m_rowsWidth, m_rowOffsets[ row + 1 ] - m_rowOffsets[ row ] - m_rowSpacing );
 }
 
-ThumbnailWidget* ThumbnailListPrivate::itemFor( const QPoint & p ) const
+int ThumbnailListPrivate::rowAt( int y ) const
 {
-    QVector< ThumbnailWidget * >::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    const int count = m_pages.count();
+    if ( count < 1 )
+        return -1;
+    const int row = std::upper_bound( m_rowOffsets.constBegin(), m_rowOffsets.constBegin() + count, y ) - m_rowOffsets.constBegin() - 1;
+    // y might be above the first row or in the spacing between two rows
+    if ( row < 0 || y >= m_rowOffsets[ row + 1 ] - m_rowSpacing )
+        return -1;
+    return row;
+}
+
+int ThumbnailListPrivate::rowForPage( int pageNumber ) const
+{
+    // the pages are always sorted by number, even when filtered
+    QVector<const Okular::Page *>::const_iterator it = std::lower_bound( m_pages.constBegin(), m_pages.constEnd(), pageNumber, pageNumberLessThan );
+    if ( it == m_pages.constEnd() || (int)(*it)->number() != pageNumber )
+        return -1;
+    return it - m_pages.constBegin();
+}
+
+bool ThumbnailListPrivate::rowsIn( const QRect & rect, int *first, int *last ) const
+{
+    const int count = m_pages.count();
+    if ( count < 1 || !rect.isValid() )
+        return false;
+    QVector<int>::const_iterator begin = m_rowOffsets.constBegin(), end = begin + count;
+    *first = qMax( 0, int( std::upper_bound( begin, end, rect.top() ) - begin ) - 1 );
+    *last = int( std::upper_bound( begin, end, rect.bottom() ) - begin ) - 1;
+    return *last >= *first;
+}
+
+ThumbnailWidget* ThumbnailListPrivate::visibleThumbnail( int row ) const
+{
+    const int index = row - m_firstVisibleRow;
+    if ( row < 0 || index < 0 || index >= m_visibleThumbnails.count() )
+        return 0;
+    return m_visibleThumbnails[ index ];
+}
+
+ThumbnailWidget* ThumbnailListPrivate::createThumbnail( int row ) const
+{
+    const Okular::Page * page = m_pages[ row ];
+    Okular::NormalizedRect visibleRect;
+    foreach ( const Okular::VisiblePageRect * vRect, m_document->visiblePageRects() )
     {
-        if ( (*tIt)->rect().contains( p ) )
-            return (*tIt);
+        if ( vRect->pageNumber == (int)page->number() )
+        {
+            visibleRect = vRect->rect;
+            break;
+        }
     }
-    return 0;
+
+    ThumbnailWidget * t = new ThumbnailWidget( const_cast<ThumbnailListPrivate *>( this ), page, row == m_selectedRow, visibleRect );
+    t->move( 0, m_rowOffsets[ row ] );
+    t->resizeFitWidth( m_rowsWidth );
+    return t;
+}
+
+void ThumbnailListPrivate::updateVisibleThumbnails()
+{
+    const QRect viewportRect = q->viewport()->rect().translated( q->horizontalScrollBar()->value(), q->verticalScrollBar()->value() );
+    int first = 0, last = -1;
+    if ( !rowsIn( viewportRect, &first, &last ) )
+    {
+        clearVisibleThumbnails();
+        return;
+    }
+
+    // reuse the widgets of the rows that were already visible
+    QVector<ThumbnailWidget *> visible;
+    visible.reserve( last - first + 1 );
+    for ( int row = first; row <= last; ++row )
+    {
+        ThumbnailWidget * t = visibleThumbnail( row );
+        if ( t )
+            m_visibleThumbnails[ row - m_firstVisibleRow ] = 0;
+        else
+            t = createThumbnail( row );
+        visible.append( t );
+    }
+    qDeleteAll( m_visibleThumbnails );
+    m_visibleThumbnails = visible;
+    m_firstVisibleRow = first;
+}
+
+void ThumbnailListPrivate::clearVisibleThumbnails()
+{
+    qDeleteAll( m_visibleThumbnails );
+    m_visibleThumbnails.clear();
+    m_firstVisibleRow = 0;
+}
+
+ThumbnailWidget* ThumbnailListPrivate::itemFor( const QPoint & p ) const
+{
+    return visibleThumbnail( rowAt( p.y() ) );
 }
 
 void ThumbnailListPrivate::paintEvent( QPaintEvent * e )
 {
+    int first, last;
+    if ( !rowsIn( e->rect(), &first, &last ) )
+        return;
+
     QPainter painter( this );
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    for ( int row = first; row <= last; ++row )
     {
-        QRect rect = e->rect().intersected( (*tIt)->rect() );
+        // rows can be exposed before the visible range has been updated,
+        // paint those through a temporary thumbnail
+        QScopedPointer<ThumbnailWidget> tempThumbnail;
+        ThumbnailWidget * t = visibleThumbnail( row );
+        if ( !t )
+        {
+            tempThumbnail.reset( createThumbnail( row ) );
+            t = tempThumbnail.data();
+        }
+
+        QRect rect = e->rect().intersected( t->rect() );
         if ( !rect.isNull() )
         {
-            rect.translate( -(*tIt)->pos() );
+            rect.translate( -t->pos() );
             painter.save();
-            painter.translate( (*tIt)->pos() );
-            (*tIt)->paint( painter, rect );
+            painter.translate( t->pos() );
+            t->paint( painter, rect );
             painter.restore();
         }
     }
@@ -229,23 +375,21 @@ ThumbnailList::~ThumbnailList()
 //BEGIN DocumentObserver inherited methods
 void ThumbnailList::notifySetup( const QVector< Okular::Page * > & pages, int setupFlags )
 {
-    // if there was a widget selected, save its pagenumber to restore
+    // if there was a page selected, save its pagenumber to restore
     // its selection (if available in the new set of pages)
     int prevPage = -1;
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) && d->m_selected )
+    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) && d->m_selectedRow != -1 )
     {
-        prevPage = d->m_selected->page()->number();
+        prevPage = d->m_pages[ d->m_selectedRow ]->number();
     } else
         prevPage = d->m_document->viewport().pageNumber;
 
     // delete all the Thumbnails
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
-        delete *tIt;
-    d->m_thumbnails.clear();
-    d->m_visibleThumbnails.clear();
-    d->m_selected = 0;
-    d->m_mouseGrabItem = 0;
+    d->clearVisibleThumbnails();
+    d->m_pages.clear();
+    d->m_rowOffsets.clear();
+    d->m_selectedRow = -1;
+    d->m_mouseGrabRow = -1;
 
     if ( pages.count() < 1 )
     {
@@ -264,41 +408,39 @@ void ThumbnailList::notifySetup( const QVector< Okular::Page * > & pages, int se
         if ( (*pIt)->hasHighlights( SW_SEARCH_ID ) )
             skipCheck = false;
 
-    // generate Thumbnails for the given set of pages
-    const int width = viewport()->width();
-    int height = 0;
-    int centerHeight = 0;
+    // collect the rows for the given set of pages, ThumbnailWidgets are
+    // only created later for the rows that are actually visible
+    d->m_pages.reserve( pages.count() );
     for ( pIt = pages.constBegin(); pIt != pEnd ; ++pIt )
         //if ( skipCheck || (*pIt)->attributes() & flags )
         if ( skipCheck || (*pIt)->hasHighlights( SW_SEARCH_ID ) )
-        {
-            ThumbnailWidget * t = new ThumbnailWidget( d, *pIt );
-            t->move(0, height);
-            // add to the internal queue
-            d->m_thumbnails.push_back( t );
-            // update total height (asking widget its own height)
-            t->resizeFitWidth( width );
-            // restoring the previous selected page, if any
-            if ( (*pIt)->number() < prevPage )
-            {
-                centerHeight = height + t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical)/2;
-            }
-            if ( (*pIt)->number() == prevPage )
-            {
-                d->m_selected = t;
-                d->m_selected->setSelected( true );
-                centerHeight = height + t->height() / 2;
-            }
-            height += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
-        }
+            d->m_pages.append( *pIt );
 
     // update scrollview's contents size (sets scrollbars limits)
-    height -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+    const int width = viewport()->width();
+    const int height = d->layoutRows( width );
     widget()->resize( width, height );
 
+    // restoring the previous selected page, if any
+    int centerHeight = 0;
+    d->m_selectedRow = d->rowForPage( prevPage );
+    if ( d->m_selectedRow != -1 )
+    {
+        const QRect selectedRect = d->rowRect( d->m_selectedRow );
+        centerHeight = selectedRect.y() + selectedRect.height() / 2;
+    }
+    else
+    {
+        // center on the gap after the last row before the previous page
+        const int row = std::lower_bound( d->m_pages.constBegin(), d->m_pages.constEnd(), prevPage, pageNumberLessThan ) - d->m_pages.constBegin() - 1;
+        if ( row >= 0 )
+            centerHeight = d->m_rowOffsets[ row + 1 ] - d->m_rowSpacing / 2;
+    }
+
     // enable scrollbar when there's something to scroll
     verticalScrollBar()->setEnabled( viewport()->height() < height );
     verticalScrollBar()->setValue(centerHeight - viewport()->height() / 2);
+    d->updateVisibleThumbnails();
 
     // request for thumbnail generation
     d->delayedRequestVisiblePixmaps( 200 );
@@ -309,31 +451,25 @@ void ThumbnailList::notifyCurrentPageChanged( int previousPage, int currentPage
     Q_UNUSED( previousPage )
 
     // skip notifies for the current page (already selected)
-    if ( d->m_selected && d->m_selected->pageNumber() == currentPage )
+    if ( d->m_selectedRow != -1 && (int)d->m_pages[ d->m_selectedRow ]->number() == currentPage )
         return;
 
     // deselect previous thumbnail
-    if ( d->m_selected )
-        d->m_selected->setSelected( false );
-    d->m_selected = 0;
+    if ( ThumbnailWidget * t = d->visibleThumbnail( d->m_selectedRow ) )
+        t->setSelected( false );
 
     // select the page with viewport and ensure it's centered in the view
-    d->m_vectorIndex = 0;
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for ( ; tIt != tEnd; ++tIt )
+    d->m_selectedRow = d->rowForPage( currentPage );
+    if ( d->m_selectedRow == -1 )
+        return;
+
+    if ( ThumbnailWidget * t = d->visibleThumbnail( d->m_selectedRow ) )
+        t->setSelected( true );
+    if ( Okular::Settings::syncThumbnailsViewport() )
     {
-        if ( (*tIt)->pageNumber() == currentPage )
-        {
-            d->m_selected = *tIt;
-            d->m_selected->setSelected( true );
-            if ( Okular::Settings::syncThumbnailsViewport() )
-            {
-                int yOffset = qMax( viewport()->height() / 4, d->m_selected->height() / 2 );
-                ensureVisible( 0, d->m_selected->pos().y() + d->m_selected->height()/2, 0, yOffset );
-            }
-            break;
-        }
-        d->m_vectorIndex++;
+        const QRect selectedRect = d->rowRect( d->m_selectedRow );
+        int yOffset = qMax( viewport()->height() / 4, selectedRect.height() / 2 );
+        ensureVisible( 0, selectedRect.y() + selectedRect.height()/2, 0, yOffset );
     }
 }
 
@@ -344,14 +480,9 @@ void ThumbnailList::notifyPageChanged( int pageNumber, int changedFlags )
     if ( !( changedFlags & interestingFlags ) )
         return;
 
-    // iterate over visible items: if page(pageNumber) is one of them, repaint it
-    QList<ThumbnailWidget *>::const_iterator vIt = d->m_visibleThumbnails.constBegin(), vEnd = d->m_visibleThumbnails.constEnd();
-    for ( ; vIt != vEnd; ++vIt )
-        if ( (*vIt)->pageNumber() == pageNumber )
-        {
-            (*vIt)->update();
-            break;
-        }
+    // if page(pageNumber) is one of the visible items, repaint it
+    if ( ThumbnailWidget * t = d->visibleThumbnail( d->rowForPage( pageNumber ) ) )
+        t->update();
 }
 
 void ThumbnailList::notifyContentsCleared( int changedFlags )
@@ -363,13 +494,13 @@ void ThumbnailList::notifyContentsCleared( int changedFlags )
 
 void ThumbnailList::notifyVisibleRectsChanged()
 {
-    bool found = false;
+    // hidden rows pick up their visible rect when they get created
     const QVector<Okular::VisiblePageRect *> & visibleRects = d->m_document->visiblePageRects();
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
+    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_visibleThumbnails.constBegin(), tEnd = d->m_visibleThumbnails.constEnd();
     QVector<Okular::VisiblePageRect *>::const_iterator vEnd = visibleRects.end();
     for ( ; tIt != tEnd; ++tIt )
     {
-        found = false;
+        bool found = false;
         QVector<Okular::VisiblePageRect *>::const_iterator vIt = visibleRects.begin();
         for ( ; ( vIt != vEnd ) && !found; ++vIt )
         {
@@ -389,12 +520,8 @@ void ThumbnailList::notifyVisibleRectsChanged()
 bool ThumbnailList::canUnloadPixmap( int pageNumber ) const
 {
     // if the thubnail 'pageNumber' is one of the visible ones, forbid unloading
-    QList<ThumbnailWidget *>::const_iterator vIt = d->m_visibleThumbnails.constBegin(), vEnd = d->m_visibleThumbnails.constEnd();
-    for ( ; vIt != vEnd; ++vIt )
-        if ( (*vIt)->pageNumber() == pageNumber )
-            return false;
     // if hidden permit unloading
-    return true;
+    return !d->visibleThumbnail( d->rowForPage( pageNumber ) );
 }
 //END DocumentObserver inherited methods
 
@@ -402,7 +529,7 @@ bool ThumbnailList::canUnloadPixmap( int pageNumber ) const
 void ThumbnailList::updateWidgets()
 {
     // Update all visible widgets
-    QList<ThumbnailWidget *>::const_iterator vIt = d->m_visibleThumbnails.constBegin(), vEnd = d->m_visibleThumbnails.constEnd();
+    QVector<ThumbnailWidget *>::const_iterator vIt = d->m_visibleThumbnails.constBegin(), vEnd = d->m_visibleThumbnails.constEnd();
     for ( ; vIt != vEnd; ++vIt )
     {
         ThumbnailWidget * t = *vIt;
@@ -438,24 +565,15 @@ int ThumbnailListPrivate::getNewPageOffset(int n, ThumbnailListPrivate::ChangePa
     return 0;
 }
 
-ThumbnailWidget *ThumbnailListPrivate::getThumbnailbyOffset(int current, int offset) const
+int ThumbnailListPrivate::getRowByOffset(int current, int offset) const
 {
-    QVector<ThumbnailWidget *>::const_iterator it = m_thumbnails.begin();
-    QVector<ThumbnailWidget *>::const_iterator itE = m_thumbnails.end();
-    int idx = 0;
-    while ( it != itE )
-    {
-        if ( (*it)->pageNumber() == current )
-            break;
-        ++idx;
-        ++it;
-    }
-    if ( it == itE )
-        return 0;
-    idx += offset;
-    if ( idx < 0 || idx >= m_thumbnails.size() )
-        return 0;
-    return m_thumbnails[idx];
+    int row = rowForPage( current );
+    if ( row == -1 )
+        return -1;
+    row += offset;
+    if ( row < 0 || row >= m_pages.size() )
+        return -1;
+    return row;
 }
 
 ThumbnailListPrivate::ChangePageDirection ThumbnailListPrivate::forwardTrack(const QPoint &point, const QSize &r )
@@ -498,40 +616,40 @@ void ThumbnailList::slotFilterBookmarks( bool filterOn )
 //BEGIN widget events
 void ThumbnailList::keyPressEvent( QKeyEvent * keyEvent )
 {
-    if ( d->m_thumbnails.count() < 1 )
+    if ( d->m_pages.count() < 1 )
         return keyEvent->ignore();
 
     int nextPage = -1;
     if ( keyEvent->key() == Qt::Key_Up )
     {
-        if ( !d->m_selected )
+        if ( d->m_selectedRow == -1 )
             nextPage = 0;
-        else if ( d->m_vectorIndex > 0 )
-            nextPage = d->m_thumbnails[ d->m_vectorIndex - 1 ]->pageNumber();
+        else if ( d->m_selectedRow > 0 )
+            nextPage = d->m_pages[ d->m_selectedRow - 1 ]->number();
     }
     else if ( keyEvent->key() == Qt::Key_Down )
     {
-        if ( !d->m_selected )
+        if ( d->m_selectedRow == -1 )
             nextPage = 0;
-        else if ( d->m_vectorIndex < (int)d->m_thumbnails.count() - 1 )
-            nextPage = d->m_thumbnails[ d->m_vectorIndex + 1 ]->pageNumber();
+        else if ( d->m_selectedRow < (int)d->m_pages.count() - 1 )
+            nextPage = d->m_pages[ d->m_selectedRow + 1 ]->number();
     }
     else if ( keyEvent->key() == Qt::Key_PageUp )
         verticalScrollBar()->triggerAction( QScrollBar::SliderPageStepSub );
     else if ( keyEvent->key() == Qt::Key_PageDown )
         verticalScrollBar()->triggerAction( QScrollBar::SliderPageStepAdd );
     else if ( keyEvent->key() == Qt::Key_Home )
-        nextPage = d->m_thumbnails[ 0 ]->pageNumber();
+        nextPage = d->m_pages[ 0 ]->number();
     else if ( keyEvent->key() == Qt::Key_End )
-        nextPage = d->m_thumbnails[ d->m_thumbnails.count() - 1 ]->pageNumber();
+        nextPage = d->m_pages[ d->m_pages.count() - 1 ]->number();
 
     if ( nextPage == -1 )
         return keyEvent->ignore();
 
     keyEvent->accept();
-    if ( d->m_selected )
-        d->m_selected->setSelected( false );
-    d->m_selected = 0;
+    if ( ThumbnailWidget * t = d->visibleThumbnail( d->m_selectedRow ) )
+        t->setSelected( false );
+    d->m_selectedRow = -1;
     d->m_document->setViewportPage( nextPage );
 }
 
@@ -552,7 +670,7 @@ bool ThumbnailList::viewportEvent( QEvent * e )
 
 void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
 {
-    if ( m_thumbnails.count() < 1 || width() < 1 )
+    if ( m_pages.count() < 1 || width() < 1 )
         return;
 
     // if width changed resize all the Thumbnails, reposition them to the
@@ -562,20 +680,13 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
         // runs the timer avoiding a thumbnail regeneration by 'contentsMoving'
         delayedRequestVisiblePixmaps( 2000 );
 
-        // resize and reposition items
+        // recompute the rows geometry, the visible items are recreated
+        // in the right place afterwards
         const int newWidth = q->viewport()->width();
-        int newHeight = 0;
-        QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-        for ( ; tIt != tEnd; ++tIt )
-        {
-            ThumbnailWidget *t = *tIt;
-            t->move(0, newHeight);
-            t->resizeFitWidth( newWidth );
-            newHeight += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
-        }
+        clearVisibleThumbnails();
 
         // update scrollview's contents size (sets scrollbars limits)
-        newHeight -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+        const int newHeight = layoutRows( newWidth );
         const int oldHeight = q->widget()->height();
         const int oldYCenter = q->verticalScrollBar()->value() + q->viewport()->height() / 2;
         q->widget()->resize( newWidth, newHeight );
@@ -585,6 +696,7 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
 
         // ensure that what was visibile before remains visible now
         q->ensureVisible( 0, int( (qreal)oldYCenter * q->widget()->height() / oldHeight ), 0, q->viewport()->height() / 2 );
+        updateVisibleThumbnails();
     }
     else if ( e->size().height() <= e->oldSize().height() )
         return;
@@ -604,23 +716,18 @@ void ThumbnailListPrivate::viewportResizeEvent( QResizeEvent * e )
 //BEGIN internal SLOTS
 void ThumbnailListPrivate::slotRequestVisiblePixmaps( int /*newContentsY*/ )
 {
+    // keep the visible items in sync with the scroll position
+    updateVisibleThumbnails();
+
     // if an update is already scheduled or the widget is hidden, don't proceed
     if ( ( m_delayTimer && m_delayTimer->isActive() ) || q->isHidden() )
         return;
 
-    // scroll from the top to the last visible thumbnail
-    m_visibleThumbnails.clear();
     QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    const QRect viewportRect = q->viewport()->rect().translated( q->horizontalScrollBar()->value(), q->verticalScrollBar()->value() );
+    QVector<ThumbnailWidget *>::const_iterator tIt = m_visibleThumbnails.constBegin(), tEnd = m_visibleThumbnails.constEnd();
     for ( ; tIt != tEnd; ++tIt )
     {
         ThumbnailWidget * t = *tIt;
-        const QRect thumbRect = t->rect();
-        if ( !thumbRect.intersects( viewportRect ) )
-          continue;
-        // add ThumbnailWidget to visible list
-        m_visibleThumbnails.push_back( t );
         // if pixmap not present add it to requests
         if ( !t->page()->hasPixmap( q, t->pixmapWidth(), t->pixmapHeight() ) )
         {
@@ -663,13 +770,13 @@ void ThumbnailListPrivate::delayedRequestVisiblePixmaps( int delayMs )
 
 /** ThumbnailWidget implementation **/
 
-ThumbnailWidget::ThumbnailWidget( ThumbnailListPrivate * parent, const Okular::Page * kp )
+ThumbnailWidget::ThumbnailWidget( ThumbnailListPrivate * parent, const Okular::Page * kp, bool selected, const Okular::NormalizedRect & visibleRect )
     : m_parent( parent ), m_page( kp ),
-    m_selected( false ), m_pixmapWidth( 10 ), m_pixmapHeight( 10 )
+    m_selected( selected ), m_pixmapWidth( 10 ), m_pixmapHeight( 10 ),
+    m_visibleRect( visibleRect )
 {
     m_labelNumber = m_page->number() + 1;
-    m_labelHeight = QFontMetrics( m_parent->font() ).height();
-
+    m_labelHeight = m_parent->m_labelHeight;
 }
 
 void ThumbnailWidget::resizeFitWidth( int width )
@@ -679,6 +786,12 @@ void ThumbnailWidget::resizeFitWidth( int width )
     m_rect.setSize( QSize( width, heightHint() ) );
 }
 
+int ThumbnailWidget::heightForWidth( const Okular::Page * page, int width, int labelHeight )
+{
+    // keep in sync with resizeFitWidth() and heightHint()
+    return qRound( page->ratio() * (double)( width - m_margin ) ) + labelHeight + m_margin;
+}
+
 void ThumbnailWidget::setSelected( bool selected )
 {
     // update selected state
@@ -712,22 +825,21 @@ void ThumbnailListPrivate::mousePressEvent( QMouseEvent * e )
     {
         m_mouseGrabPos.setX( 0 );
         m_mouseGrabPos.setY( 0 );
-        m_mouseGrabItem = item;
         m_pageCurrentlyGrabbed = item->pageNumber();
-        m_mouseGrabItem = item;
+        m_mouseGrabRow = rowForPage( m_pageCurrentlyGrabbed );
     }
     else
     {
         m_mouseGrabPos.setX( 0 );
         m_mouseGrabPos.setY( 0 );
-        m_mouseGrabItem = 0;
+        m_mouseGrabRow = -1;
     }
 }
 
 void ThumbnailListPrivate::mouseReleaseEvent( QMouseEvent * e )
 {
     ThumbnailWidget* item = itemFor( e->pos() );
-    m_mouseGrabItem = item;
+    m_mouseGrabRow = item ? rowForPage( item->pageNumber() ) : -1;
     if ( !item ) // mouse on the spacing between items
         return e->ignore();
 
@@ -773,9 +885,9 @@ void ThumbnailListPrivate::mouseMoveEvent( QMouseEvent * e )
         return e->ignore();
     }
     // no item under the mouse or previously selected
-    if ( !m_mouseGrabItem )
+    if ( m_mouseGrabRow == -1 )
         return e->ignore();
-    const QRect r = m_mouseGrabItem->rect();
+    const QRect r = rowRect( m_mouseGrabRow );
     if ( !m_mouseGrabPos.isNull() )
     {
         const QPoint mousePos = e->pos();
@@ -788,10 +900,10 @@ void ThumbnailListPrivate::mouseMoveEvent( QMouseEvent * e )
         {
             // Changing the selected page
             const int offset = getNewPageOffset( m_pageCurrentlyGrabbed, direction );
-            const ThumbnailWidget *newThumb = getThumbnailbyOffset( m_pageCurrentlyGrabbed, offset );
-            if ( !newThumb )
+            const int newRow = getRowByOffset( m_pageCurrentlyGrabbed, offset );
+            if ( newRow == -1 )
                 return;
-            int newPageOn = newThumb->pageNumber();
+            int newPageOn = m_pages[ newRow ]->number();
             if ( newPageOn == m_pageCurrentlyGrabbed || newPageOn < 0 ||
                  newPageOn >= (int)m_document->pages() )
             {
@@ -853,7 +965,7 @@ void ThumbnailListPrivate::mouseMoveEvent( QMouseEvent * e )
             m_mouseGrabPos.setX( 0 );
             m_mouseGrabPos.setY( 0 );
             m_pageCurrentlyGrabbed = newPageOn;
-            m_mouseGrabItem = getPageByNumber( m_pageCurrentlyGrabbed );
+            m_mouseGrabRow = rowForPage( m_pageCurrentlyGrabbed );
         }
         // wrap mouse from top to bottom
         const QRect mouseContainer = QApplication::desktop()->screenGeometry( this );
@@ -60,7 +60,8 @@ TOC::~TOC()
 
 void TOC::notifySetup( const QVector< Okular::Page * > & /*pages*/, int setupFlags )
 {
-    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+    // the generator may have extended the synopsis along with the pages
+    if ( !( setupFlags & ( Okular::DocumentObserver::DocumentChanged | Okular::DocumentObserver::PagesAdded ) ) )
         return;
 
     // clear contents